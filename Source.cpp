@@ -1,13 +1,148 @@
 #include <iostream>
+#include <string>
+#include <stdlib.h>
 #include <Base.h>
+#include <WorldFile.h>
 
 #undef main
 
+// usage: SDL_box2d [--headless | --threaded] [--hud] [--steps N] [--dt seconds]
+//                  [--velocity-iterations N] [--position-iterations N] [--threads N] [--solver-width N]
+//                  [--scene test|pyramids|circles|chains|ragdolls|terrain|sleeping] [--bodies N]
+//                  [--load-world FILE] [--save-world FILE] [--trace FILE] [--trace-events N]
+//                  [--record FILE]
 int main(int argc, char* argv[])
 {
-    Base base;
+    bool headless = false;
+    bool threaded = false;
+    bool hud = false;
+    int stepCount = 1000;
+    float dt = 0.0f;
+    int velocityIterations = 8;
+    int positionIterations = 3;
+    int threadCount = 1;
+    int solverWidth = 1;
+    SceneType scene = SceneType::testBodies;
+    int sceneBodyCount = 1000;
+    const char* loadPath = nullptr;
+    const char* savePath = nullptr;
+    const char* tracePath = nullptr;
+    int traceEventCount = 1 << 20;
+    const char* recordPath = nullptr;
 
-    base.loop();
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--headless") headless = true;
+        else if (arg == "--threaded") threaded = true;
+        else if (arg == "--hud") hud = true;
+        else if (arg == "--steps" && hasValue) stepCount = atoi(argv[++i]);
+        else if (arg == "--dt" && hasValue) dt = (float)atof(argv[++i]);
+        else if (arg == "--velocity-iterations" && hasValue) velocityIterations = atoi(argv[++i]);
+        else if (arg == "--position-iterations" && hasValue) positionIterations = atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) threadCount = atoi(argv[++i]);
+        else if (arg == "--solver-width" && hasValue) solverWidth = atoi(argv[++i]);
+        else if (arg == "--bodies" && hasValue) sceneBodyCount = atoi(argv[++i]);
+        else if (arg == "--load-world" && hasValue) loadPath = argv[++i];
+        else if (arg == "--save-world" && hasValue) savePath = argv[++i];
+        else if (arg == "--trace" && hasValue) tracePath = argv[++i];
+        else if (arg == "--trace-events" && hasValue) traceEventCount = atoi(argv[++i]);
+        else if (arg == "--record" && hasValue) recordPath = argv[++i];
+        else if (arg == "--scene" && hasValue)
+        {
+            if (!findScene(argv[++i], &scene))
+            {
+                std::cerr << "unknown scene: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    Base base(headless, scene, sceneBodyCount);
+
+    // replaces the generated scene before anything is stepped or drawn
+    if (loadPath)
+    {
+        b2Timer timer;
+        if (!loadWorldFile(base.world, loadPath))
+        {
+            std::cerr << "could not load world: " << loadPath << std::endl;
+            return 1;
+        }
+        std::cout << "loaded " << base.world->GetBodyCount() << " bodies in " << timer.GetMilliseconds() << " ms" << std::endl;
+    }
+
+    if (dt > 0.0f) base.timeStep = dt;
+    base.velocityIterations = velocityIterations;
+    base.positionIterations = positionIterations;
+    base.threaded = threaded;
+    base.hud.visible = hud;
+    base.world->SetThreadCount(threadCount > 1 ? threadCount : 1);
+    base.world->SetContactSolverWidth(solverWidth);
+
+    // everything SDL_box2d_benchmark --replay needs to rebuild the world before the first step
+    if (recordPath)
+    {
+        InputLog& log = base.inputLog;
+        log.scene = scene;
+        log.bodyCount = sceneBodyCount;
+        log.worldPath = loadPath ? loadPath : "";
+        log.timeStep = base.timeStep;
+        log.velocityIterations = velocityIterations;
+        log.positionIterations = positionIterations;
+        log.solverWidth = solverWidth;
+        base.recording = true;
+    }
+
+    if (tracePath)
+    {
+#ifndef B2_ENABLE_TRACE
+        std::cerr << "built without BOX2D_ENABLE_TRACE, the trace will be empty" << std::endl;
+#endif
+        b2SetTraceThreadName("Main");
+        b2StartTrace(traceEventCount > 0 ? traceEventCount : 1);
+    }
+
+    if (headless)
+    {
+        base.runHeadless(stepCount);
+    }
+    else
+    {
+        base.loop();
+    }
+
+    if (tracePath)
+    {
+        b2StopTrace();
+        if (!b2WriteTrace(tracePath))
+        {
+            std::cerr << "could not write trace: " << tracePath << std::endl;
+        }
+    }
+
+    if (recordPath)
+    {
+        base.inputLog.stepCount = base.stepIndex;
+        if (!base.inputLog.save(recordPath))
+        {
+            std::cerr << "could not save input log: " << recordPath << std::endl;
+        }
+    }
+
+    // the viewer's world is only saved after its physics thread has stopped
+    if (savePath && !saveWorldFile(base.world, savePath))
+    {
+        std::cerr << "could not save world: " << savePath << std::endl;
+        return 1;
+    }
 
     return 0;
 }
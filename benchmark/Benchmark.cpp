@@ -0,0 +1,735 @@
+#include <Scenes.h>
+#include <InputLog.h>
+#include <WorldFile.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// usage: SDL_box2d_benchmark [--scene NAME|all] [--bodies N[,N...]] [--steps N] [--warmup N]
+//                            [--dt seconds] [--velocity-iterations N] [--position-iterations N]
+//                            [--threads N[,N...]] [--solver-width N[,N...]] [--csv FILE] [--json FILE]
+//                            [--stack-size KB] [--arena MB] [--huge-pages]
+//        SDL_box2d_benchmark --tree [--bodies N[,N...]]
+//        SDL_box2d_benchmark --snapshot [--scene NAME|all] [--bodies N[,N...]] [--steps N]
+//        SDL_box2d_benchmark --replay FILE [--threads N] [--csv FILE]
+//        SDL_box2d_benchmark --raycast [--scene NAME|all] [--bodies N[,N...]] [--rays N] [--threads N[,N...]]
+
+struct BenchmarkResult
+{
+    SceneType scene;
+    int requestedBodies;
+    int bodyCount;
+    int stepCount;
+    int threadCount;
+    int solverWidth;
+
+    // b2Profile::step statistics in milliseconds
+    float mean;
+    float p50;
+    float p99;
+    float max;
+
+    // mean of every b2Profile field over the measured steps
+    b2Profile profile;
+
+    // allocator use at the end of the run
+    b2AllocatorStats memory;
+
+    // arena use at the end of the run, 0 without --arena
+    int arenaUsed;
+    int arenaFreeBytes;
+    int arenaOverflowCount;
+};
+
+// where the world's allocators get their memory
+struct MemoryOptions
+{
+    int stackSize = b2_stackSize;
+    int arenaSize = 0;
+    bool hugePages = false;
+};
+
+static float percentile(const std::vector<float>& sorted, float p)
+{
+    size_t index = (size_t)(p * (float)(sorted.size() - 1) + 0.5f);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// parses a comma separated list, e.g. 1000,10000,100000
+static void parseList(const char* text, std::vector<int>* values)
+{
+    for (const char* token = text; *token != 0;)
+    {
+        values->push_back(atoi(token));
+        while (*token != 0 && *token != ',') token++;
+        if (*token == ',') token++;
+    }
+}
+
+static BenchmarkResult runBenchmark(SceneType scene, int bodyCount, int threadCount, int solverWidth,
+    int warmupCount, int stepCount, float dt, int velocityIterations, int positionIterations,
+    const MemoryOptions& memory)
+{
+    // declared first so it outlives the world
+    std::unique_ptr<b2ArenaAllocator> arena;
+    if (memory.arenaSize > 0) arena.reset(new b2ArenaAllocator(memory.arenaSize, memory.hugePages));
+
+    b2World world(b2Vec2(0.0f, -10.0f), arena.get());
+    world.SetStackSize(memory.stackSize);
+    world.SetThreadCount(threadCount);
+    world.SetContactSolverWidth(solverWidth);
+    createScene(&world, scene, bodyCount);
+
+    for (int i = 0; i < warmupCount; i++)
+    {
+        world.Step(dt, velocityIterations, positionIterations);
+    }
+
+    std::vector<float> stepTimes;
+    stepTimes.reserve(stepCount);
+
+    b2Profile total = {};
+
+    for (int i = 0; i < stepCount; i++)
+    {
+        world.Step(dt, velocityIterations, positionIterations);
+
+        const b2Profile& p = world.GetProfile();
+        stepTimes.push_back(p.step);
+
+        total.step += p.step;
+        total.collide += p.collide;
+        total.solve += p.solve;
+        total.solveInit += p.solveInit;
+        total.solveVelocity += p.solveVelocity;
+        total.solvePosition += p.solvePosition;
+        total.broadphase += p.broadphase;
+        total.solveTOI += p.solveTOI;
+    }
+
+    BenchmarkResult result = {};
+    result.scene = scene;
+    result.requestedBodies = bodyCount;
+    result.bodyCount = world.GetBodyCount();
+    result.stepCount = stepCount;
+    result.threadCount = world.GetThreadCount();
+    result.solverWidth = world.GetContactSolverWidth();
+    result.memory = world.GetAllocatorStats();
+    if (arena)
+    {
+        result.arenaUsed = arena->GetUsed();
+        result.arenaFreeBytes = arena->GetFreeBytes();
+        result.arenaOverflowCount = arena->GetOverflowCount();
+    }
+
+    if (stepCount == 0) return result;
+
+    float inv = 1.0f / (float)stepCount;
+    result.profile.step = total.step * inv;
+    result.profile.collide = total.collide * inv;
+    result.profile.solve = total.solve * inv;
+    result.profile.solveInit = total.solveInit * inv;
+    result.profile.solveVelocity = total.solveVelocity * inv;
+    result.profile.solvePosition = total.solvePosition * inv;
+    result.profile.broadphase = total.broadphase * inv;
+    result.profile.solveTOI = total.solveTOI * inv;
+
+    std::sort(stepTimes.begin(), stepTimes.end());
+    result.mean = result.profile.step;
+    result.p50 = percentile(stepTimes, 0.5f);
+    result.p99 = percentile(stepTimes, 0.99f);
+    result.max = stepTimes.back();
+
+    return result;
+}
+
+static void writeCsv(const char* path, const std::vector<BenchmarkResult>& results)
+{
+    FILE* file = fopen(path, "w");
+    if (file == nullptr)
+    {
+        std::cerr << "could not open " << path << std::endl;
+        return;
+    }
+
+    fprintf(file, "scene,requested_bodies,bodies,steps,threads,solver_width,mean_ms,p50_ms,p99_ms,max_ms,"
+        "collide_ms,solve_ms,solve_init_ms,solve_velocity_ms,solve_position_ms,broadphase_ms,solve_toi_ms,"
+        "stack_size,peak_stack_bytes,stack_overflows,chunks,block_bytes,fragmentation,"
+        "buffer_bytes,arena_used,arena_free_bytes,arena_overflows\n");
+
+    for (const BenchmarkResult& r : results)
+    {
+        fprintf(file, "%s,%d,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d,%d,%d,%d,%d,%.4f,%d,%d,%d,%d\n",
+            getSceneName(r.scene), r.requestedBodies, r.bodyCount, r.stepCount, r.threadCount, r.solverWidth,
+            r.mean, r.p50, r.p99, r.max,
+            r.profile.collide, r.profile.solve, r.profile.solveInit, r.profile.solveVelocity,
+            r.profile.solvePosition, r.profile.broadphase, r.profile.solveTOI,
+            r.memory.stackSize, r.memory.peakStackBytes, r.memory.stackOverflowCount,
+            r.memory.chunkCount, r.memory.blockBytes, r.memory.fragmentation,
+            r.memory.bufferBytes, r.arenaUsed, r.arenaFreeBytes, r.arenaOverflowCount);
+    }
+
+    fclose(file);
+}
+
+static void writeJson(const char* path, const std::vector<BenchmarkResult>& results)
+{
+    FILE* file = fopen(path, "w");
+    if (file == nullptr)
+    {
+        std::cerr << "could not open " << path << std::endl;
+        return;
+    }
+
+    fprintf(file, "[\n");
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchmarkResult& r = results[i];
+
+        fprintf(file, "  {\"scene\": \"%s\", \"requested_bodies\": %d, \"bodies\": %d, \"steps\": %d, \"threads\": %d, \"solver_width\": %d,\n",
+            getSceneName(r.scene), r.requestedBodies, r.bodyCount, r.stepCount, r.threadCount, r.solverWidth);
+        fprintf(file, "   \"step_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+            r.mean, r.p50, r.p99, r.max);
+        fprintf(file, "   \"profile_ms\": {\"collide\": %.4f, \"solve\": %.4f, \"solve_init\": %.4f, "
+            "\"solve_velocity\": %.4f, \"solve_position\": %.4f, \"broadphase\": %.4f, \"solve_toi\": %.4f},\n",
+            r.profile.collide, r.profile.solve, r.profile.solveInit, r.profile.solveVelocity,
+            r.profile.solvePosition, r.profile.broadphase, r.profile.solveTOI);
+        fprintf(file, "   \"memory\": {\"stack_size\": %d, \"peak_stack_bytes\": %d, \"stack_overflows\": %d, "
+            "\"chunks\": %d, \"block_bytes\": %d, \"fragmentation\": %.4f, "
+            "\"buffer_bytes\": %d, \"arena_used\": %d, \"arena_free_bytes\": %d, \"arena_overflows\": %d}}%s\n",
+            r.memory.stackSize, r.memory.peakStackBytes, r.memory.stackOverflowCount,
+            r.memory.chunkCount, r.memory.blockBytes, r.memory.fragmentation,
+            r.memory.bufferBytes, r.arenaUsed, r.arenaFreeBytes, r.arenaOverflowCount,
+            i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(file, "]\n");
+    fclose(file);
+}
+
+// proxy layouts of the testbed dynamic tree and tiles samples
+enum class TreeLayout
+{
+    scattered,
+    tiles
+};
+
+struct TreeQueryCounter
+{
+    int hitCount = 0;
+
+    bool QueryCallback(int32 proxyId)
+    {
+        (void)proxyId;
+        hitCount++;
+        return true;
+    }
+
+    float RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+    {
+        (void)proxyId;
+        hitCount++;
+        return input.maxFraction;
+    }
+};
+
+static float treeRandom(uint32* seed, float lo, float hi)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*seed >> 8) / (float)(1 << 24);
+}
+
+// extent of the square the proxies cover
+static float createTreeLayout(TreeLayout layout, int count, std::vector<b2AABB>* aabbs)
+{
+    uint32 seed = 12345;
+    int columns = (int)ceilf(sqrtf((float)count));
+
+    if (layout == TreeLayout::tiles)
+    {
+        // touching unit tiles, row by row
+        for (int i = 0; i < count; i++)
+        {
+            b2AABB aabb;
+            aabb.lowerBound.Set((float)(i % columns), (float)(i / columns));
+            aabb.upperBound = aabb.lowerBound + b2Vec2(1.0f, 1.0f);
+            aabbs->push_back(aabb);
+        }
+
+        return (float)columns;
+    }
+
+    // boxes of different sizes covering about a quarter of the area
+    float extent = 2.0f * (float)columns;
+    for (int i = 0; i < count; i++)
+    {
+        b2Vec2 center(treeRandom(&seed, 0.0f, extent), treeRandom(&seed, 0.0f, extent));
+        float halfSize = treeRandom(&seed, 0.25f, 0.75f);
+
+        b2AABB aabb;
+        aabb.lowerBound = center - b2Vec2(halfSize, halfSize);
+        aabb.upperBound = center + b2Vec2(halfSize, halfSize);
+        aabbs->push_back(aabb);
+    }
+
+    return extent;
+}
+
+// prints the quality of the tree and the mean time of a query and a ray cast in microseconds
+static void measureTree(const char* layoutName, int count, const char* build, float buildTime,
+    const b2DynamicTree& tree, float extent)
+{
+    const int queryCount = 10000;
+    uint32 seed = 54321;
+    TreeQueryCounter counter;
+
+    b2Timer queryTimer;
+    for (int i = 0; i < queryCount; i++)
+    {
+        b2AABB aabb;
+        aabb.lowerBound.Set(treeRandom(&seed, 0.0f, extent), treeRandom(&seed, 0.0f, extent));
+        aabb.upperBound = aabb.lowerBound + b2Vec2(4.0f, 4.0f);
+        tree.Query(&counter, aabb);
+    }
+    float queryTime = 1000.0f * queryTimer.GetMilliseconds() / (float)queryCount;
+
+    b2Timer rayTimer;
+    for (int i = 0; i < queryCount; i++)
+    {
+        b2RayCastInput input;
+        input.p1.Set(treeRandom(&seed, 0.0f, extent), treeRandom(&seed, 0.0f, extent));
+        float angle = treeRandom(&seed, 0.0f, 2.0f * b2_pi);
+        input.p2 = input.p1 + 0.25f * extent * b2Vec2(cosf(angle), sinf(angle));
+        input.maxFraction = 1.0f;
+        tree.RayCast(&counter, input);
+    }
+    float rayTime = 1000.0f * rayTimer.GetMilliseconds() / (float)queryCount;
+
+    printf("%-10s %8d %-8s %9.3f %9.3f %7d %6d %9.3f %9.3f\n", layoutName, count, build, buildTime,
+        tree.GetAreaRatio(), tree.GetMaxBalance(), tree.GetHeight(), queryTime, rayTime);
+    fflush(stdout);
+}
+
+// compares inserting proxies one at a time, rebuilding that tree top-down and a bulk build
+static void runTreeBenchmark(const std::vector<int>& counts)
+{
+    printf("%-10s %8s %-8s %9s %9s %7s %6s %9s %9s\n",
+        "layout", "proxies", "build", "build_ms", "area", "balance", "height", "query_us", "ray_us");
+
+    const TreeLayout layouts[] = { TreeLayout::scattered, TreeLayout::tiles };
+    const char* layoutNames[] = { "dynamic", "tiles" };
+
+    for (int l = 0; l < 2; l++)
+    {
+        for (int count : counts)
+        {
+            std::vector<b2AABB> aabbs;
+            float extent = createTreeLayout(layouts[l], count, &aabbs);
+            std::vector<void*> userData(count, nullptr);
+            std::vector<int32> proxyIds(count);
+
+            {
+                b2DynamicTree tree;
+
+                b2Timer timer;
+                for (int i = 0; i < count; i++)
+                {
+                    tree.CreateProxy(aabbs[i], nullptr);
+                }
+                measureTree(layoutNames[l], count, "insert", timer.GetMilliseconds(), tree, extent);
+
+                b2Timer rebuildTimer;
+                tree.RebuildTopDown();
+                measureTree(layoutNames[l], count, "rebuild", rebuildTimer.GetMilliseconds(), tree, extent);
+            }
+
+            {
+                b2DynamicTree tree;
+
+                b2Timer timer;
+                tree.CreateProxies(aabbs.data(), userData.data(), count, proxyIds.data());
+                measureTree(layoutNames[l], count, "bulk", timer.GetMilliseconds(), tree, extent);
+            }
+        }
+    }
+}
+
+static bool sameSnapshot(b2World* a, b2World* b)
+{
+    std::vector<char> dataA(a->SaveSnapshot(nullptr, 0));
+    std::vector<char> dataB(b->SaveSnapshot(nullptr, 0));
+    a->SaveSnapshot(dataA.data(), (int32)dataA.size());
+    b->SaveSnapshot(dataB.data(), (int32)dataB.size());
+    return dataA == dataB;
+}
+
+// compares building each scene with the b2World API to saving and loading a snapshot
+// of it, then steps the original and the copy and checks they stay identical
+static void runSnapshotBenchmark(const std::vector<SceneType>& scenes, const std::vector<int>& counts,
+    int stepCount, float dt, int velocityIterations, int positionIterations)
+{
+    printf("%-10s %8s %10s %9s %9s %9s %6s\n", "scene", "bodies", "bytes", "create_ms", "save_ms", "load_ms", "exact");
+
+    for (SceneType scene : scenes)
+    {
+        for (int count : counts)
+        {
+            b2World world(b2Vec2(0.0f, -10.0f));
+
+            b2Timer createTimer;
+            createScene(&world, scene, count);
+            float createTime = createTimer.GetMilliseconds();
+
+            // a settled scene has contacts and warm starting impulses to save
+            for (int i = 0; i < 10; i++)
+            {
+                world.Step(dt, velocityIterations, positionIterations);
+            }
+
+            b2Timer saveTimer;
+            std::vector<char> data(world.SaveSnapshot(nullptr, 0));
+            world.SaveSnapshot(data.data(), (int32)data.size());
+            float saveTime = saveTimer.GetMilliseconds();
+
+            b2World copy(b2Vec2(0.0f, 0.0f));
+
+            b2Timer loadTimer;
+            bool loaded = copy.LoadSnapshot(data.data(), (int32)data.size());
+            float loadTime = loadTimer.GetMilliseconds();
+
+            for (int i = 0; i < stepCount; i++)
+            {
+                world.Step(dt, velocityIterations, positionIterations);
+                copy.Step(dt, velocityIterations, positionIterations);
+            }
+
+            bool exact = loaded && sameSnapshot(&world, &copy);
+
+            printf("%-10s %8d %10d %9.3f %9.3f %9.3f %6s\n", getSceneName(scene), world.GetBodyCount(),
+                (int)data.size(), createTime, saveTime, loadTime, exact ? "yes" : "no");
+            fflush(stdout);
+        }
+    }
+}
+
+struct ClosestRayCallback : public b2RayCastCallback
+{
+    b2Fixture* fixture = nullptr;
+
+    float ReportFixture(b2Fixture* f, const b2Vec2& point, const b2Vec2& normal, float fraction) override
+    {
+        (void)point;
+        (void)normal;
+        fixture = f;
+        return fraction;
+    }
+};
+
+// line of sight rays between random pairs of bodies, like an AI pass over the scene,
+// cast one by one through b2World::RayCast and as one batch with b2World::RayCastClosest
+static void runRayCastBenchmark(const std::vector<SceneType>& scenes, const std::vector<int>& counts,
+    const std::vector<int>& threadCounts, int rayCount, float dt, int velocityIterations, int positionIterations)
+{
+    printf("%-10s %8s %7s %7s %11s %9s %8s %6s\n", "scene", "bodies", "rays", "threads", "callback_ms", "batch_ms", "speedup", "same");
+
+    for (SceneType scene : scenes)
+    {
+        for (int count : counts)
+        {
+            b2World world(b2Vec2(0.0f, -10.0f));
+            createScene(&world, scene, count);
+
+            for (int i = 0; i < 10; i++)
+            {
+                world.Step(dt, velocityIterations, positionIterations);
+            }
+
+            std::vector<b2Vec2> positions;
+            for (b2Body* b = world.GetBodyList(); b; b = b->GetNext())
+            {
+                positions.push_back(b->GetPosition());
+            }
+
+            // nearby bodies look at each other more often than far ones
+            uint32 seed = 4242;
+            std::vector<b2RayCastInput> rays;
+            while ((int)rays.size() < rayCount)
+            {
+                int a = (int)(treeRandom(&seed, 0.0f, (float)positions.size() - 1.0f));
+                int b = std::min(a + (int)treeRandom(&seed, 1.0f, 200.0f), (int)positions.size() - 1);
+
+                b2RayCastInput ray;
+                ray.p1 = positions[a] + b2Vec2(0.0f, 1.0f);
+                ray.p2 = positions[b] + b2Vec2(0.0f, 1.0f);
+                ray.maxFraction = 1.0f;
+                if (b2DistanceSquared(ray.p1, ray.p2) > 0.0f) rays.push_back(ray);
+            }
+
+            std::vector<b2Fixture*> callbackHits(rays.size());
+            b2Timer callbackTimer;
+            for (size_t i = 0; i < rays.size(); i++)
+            {
+                ClosestRayCallback callback;
+                world.RayCast(&callback, rays[i].p1, rays[i].p2);
+                callbackHits[i] = callback.fixture;
+            }
+            float callbackTime = callbackTimer.GetMilliseconds();
+
+            for (int threadCount : threadCounts)
+            {
+                world.SetThreadCount(std::max(threadCount, 1));
+
+                std::vector<b2RayCastHit> hits(rays.size());
+                b2Timer batchTimer;
+                world.RayCastClosest(rays.data(), (int32)rays.size(), hits.data(), 0xFFFF);
+                float batchTime = batchTimer.GetMilliseconds();
+
+                bool same = true;
+                for (size_t i = 0; i < rays.size(); i++)
+                {
+                    same = same && hits[i].fixture == callbackHits[i];
+                }
+
+                printf("%-10s %8d %7d %7d %11.3f %9.3f %8.2f %6s\n", getSceneName(scene), world.GetBodyCount(),
+                    (int)rays.size(), world.GetThreadCount(), callbackTime, batchTime,
+                    batchTime > 0.0f ? callbackTime / batchTime : 0.0f, same ? "yes" : "no");
+                fflush(stdout);
+            }
+        }
+    }
+}
+
+// steps the recorded world with the recorded inputs, the per-step hashes of two builds
+// match as long as they simulate bit-exactly
+static int runReplay(const char* path, int threadCount, const char* csvPath)
+{
+    InputLog log;
+    if (!log.load(path))
+    {
+        std::cerr << "could not load input log: " << path << std::endl;
+        return 1;
+    }
+
+    // built like the viewer builds it
+    b2World world(b2Vec2(0.0f, -10.0f));
+    createScene(&world, log.scene, log.bodyCount);
+    if (!log.worldPath.empty() && !loadWorldFile(&world, log.worldPath.c_str()))
+    {
+        std::cerr << "could not load world: " << log.worldPath << std::endl;
+        return 1;
+    }
+
+    world.SetThreadCount(threadCount);
+    world.SetContactSolverWidth(log.solverWidth);
+
+    InputController inputs;
+    std::vector<float> stepTimes(log.stepCount);
+    std::vector<uint64_t> hashes(log.stepCount);
+    size_t nextEvent = 0;
+
+    for (uint32_t step = 0; step < log.stepCount; step++)
+    {
+        while (nextEvent < log.events.size() && log.events[nextEvent].step == step)
+        {
+            inputs.apply(&world, log.events[nextEvent]);
+            nextEvent++;
+        }
+
+        world.Step(log.timeStep, log.velocityIterations, log.positionIterations);
+        stepTimes[step] = world.GetProfile().step;
+        hashes[step] = hashWorldState(&world);
+    }
+
+    if (csvPath)
+    {
+        FILE* file = fopen(csvPath, "w");
+        if (file == nullptr)
+        {
+            std::cerr << "could not open " << csvPath << std::endl;
+            return 1;
+        }
+
+        fprintf(file, "step,step_ms,hash\n");
+        for (uint32_t step = 0; step < log.stepCount; step++)
+        {
+            fprintf(file, "%u,%.4f,%016llx\n", step, stepTimes[step], (unsigned long long)hashes[step]);
+        }
+
+        fclose(file);
+    }
+
+    printf("%-10s %8s %6s %6s %7s %9s %9s %9s %9s %16s\n",
+        "scene", "bodies", "steps", "events", "threads", "mean", "p50", "p99", "max", "hash");
+
+    float total = 0.0f;
+    for (float t : stepTimes) total += t;
+
+    std::vector<float> sorted = stepTimes;
+    std::sort(sorted.begin(), sorted.end());
+    bool empty = sorted.empty();
+
+    printf("%-10s %8d %6u %6d %7d %9.3f %9.3f %9.3f %9.3f %016llx\n",
+        log.worldPath.empty() ? getSceneName(log.scene) : "file", world.GetBodyCount(), log.stepCount,
+        (int)log.events.size(), world.GetThreadCount(),
+        empty ? 0.0f : total / (float)sorted.size(), empty ? 0.0f : percentile(sorted, 0.5f),
+        empty ? 0.0f : percentile(sorted, 0.99f), empty ? 0.0f : sorted.back(),
+        (unsigned long long)hashWorldState(&world));
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<SceneType> scenes;
+    std::vector<int> bodyCounts;
+    std::vector<int> threadCounts;
+    std::vector<int> solverWidths;
+    int stepCount = 500;
+    int warmupCount = 0;
+    float dt = 1.0f / 60.0f;
+    int velocityIterations = 8;
+    int positionIterations = 3;
+    const char* csvPath = nullptr;
+    const char* jsonPath = nullptr;
+    bool treeBenchmark = false;
+    bool snapshotBenchmark = false;
+    bool rayCastBenchmark = false;
+    int rayCount = 20000;
+    MemoryOptions memory;
+    const char* replayPath = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--steps" && hasValue) stepCount = atoi(argv[++i]);
+        else if (arg == "--warmup" && hasValue) warmupCount = atoi(argv[++i]);
+        else if (arg == "--dt" && hasValue) dt = (float)atof(argv[++i]);
+        else if (arg == "--velocity-iterations" && hasValue) velocityIterations = atoi(argv[++i]);
+        else if (arg == "--position-iterations" && hasValue) positionIterations = atoi(argv[++i]);
+        else if (arg == "--tree") treeBenchmark = true;
+        else if (arg == "--snapshot") snapshotBenchmark = true;
+        else if (arg == "--raycast") rayCastBenchmark = true;
+        else if (arg == "--rays" && hasValue) rayCount = atoi(argv[++i]);
+        else if (arg == "--stack-size" && hasValue) memory.stackSize = atoi(argv[++i]) * 1024;
+        else if (arg == "--arena" && hasValue) memory.arenaSize = atoi(argv[++i]) * 1024 * 1024;
+        else if (arg == "--huge-pages") memory.hugePages = true;
+        else if (arg == "--replay" && hasValue) replayPath = argv[++i];
+        else if (arg == "--csv" && hasValue) csvPath = argv[++i];
+        else if (arg == "--json" && hasValue) jsonPath = argv[++i];
+        else if (arg == "--bodies" && hasValue) parseList(argv[++i], &bodyCounts);
+        else if (arg == "--threads" && hasValue) parseList(argv[++i], &threadCounts);
+        else if (arg == "--solver-width" && hasValue) parseList(argv[++i], &solverWidths);
+        else if (arg == "--scene" && hasValue)
+        {
+            SceneType scene;
+            if (std::string(argv[++i]) != "all" && !findScene(argv[i], &scene))
+            {
+                std::cerr << "unknown scene: " << argv[i] << std::endl;
+                return 1;
+            }
+
+            if (std::string(argv[i]) != "all") scenes.push_back(scene);
+        }
+        else
+        {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (scenes.empty())
+    {
+        for (int i = (int)SceneType::pyramids; i < (int)SceneType::count; i++)
+        {
+            scenes.push_back((SceneType)i);
+        }
+    }
+
+    if (bodyCounts.empty())
+    {
+        bodyCounts.push_back(1000);
+        bodyCounts.push_back(10000);
+    }
+
+    if (treeBenchmark)
+    {
+        runTreeBenchmark(bodyCounts);
+        return 0;
+    }
+
+    if (snapshotBenchmark)
+    {
+        runSnapshotBenchmark(scenes, bodyCounts, stepCount, dt, velocityIterations, positionIterations);
+        return 0;
+    }
+
+    if (threadCounts.empty())
+    {
+        threadCounts.push_back(1);
+    }
+
+    if (replayPath)
+    {
+        return runReplay(replayPath, std::max(threadCounts[0], 1), csvPath);
+    }
+
+    if (rayCastBenchmark)
+    {
+        runRayCastBenchmark(scenes, bodyCounts, threadCounts, rayCount, dt, velocityIterations, positionIterations);
+        return 0;
+    }
+
+    if (solverWidths.empty())
+    {
+        solverWidths.push_back(1);
+    }
+
+    std::vector<BenchmarkResult> results;
+
+    printf("%-10s %8s %6s %7s %5s %9s %9s %9s %9s %9s %9s %9s %9s %9s",
+        "scene", "bodies", "steps", "threads", "width", "mean", "p50", "p99", "max", "collide", "solve", "toi",
+        "stack_kb", "overflows");
+    if (memory.arenaSize > 0) printf(" %9s %9s %10s", "arena_kb", "free_kb", "arena_ovf");
+    printf("\n");
+
+    for (SceneType scene : scenes)
+    {
+        for (int bodyCount : bodyCounts)
+        {
+            for (int threadCount : threadCounts)
+            {
+                for (int solverWidth : solverWidths)
+                {
+                    BenchmarkResult r = runBenchmark(scene, bodyCount, std::max(threadCount, 1), solverWidth,
+                        warmupCount, stepCount, dt, velocityIterations, positionIterations, memory);
+                    results.push_back(r);
+
+                    printf("%-10s %8d %6d %7d %5d %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %9d %9d",
+                        getSceneName(r.scene), r.bodyCount, r.stepCount, r.threadCount, r.solverWidth,
+                        r.mean, r.p50, r.p99, r.max, r.profile.collide, r.profile.solve, r.profile.solveTOI,
+                        (r.memory.peakStackBytes + 1023) / 1024, r.memory.stackOverflowCount);
+                    if (memory.arenaSize > 0)
+                    {
+                        printf(" %9d %9d %10d", (r.arenaUsed + 1023) / 1024, (r.arenaFreeBytes + 1023) / 1024,
+                            r.arenaOverflowCount);
+                    }
+                    printf("\n");
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+
+    if (csvPath) writeCsv(csvPath, results);
+    if (jsonPath) writeJson(jsonPath, results);
+
+    return 0;
+}
\ No newline at end of file
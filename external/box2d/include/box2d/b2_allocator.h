@@ -0,0 +1,179 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_ALLOCATOR_H
+#define B2_ALLOCATOR_H
+
+#include "b2_api.h"
+#include "b2_settings.h"
+
+#include <mutex>
+
+/// Implement this class to give a world's block and stack allocators their memory
+/// from an arena, huge pages or your own heap, see b2World::b2World. It provides
+/// the chunks of the block allocator, objects too large for a block, the stacks
+/// and the stack allocations that don't fit. Allocate and Free are called from the
+/// worker threads when a worker's stack overflows, so they must be thread safe if
+/// the world uses more than one thread.
+class B2_API b2Allocator
+{
+public:
+	virtual ~b2Allocator() {}
+
+	/// Allocate size bytes, aligned like malloc.
+	virtual void* Allocate(int32 size) = 0;
+
+	/// Free memory returned by Allocate.
+	/// @param size the size that was allocated.
+	virtual void Free(void* mem, int32 size) = 0;
+};
+
+/// Allocate from an allocator, nullptr stands for b2Alloc.
+inline void* b2Allocate(b2Allocator* allocator, int32 size)
+{
+	return allocator ? allocator->Allocate(size) : b2Alloc(size);
+}
+
+/// Free memory from b2Allocate.
+inline void b2Deallocate(b2Allocator* allocator, void* mem, int32 size)
+{
+	if (allocator)
+	{
+		allocator->Free(mem, size);
+	}
+	else
+	{
+		b2Free(mem);
+	}
+}
+
+/// Hands out memory from one block that is reserved up front. Freeing the most recent
+/// allocation gives its memory back to the arena. Other freed memory is kept in free lists
+/// by size and reused by later allocations, a larger free block is split. Free blocks
+/// are not merged. Allocations that don't fit in the arena use b2Alloc and are counted.
+class B2_API b2ArenaAllocator : public b2Allocator
+{
+public:
+	/// @param capacity the size of the arena in bytes.
+	/// @param hugePages back the arena with huge pages where the system supports it,
+	/// otherwise normal pages are used.
+	b2ArenaAllocator(int32 capacity, bool hugePages = false);
+	~b2ArenaAllocator() override;
+
+	void* Allocate(int32 size) override;
+	void Free(void* mem, int32 size) override;
+
+	/// The size of the arena in bytes.
+	int32 GetCapacity() const
+	{
+		return m_capacity;
+	}
+
+	/// The bytes in use, from the start of the arena to the most recent allocation.
+	int32 GetUsed() const
+	{
+		return m_used;
+	}
+
+	/// The number of allocations that didn't fit and used b2Alloc.
+	int32 GetOverflowCount() const
+	{
+		return m_overflowCount;
+	}
+
+	/// The bytes of freed memory in the free lists, they are part of GetUsed.
+	int32 GetFreeBytes() const
+	{
+		return m_freeBytes;
+	}
+
+	/// Is the arena backed by huge pages.
+	bool UsesHugePages() const
+	{
+		return m_hugePages;
+	}
+
+private:
+
+	enum
+	{
+		// Free lists by the highest bit of the block size.
+		e_freeListCount = 32
+	};
+
+	struct b2FreeBlock
+	{
+		b2FreeBlock* next;
+		int32 size;
+	};
+
+	void AddFreeBlock(char* mem, int32 size);
+
+	char* m_data;
+	int32 m_capacity;
+	int32 m_used;
+	int32 m_freeBytes;
+	int32 m_overflowCount;
+	b2FreeBlock* m_freeLists[e_freeListCount];
+	int32 m_mappedSize;
+	bool m_hugePages;
+	std::mutex m_mutex;
+};
+
+/// Memory use of a world's allocators, see b2World::GetAllocatorStats.
+struct B2_API b2AllocatorStats
+{
+	/// Chunks of the block allocator.
+	int32 chunkCount;
+
+	/// Size of the chunks in bytes.
+	int32 chunkBytes;
+
+	/// Bytes of the blocks in use, rounded up to the block sizes.
+	int32 blockBytes;
+
+	/// Highest blockBytes so far.
+	int32 peakBlockBytes;
+
+	/// The share of the chunks that is in free blocks, from 0 to 1.
+	float fragmentation;
+
+	/// Objects too large for a block, they are allocated one by one.
+	int32 largeCount;
+	int32 largeBytes;
+
+	/// Size of each stack in bytes, the world has one and each worker thread has one.
+	int32 stackSize;
+
+	/// Highest use of any stack in bytes, including the allocations that didn't fit.
+	/// A stack this large never overflows.
+	int32 peakStackBytes;
+
+	/// Stack allocations that didn't fit in their stack.
+	int32 stackOverflowCount;
+
+	/// Buffers that are kept from step to step and grow with the world: the islands, the
+	/// solver arrays, the contact updates and the broad-phase pairs and moves.
+	int32 bufferBytes;
+};
+
+#endif
@@ -30,6 +30,7 @@ const int32 b2_blockSizeCount = 14;
 
 struct b2Block;
 struct b2Chunk;
+class b2Allocator;
 
 /// This is a small object allocator used for allocating small
 /// objects that persist for more than one time step.
@@ -37,24 +38,45 @@ struct b2Chunk;
 class B2_API b2BlockAllocator
 {
 public:
-	b2BlockAllocator();
+	/// @param allocator provides the chunks and the objects larger than b2_maxBlockSize,
+	/// nullptr uses b2Alloc.
+	b2BlockAllocator(b2Allocator* allocator = nullptr);
 	~b2BlockAllocator();
 
-	/// Allocate memory. This will use b2Alloc if the size is larger than b2_maxBlockSize.
+	/// Allocate memory. This will use the allocator if the size is larger than b2_maxBlockSize.
 	void* Allocate(int32 size);
 
-	/// Free memory. This will use b2Free if the size is larger than b2_maxBlockSize.
+	/// Free memory. This will use the allocator if the size is larger than b2_maxBlockSize.
 	void Free(void* p, int32 size);
 
 	void Clear();
 
+	/// The number of chunks and their size in bytes.
+	int32 GetChunkCount() const;
+	int32 GetChunkBytes() const;
+
+	/// The bytes of the blocks in use, rounded up to the block sizes, and the most there were.
+	int32 GetBlockBytes() const;
+	int32 GetMaxBlockBytes() const;
+
+	/// The objects larger than b2_maxBlockSize in use and their size in bytes.
+	int32 GetLargeCount() const;
+	int32 GetLargeBytes() const;
+
 private:
 
+	b2Allocator* m_allocator;
+
 	b2Chunk* m_chunks;
 	int32 m_chunkCount;
 	int32 m_chunkSpace;
 
 	b2Block* m_freeLists[b2_blockSizeCount];
+
+	int32 m_blockBytes;
+	int32 m_maxBlockBytes;
+	int32 m_largeCount;
+	int32 m_largeBytes;
 };
 
 #endif
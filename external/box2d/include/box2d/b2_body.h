@@ -31,6 +31,7 @@ class b2Fixture;
 class b2Joint;
 class b2Contact;
 class b2Controller;
+class b2Snapshot;
 class b2World;
 struct b2FixtureDef;
 struct b2JointEdge;
@@ -393,6 +394,7 @@ private:
 	friend class b2ContactManager;
 	friend class b2ContactSolver;
 	friend class b2Contact;
+	friend struct b2WorldDebugDrawWrapper;
 
 	friend class b2DistanceJoint;
 	friend class b2FrictionJoint;
@@ -429,12 +431,27 @@ private:
 
 	void Advance(float t);
 
+	// Save or load the members of a world snapshot. Fixtures and lists are handled by b2World.
+	void Snapshot(b2Snapshot* snapshot);
+
 	b2BodyType m_type;
 
 	uint16 m_flags;
 
 	int32 m_islandIndex;
 
+	// The persistent island of a dynamic or kinematic body, b2_nullIsland for static and
+	// disabled bodies. The bodies of an island are linked through these.
+	int32 m_islandId;
+	b2Body* m_islandPrev;
+	b2Body* m_islandNext;
+
+	// Older bodies have lower values, islands are searched from their oldest body.
+	uint32 m_creationIndex;
+
+	// The culled DebugDraw that last visited the body, see b2World::m_drawStamp.
+	uint32 m_drawStamp;
+
 	b2Transform m_xf;		// the body origin transform
 	b2Sweep m_sweep;		// the swept motion for CCD
 
@@ -634,29 +651,6 @@ inline bool b2Body::IsBullet() const
 	return (m_flags & e_bulletFlag) == e_bulletFlag;
 }
 
-inline void b2Body::SetAwake(bool flag)
-{
-	if (m_type == b2_staticBody)
-	{
-		return;
-	}
-
-	if (flag)
-	{
-		m_flags |= e_awakeFlag;
-		m_sleepTime = 0.0f;
-	}
-	else
-	{
-		m_flags &= ~e_awakeFlag;
-		m_sleepTime = 0.0f;
-		m_linearVelocity.SetZero();
-		m_angularVelocity = 0.0f;
-		m_force.SetZero();
-		m_torque = 0.0f;
-	}
-}
-
 inline bool b2Body::IsAwake() const
 {
 	return (m_flags & e_awakeFlag) == e_awakeFlag;
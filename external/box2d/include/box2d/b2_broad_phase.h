@@ -34,6 +34,10 @@ struct B2_API b2Pair
 	int32 proxyIdB;
 };
 
+class b2Allocator;
+class b2Snapshot;
+class b2ThreadPool;
+
 /// The broad-phase is used for computing pairs and performing volume queries and ray casts.
 /// This broad-phase does not persist pairs. Instead, this reports potentially new pairs.
 /// It is up to the client to consume the new pairs and to track subsequent overlap.
@@ -46,13 +50,20 @@ public:
 		e_nullProxy = -1
 	};
 
-	b2BroadPhase();
+	/// @param allocator gives the pair and move buffers their memory, nullptr uses b2Alloc.
+	/// The tree still uses b2Alloc.
+	b2BroadPhase(b2Allocator* allocator = nullptr);
 	~b2BroadPhase();
 
 	/// Create a proxy with an initial AABB. Pairs are not reported until
 	/// UpdatePairs is called.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
 
+	/// Create many proxies at once with a top-down build of the tree. Pairs are not
+	/// reported until UpdatePairs is called.
+	/// @param proxyIds receives the id of each proxy.
+	void CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds);
+
 	/// Destroy a proxy. It is up to the client to remove any pairs.
 	void DestroyProxy(int32 proxyId);
 
@@ -60,6 +71,12 @@ public:
 	/// call UpdatePairs to finalized the proxy pairs (for your time step).
 	void MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
 
+	/// Let MoveProxy refit the ancestors of a proxy that left its fat AABB instead of
+	/// re-inserting it, see b2DynamicTree::RefitProxy. The tree gets worse as proxies
+	/// travel, call RebuildTree from time to time. Off by default.
+	void SetRefitProxies(bool flag) { m_refitProxies = flag; }
+	bool GetRefitProxies() const { return m_refitProxies; }
+
 	/// Call to trigger a re-processing of it's pairs on the next call to UpdatePairs.
 	void TouchProxy(int32 proxyId);
 
@@ -94,6 +111,10 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
+	/// Ray-cast a packet of rays together, see b2DynamicTree::RayCastPacket.
+	template <typename T>
+	void RayCastPacket(T* callback, const b2RayCastInput* inputs, int32 count) const;
+
 	/// Get the height of the embedded tree.
 	int32 GetTreeHeight() const;
 
@@ -103,11 +124,29 @@ public:
 	/// Get the quality metric of the embedded tree.
 	float GetTreeQuality() const;
 
+	/// Run the tree queries of UpdatePairs on a thread pool. The pairs are reported
+	/// in the same order as without one. Pass nullptr to query on the calling thread.
+	void SetThreadPool(b2ThreadPool* threadPool);
+
+	/// Rebuild the embedded tree top-down. Proxy ids are kept.
+	void RebuildTree();
+
+	/// The bytes of the pair and move buffers, they are kept from step to step.
+	int32 GetBufferBytes() const;
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
 	void ShiftOrigin(const b2Vec2& newOrigin);
 
+	/// Save or load the tree and the move buffer for a world snapshot. Loaded proxies
+	/// have null user data until it is restored with RestoreUserData.
+	void Snapshot(b2Snapshot* snapshot);
+
+	/// Set the user data of a loaded proxy.
+	/// @return false if the id is not a proxy of the tree or already has user data.
+	bool RestoreUserData(int32 proxyId, void* userData);
+
 private:
 
 	friend class b2DynamicTree;
@@ -117,7 +156,31 @@ private:
 
 	bool QueryCallback(int32 proxyId);
 
+	// Fill the pair buffer with the pairs of the moved proxies.
+	void FindNewPairs();
+	void FindNewPairsParallel();
+	static void FindPairsTask(int32 begin, int32 end, int32 workerIndex, void* context);
+
+	// Pairs found by one worker thread. Workers append to their own buffer,
+	// which is kept on separate cache lines.
+	struct b2WorkerPairs
+	{
+		b2Pair* pairs;
+		int32 count;
+		int32 capacity;
+		char padding[64 - sizeof(b2Pair*) - 2 * sizeof(int32)];
+	};
+
+	// Where the pairs of a move buffer entry ended up.
+	struct b2MovePairs
+	{
+		int32 workerIndex;
+		int32 begin;
+		int32 count;
+	};
+
 	b2DynamicTree m_tree;
+	b2Allocator* m_allocator;
 
 	int32 m_proxyCount;
 
@@ -130,6 +193,14 @@ private:
 	int32 m_pairCount;
 
 	int32 m_queryProxyId;
+
+	bool m_refitProxies;
+
+	b2ThreadPool* m_threadPool;
+	b2WorkerPairs* m_workerPairs;
+	int32 m_workerCount;
+	b2MovePairs* m_movePairs;
+	int32 m_movePairCapacity;
 };
 
 inline void* b2BroadPhase::GetUserData(int32 proxyId) const
@@ -169,28 +240,16 @@ inline float b2BroadPhase::GetTreeQuality() const
 	return m_tree.GetAreaRatio();
 }
 
+inline void b2BroadPhase::RebuildTree()
+{
+	m_tree.RebuildTopDown();
+}
+
 template <typename T>
 void b2BroadPhase::UpdatePairs(T* callback)
 {
-	// Reset pair buffer
-	m_pairCount = 0;
-
 	// Perform tree queries for all moving proxies.
-	for (int32 i = 0; i < m_moveCount; ++i)
-	{
-		m_queryProxyId = m_moveBuffer[i];
-		if (m_queryProxyId == e_nullProxy)
-		{
-			continue;
-		}
-
-		// We have to query the tree with the fat AABB so that
-		// we don't fail to create a pair that may touch later.
-		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
-
-		// Query tree, create pairs and add them pair buffer.
-		m_tree.Query(this, fatAABB);
-	}
+	FindNewPairs();
 
 	// Send pairs to caller
 	for (int32 i = 0; i < m_pairCount; ++i)
@@ -230,6 +289,12 @@ inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input) cons
 	m_tree.RayCast(callback, input);
 }
 
+template <typename T>
+inline void b2BroadPhase::RayCastPacket(T* callback, const b2RayCastInput* inputs, int32 count) const
+{
+	m_tree.RayCastPacket(callback, inputs, count);
+}
+
 inline void b2BroadPhase::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	m_tree.ShiftOrigin(newOrigin);
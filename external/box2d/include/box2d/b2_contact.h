@@ -36,6 +36,7 @@ class b2World;
 class b2BlockAllocator;
 class b2StackAllocator;
 class b2ContactListener;
+class b2Snapshot;
 
 /// Friction mixing law. The idea is to allow either fixture to drive the friction to zero.
 /// For example, anything slides on ice.
@@ -191,7 +192,14 @@ protected:
 		e_bulletHitFlag		= 0x0010,
 
 		// This contact has a valid TOI in m_toi
-		e_toiFlag			= 0x0020
+		e_toiFlag			= 0x0020,
+
+		// Set while the contact is touching and has no sensor, it then connects the islands
+		// of its bodies.
+		e_linkedFlag		= 0x0040,
+
+		// Set while the contact is in the TOI event list of b2World::SolveTOI
+		e_toiEventFlag		= 0x0080
 	};
 
 	/// Flag this contact for filtering. Filtering will occur the next time step.
@@ -210,6 +218,16 @@ protected:
 
 	void Update(b2ContactListener* listener);
 
+	// The two halves of Update. UpdateManifold only writes this contact's manifold
+	// and can run in parallel with other contacts. FinishUpdate changes the flags,
+	// wakes the bodies and calls the listener.
+	bool UpdateManifold(b2Manifold* oldManifold);
+	void FinishUpdate(bool touching, const b2Manifold* oldManifold, b2ContactListener* listener);
+
+	// Save or load the flags, the manifold with its warm starting impulses and the mixed
+	// material of a world snapshot. The fixtures and lists are handled by b2World.
+	void Snapshot(b2Snapshot* snapshot);
+
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 	static bool s_initialized;
 
@@ -234,6 +252,9 @@ protected:
 	int32 m_toiCount;
 	float m_toi;
 
+	// Contact list position while solving TOI events, breaks ties between equal TOIs.
+	int32 m_toiIndex;
+
 	float m_friction;
 	float m_restitution;
 	float m_restitutionThreshold;
@@ -27,15 +27,20 @@
 #include "b2_broad_phase.h"
 
 class b2Contact;
+class b2Allocator;
 class b2ContactFilter;
 class b2ContactListener;
 class b2BlockAllocator;
+class b2StackAllocator;
+class b2ThreadPool;
+struct b2ContactUpdate;
 
 // Delegate of b2World.
 class B2_API b2ContactManager
 {
 public:
-	b2ContactManager();
+	b2ContactManager(b2Allocator* allocator = nullptr);
+	~b2ContactManager();
 
 	// Broad-phase callback.
 	void AddPair(void* proxyUserDataA, void* proxyUserDataB);
@@ -46,12 +51,31 @@ public:
 
 	void Collide();
 
+	// Collide with the manifolds evaluated on the thread pool.
+	void CollideParallel();
+	static void UpdateManifolds(int32 begin, int32 end, int32 workerIndex, void* context);
+
+	// Filter a contact flagged with e_filterFlag and clear the flag.
+	// @return false if the contact must be destroyed.
+	bool FilterContact(b2Contact* c);
+
+	// The bytes of the buffers kept from step to step, including the broad-phase.
+	int32 GetBufferBytes() const;
+
 	b2BroadPhase m_broadPhase;
 	b2Contact* m_contactList;
 	int32 m_contactCount;
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2BlockAllocator* m_allocator;
+	b2StackAllocator* m_stackAllocator;
+	b2ThreadPool* m_threadPool;
+
+	// Kept from step to step by CollideParallel, it grows with the contact count. The
+	// memory comes from m_bufferAllocator, the allocator of the world.
+	b2Allocator* m_bufferAllocator;
+	b2ContactUpdate* m_updateBuffer;
+	int32 m_updateCapacity;
 };
 
 #endif
@@ -140,6 +140,7 @@ protected:
 	void InitVelocityConstraints(const b2SolverData& data) override;
 	void SolveVelocityConstraints(const b2SolverData& data) override;
 	bool SolvePositionConstraints(const b2SolverData& data) override;
+	void Snapshot(b2Snapshot* snapshot) override;
 
 	float m_stiffness;
 	float m_damping;
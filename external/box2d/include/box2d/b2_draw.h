@@ -26,6 +26,8 @@
 #include "b2_api.h"
 #include "b2_math.h"
 
+class b2Body;
+
 /// Color for debug drawing. Each value has the range [0,1].
 struct B2_API b2Color
 {
@@ -58,7 +60,8 @@ public:
 		e_jointBit				= 0x0002,	///< draw joint connections
 		e_aabbBit				= 0x0004,	///< draw axis aligned bounding boxes
 		e_pairBit				= 0x0008,	///< draw broad-phase pairs
-		e_centerOfMassBit		= 0x0010	///< draw center of mass frame
+		e_centerOfMassBit		= 0x0010,	///< draw center of mass frame
+		e_bodyTransformBit		= 0x0020	///< draw bodies with GetBodyTransform
 	};
 
 	/// Set the drawing flags.
@@ -95,6 +98,12 @@ public:
 	/// Draw a point.
 	virtual void DrawPoint(const b2Vec2& p, float size, const b2Color& color) = 0;
 
+	/// Get the transform a body is drawn with, only called when e_bodyTransformBit is set.
+	/// The default is the current body transform. Override this to draw bodies somewhere
+	/// else, for example interpolated between the last two time steps when the simulation
+	/// runs at a fixed rate.
+	virtual b2Transform GetBodyTransform(const b2Body* body) const;
+
 protected:
 	uint32 m_drawFlags;
 };
@@ -29,6 +29,11 @@
 
 #define b2_nullNode (-1)
 
+/// The most rays b2DynamicTree::RayCastPacket casts together.
+#define b2_maxRayPacketSize 32
+
+class b2Snapshot;
+
 /// A node in the dynamic tree. The client does not interact with this directly.
 struct B2_API b2TreeNode
 {
@@ -77,6 +82,13 @@ public:
 	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
 
+	/// Create many proxies at once. The whole tree is rebuilt with RebuildTopDown,
+	/// which is much faster than inserting the proxies one at a time and gives a better tree.
+	/// @param aabbs the tight fitting AABB of each proxy.
+	/// @param userData the user data of each proxy.
+	/// @param proxyIds receives the id of each proxy.
+	void CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds);
+
 	/// Destroy a proxy. This asserts if the id is invalid.
 	void DestroyProxy(int32 proxyId);
 
@@ -86,6 +98,12 @@ public:
 	/// @return true if the proxy was re-inserted.
 	bool MoveProxy(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
 
+	/// Move a proxy like MoveProxy, but only refit the AABBs of its ancestors instead of
+	/// re-inserting it. This is cheaper and keeps the tree structure, so the tree gets
+	/// worse as proxies travel. Call RebuildTopDown from time to time.
+	/// @return true if the fat AABB of the proxy changed.
+	bool RefitProxy(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
+
 	/// Get proxy user data.
 	/// @return the proxy user data or 0 if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
@@ -111,6 +129,16 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
+	/// Ray-cast a packet of rays together. Each node is tested against all rays of the packet
+	/// while it is in cache, so rays that start close together and point the same way share
+	/// most of the traversal. Each ray sees the proxies in the same order as with RayCast.
+	/// The callback is called with the index of the ray in the packet:
+	/// float RayCastCallback(const b2RayCastInput& input, int32 proxyId, int32 rayIndex)
+	/// and its return value clips or terminates that ray like for RayCast.
+	/// @param inputs the rays, at most b2_maxRayPacketSize.
+	template <typename T>
+	void RayCastPacket(T* callback, const b2RayCastInput* inputs, int32 count) const;
+
 	/// Validate this tree. For testing.
 	void Validate() const;
 
@@ -128,13 +156,23 @@ public:
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
+	/// Build a new tree from the leaves, splitting them top-down with a binned surface
+	/// area heuristic. This takes O(n log n) time. Proxy ids are kept.
+	void RebuildTopDown();
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
 	void ShiftOrigin(const b2Vec2& newOrigin);
 
+	/// Save or load the node pool for a world snapshot. Proxy ids and the free list
+	/// are kept. User data is not, loaded nodes have null user data.
+	void Snapshot(b2Snapshot* snapshot);
+
 private:
 
+	friend class b2BroadPhase;
+
 	int32 AllocateNode();
 	void FreeNode(int32 node);
 
@@ -143,6 +181,8 @@ private:
 
 	int32 Balance(int32 index);
 
+	int32 PartitionLeaves(int32* leaves, b2Vec2* centers, int32 count, b2AABB* bounds) const;
+
 	int32 ComputeHeight() const;
 	int32 ComputeHeight(int32 nodeId) const;
 
@@ -305,4 +345,144 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 	}
 }
 
+template <typename T>
+inline void b2DynamicTree::RayCastPacket(T* callback, const b2RayCastInput* inputs, int32 count) const
+{
+	b2Assert(0 < count && count <= b2_maxRayPacketSize);
+
+	struct b2PacketRay
+	{
+		b2Vec2 p1;
+		b2Vec2 d;
+		b2Vec2 v;
+		b2Vec2 abs_v;
+		float maxFraction;
+		b2AABB segmentAABB;
+	};
+
+	struct b2PacketEntry
+	{
+		int32 nodeId;
+		uint32 mask;
+	};
+
+	b2PacketRay rays[b2_maxRayPacketSize];
+	uint32 active = 0;
+
+	// The union of the segment bounds rejects nodes for the whole packet. It is not
+	// shrunk when rays get clipped.
+	b2AABB packetAABB;
+	packetAABB.lowerBound.Set(b2_maxFloat, b2_maxFloat);
+	packetAABB.upperBound.Set(-b2_maxFloat, -b2_maxFloat);
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2PacketRay* ray = rays + i;
+		ray->p1 = inputs[i].p1;
+		ray->d = inputs[i].p2 - inputs[i].p1;
+		b2Vec2 r = ray->d;
+		b2Assert(r.LengthSquared() > 0.0f);
+		r.Normalize();
+
+		// v is perpendicular to the segment.
+		ray->v = b2Cross(1.0f, r);
+		ray->abs_v = b2Abs(ray->v);
+		ray->maxFraction = inputs[i].maxFraction;
+
+		b2Vec2 t = ray->p1 + ray->maxFraction * ray->d;
+		ray->segmentAABB.lowerBound = b2Min(ray->p1, t);
+		ray->segmentAABB.upperBound = b2Max(ray->p1, t);
+
+		packetAABB.Combine(ray->segmentAABB);
+
+		active |= 1u << i;
+	}
+
+	b2GrowableStack<b2PacketEntry, 256> stack;
+	stack.Push({ m_root, active });
+
+	while (stack.GetCount() > 0)
+	{
+		b2PacketEntry entry = stack.Pop();
+		uint32 mask = entry.mask & active;
+		if (entry.nodeId == b2_nullNode || mask == 0)
+		{
+			continue;
+		}
+
+		const b2TreeNode* node = m_nodes + entry.nodeId;
+
+		if (b2TestOverlap(node->aabb, packetAABB) == false)
+		{
+			continue;
+		}
+
+		b2Vec2 c = node->aabb.GetCenter();
+		b2Vec2 h = node->aabb.GetExtents();
+
+		// The rays that reach this node, with the same tests as RayCast.
+		uint32 hitMask = 0;
+		for (int32 i = 0; i < count; ++i)
+		{
+			const b2PacketRay* ray = rays + i;
+			if ((mask & (1u << i)) == 0 || b2TestOverlap(node->aabb, ray->segmentAABB) == false)
+			{
+				continue;
+			}
+
+			// Separating axis for segment (Gino, p80).
+			// |dot(v, p1 - c)| > dot(|v|, h)
+			float separation = b2Abs(b2Dot(ray->v, ray->p1 - c)) - b2Dot(ray->abs_v, h);
+			if (separation <= 0.0f)
+			{
+				hitMask |= 1u << i;
+			}
+		}
+
+		if (hitMask == 0)
+		{
+			continue;
+		}
+
+		if (node->IsLeaf())
+		{
+			for (int32 i = 0; i < count; ++i)
+			{
+				if ((hitMask & (1u << i)) == 0)
+				{
+					continue;
+				}
+
+				b2PacketRay* ray = rays + i;
+
+				b2RayCastInput subInput;
+				subInput.p1 = inputs[i].p1;
+				subInput.p2 = inputs[i].p2;
+				subInput.maxFraction = ray->maxFraction;
+
+				float value = callback->RayCastCallback(subInput, entry.nodeId, i);
+
+				if (value == 0.0f)
+				{
+					// The client has terminated this ray.
+					active &= ~(1u << i);
+				}
+				else if (value > 0.0f)
+				{
+					// Update segment bounding box.
+					ray->maxFraction = value;
+					b2Vec2 t = ray->p1 + value * ray->d;
+					ray->segmentAABB.lowerBound = b2Min(ray->p1, t);
+					ray->segmentAABB.upperBound = b2Max(ray->p1, t);
+				}
+			}
+		}
+		else
+		{
+			stack.Push({ node->child1, hitMask });
+			stack.Push({ node->child2, hitMask });
+		}
+	}
+}
+
 #endif
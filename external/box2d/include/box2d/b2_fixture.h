@@ -32,6 +32,7 @@ class b2BlockAllocator;
 class b2Body;
 class b2BroadPhase;
 class b2Fixture;
+class b2Snapshot;
 
 /// This holds contact filtering data.
 struct B2_API b2Filter
@@ -230,6 +231,10 @@ protected:
 
 	void Synchronize(b2BroadPhase* broadPhase, const b2Transform& xf1, const b2Transform& xf2);
 
+	// Save or load the fixture with its shape and proxies for a world snapshot. Loading
+	// allocates the shape and the proxies like Create, but does not touch the broad-phase.
+	void Snapshot(b2Snapshot* snapshot, b2BlockAllocator* allocator);
+
 	float m_density;
 
 	b2Fixture* m_next;
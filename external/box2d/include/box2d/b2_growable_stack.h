@@ -25,27 +25,29 @@
 
 #include <string.h>
 
+#include "b2_allocator.h"
 #include "b2_settings.h"
 
 /// This is a growable LIFO stack with an initial capacity of N.
-/// If the stack size exceeds the initial capacity, the heap is used
-/// to increase the size of the stack.
+/// If the stack size exceeds the initial capacity, the allocator
+/// (b2Alloc by default) is used to increase the size of the stack.
 template <typename T, int32 N>
 class b2GrowableStack
 {
 public:
-	b2GrowableStack()
+	explicit b2GrowableStack(b2Allocator* allocator = nullptr)
 	{
 		m_stack = m_array;
 		m_count = 0;
 		m_capacity = N;
+		m_allocator = allocator;
 	}
 
 	~b2GrowableStack()
 	{
 		if (m_stack != m_array)
 		{
-			b2Free(m_stack);
+			b2Deallocate(m_allocator, m_stack, m_capacity * sizeof(T));
 			m_stack = nullptr;
 		}
 	}
@@ -55,12 +57,13 @@ public:
 		if (m_count == m_capacity)
 		{
 			T* old = m_stack;
+			int32 oldCapacity = m_capacity;
 			m_capacity *= 2;
-			m_stack = (T*)b2Alloc(m_capacity * sizeof(T));
+			m_stack = (T*)b2Allocate(m_allocator, m_capacity * sizeof(T));
 			memcpy(m_stack, old, m_count * sizeof(T));
 			if (old != m_array)
 			{
-				b2Free(old);
+				b2Deallocate(m_allocator, old, oldCapacity * sizeof(T));
 			}
 		}
 
@@ -80,11 +83,18 @@ public:
 		return m_count;
 	}
 
+	T& operator[](int32 index)
+	{
+		b2Assert(0 <= index && index < m_count);
+		return m_stack[index];
+	}
+
 private:
 	T* m_stack;
 	T m_array[N];
 	int32 m_count;
 	int32 m_capacity;
+	b2Allocator* m_allocator;
 };
 
 
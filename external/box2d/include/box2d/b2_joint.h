@@ -29,6 +29,7 @@
 class b2Body;
 class b2Draw;
 class b2Joint;
+class b2Snapshot;
 struct b2SolverData;
 class b2BlockAllocator;
 
@@ -174,6 +175,10 @@ protected:
 	// This returns true if the position errors are within tolerance.
 	virtual bool SolvePositionConstraints(const b2SolverData& data) = 0;
 
+	// Save or load the joint parameters and the warm starting impulses.
+	// The bodies and the base class members are handled by b2World.
+	virtual void Snapshot(b2Snapshot* snapshot) = 0;
+
 	b2JointType m_type;
 	b2Joint* m_prev;
 	b2Joint* m_next;
@@ -26,9 +26,12 @@
 #include "b2_api.h"
 #include "b2_settings.h"
 
+/// The default stack size, see b2World::SetStackSize.
 const int32 b2_stackSize = 100 * 1024;	// 100k
 const int32 b2_maxStackEntries = 32;
 
+class b2Allocator;
+
 struct B2_API b2StackEntry
 {
 	char* data;
@@ -42,21 +45,33 @@ struct B2_API b2StackEntry
 class B2_API b2StackAllocator
 {
 public:
-	b2StackAllocator();
+	/// @param allocator provides the stack and the allocations that don't fit, nullptr uses b2Alloc.
+	b2StackAllocator(b2Allocator* allocator = nullptr, int32 size = b2_stackSize);
 	~b2StackAllocator();
 
 	void* Allocate(int32 size);
 	void Free(void* p);
 
+	/// Replace the stack. Nothing may be allocated.
+	void SetSize(int32 size);
+
+	int32 GetSize() const;
+
 	int32 GetMaxAllocation() const;
 
+	/// The number of allocations that didn't fit in the stack.
+	int32 GetOverflowCount() const;
+
 private:
 
-	char m_data[b2_stackSize];
+	b2Allocator* m_allocator;
+	char* m_data;
+	int32 m_size;
 	int32 m_index;
 
 	int32 m_allocation;
 	int32 m_maxAllocation;
+	int32 m_overflowCount;
 
 	b2StackEntry m_entries[b2_maxStackEntries];
 	int32 m_entryCount;
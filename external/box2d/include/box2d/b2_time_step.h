@@ -47,6 +47,7 @@ struct B2_API b2TimeStep
 	int32 velocityIterations;
 	int32 positionIterations;
 	bool warmStarting;
+	int32 contactSolverWidth;	// SIMD lanes of the contact solver, 1 for the scalar solver
 };
 
 /// This is an internal structure.
@@ -0,0 +1,100 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_TRACE_H
+#define B2_TRACE_H
+
+#include "b2_api.h"
+#include "b2_settings.h"
+
+/// Trace events show where the time of each step goes, per island, per TOI sub-step
+/// and per thread, as opposed to the totals of b2Profile. Events are recorded into a
+/// ring buffer and written as Chrome trace JSON, which chrome://tracing and
+/// ui.perfetto.dev open.
+/// The instrumentation in Box2D is only compiled in when B2_ENABLE_TRACE is defined
+/// (CMake option BOX2D_ENABLE_TRACE). Otherwise the B2_TRACE macros are empty.
+
+/// Start recording, dropping the events recorded before. The ring keeps the most
+/// recent capacity events.
+/// @warning call this outside of a time step.
+B2_API void b2StartTrace(int32 capacity);
+
+/// Stop recording. The events are kept until the next b2StartTrace.
+B2_API void b2StopTrace();
+
+/// Is recording started.
+B2_API bool b2IsTracing();
+
+/// Write the recorded events as Chrome trace JSON.
+/// @warning call this after b2StopTrace.
+/// @return false if the file could not be written.
+B2_API bool b2WriteTrace(const char* fileName);
+
+/// Name the calling thread in the trace.
+B2_API void b2SetTraceThreadName(const char* name);
+
+/// The trace clock in nanoseconds.
+B2_API uint64_t b2GetTraceTime();
+
+/// Record an event of the calling thread that started at start and ends now.
+/// The name is not copied, use string literals.
+B2_API void b2TraceEvent(const char* name, uint64_t start);
+
+/// Record the value of a counter, drawn as a graph over time.
+/// The name is not copied, use string literals.
+B2_API void b2TraceCounter(const char* name, float value);
+
+/// Records an event from construction to destruction.
+class b2TraceScope
+{
+public:
+	b2TraceScope(const char* name)
+	{
+		m_name = b2IsTracing() ? name : nullptr;
+		m_start = m_name ? b2GetTraceTime() : 0;
+	}
+
+	~b2TraceScope()
+	{
+		if (m_name)
+		{
+			b2TraceEvent(m_name, m_start);
+		}
+	}
+
+private:
+	const char* m_name;
+	uint64_t m_start;
+};
+
+#define B2_TRACE_JOIN2(a, b) a##b
+#define B2_TRACE_JOIN(a, b) B2_TRACE_JOIN2(a, b)
+
+#ifdef B2_ENABLE_TRACE
+#define B2_TRACE_SCOPE(name) b2TraceScope B2_TRACE_JOIN(b2_traceScope, __LINE__)(name)
+#define B2_TRACE_COUNTER(name, value) do { if (b2IsTracing()) b2TraceCounter(name, (float)(value)); } while (false)
+#else
+#define B2_TRACE_SCOPE(name)
+#define B2_TRACE_COUNTER(name, value) ((void)sizeof(value))
+#endif
+
+#endif
@@ -23,6 +23,7 @@
 #ifndef B2_WORLD_H
 #define B2_WORLD_H
 
+#include "b2_allocator.h"
 #include "b2_api.h"
 #include "b2_block_allocator.h"
 #include "b2_contact_manager.h"
@@ -35,10 +36,25 @@ struct b2AABB;
 struct b2BodyDef;
 struct b2Color;
 struct b2JointDef;
+struct b2IslandGather;
+struct b2PersistentIsland;
+struct b2TOIBatch;
 class b2Body;
 class b2Draw;
 class b2Fixture;
 class b2Joint;
+class b2Snapshot;
+class b2ThreadPool;
+
+/// A fixture hit by a ray of b2World::RayCastClosest or b2World::RayCastAll.
+struct B2_API b2RayCastHit
+{
+	/// nullptr if the ray hit nothing.
+	b2Fixture* fixture;
+	b2Vec2 point;
+	b2Vec2 normal;
+	float fraction;
+};
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -48,7 +64,9 @@ class B2_API b2World
 public:
 	/// Construct a world object.
 	/// @param gravity the world gravity vector.
-	b2World(const b2Vec2& gravity);
+	/// @param allocator provides the memory of the block and stack allocators, nullptr uses
+	/// b2Alloc. The allocator is owned by you and must outlive the world.
+	b2World(const b2Vec2& gravity, b2Allocator* allocator = nullptr);
 
 	/// Destruct the world. All physics entities are destroyed and all heap memory is released.
 	~b2World();
@@ -112,6 +130,13 @@ public:
 	/// Call this to draw shapes and other debug draw data. This is intentionally non-const.
 	void DebugDraw();
 
+	/// Draw only the debug data that overlaps the given view, typically the camera bounds.
+	/// Shapes, AABBs and centers of mass are found with a broad-phase query, so the cost
+	/// follows the number of visible fixtures rather than the size of the world.
+	/// Chain shapes are drawn one visible edge at a time.
+	/// @param viewAABB the region to draw, in world coordinates.
+	void DebugDraw(const b2AABB& viewAABB);
+
 	/// Query the world for all fixtures that potentially overlap the
 	/// provided AABB.
 	/// @param callback a user implemented callback class.
@@ -126,6 +151,36 @@ public:
 	/// @param point2 the ray ending point
 	void RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2) const;
 
+	/// Ray-cast many rays and find the closest fixture each one hits. The hits are the same
+	/// as RayCast with a closest hit callback per ray, but the rays are sorted by where they
+	/// start and cast in packets that share the tree traversal. With more than one thread
+	/// (see SetThreadCount) the packets are cast in parallel.
+	/// The ray-cast ignores shapes that contain the starting point.
+	/// @param rays the rays, each from p1 to p1 + maxFraction * (p2 - p1).
+	/// @param count the number of rays.
+	/// @param hits receives the closest hit of each ray, in the order of the rays.
+	/// @param maskBits only fixtures with a category bit in maskBits are hit.
+	/// @warning this should be called outside of a time step.
+	void RayCastClosest(const b2RayCastInput* rays, int32 count, b2RayCastHit* hits, uint16 maskBits) const;
+
+	/// Ray-cast many rays and find the fixtures each one hits, see RayCastClosest.
+	/// @param maxHits the most hits kept per ray. If a ray hits more, the closest ones are kept.
+	/// @param hits receives count * maxHits hits. The hits of ray i start at i * maxHits and
+	/// are sorted from the closest.
+	/// @param hitCounts receives the number of hits of each ray.
+	void RayCastAll(const b2RayCastInput* rays, int32 count, int32 maxHits,
+					b2RayCastHit* hits, int32* hitCounts, uint16 maskBits) const;
+
+	/// Query many AABBs for the fixtures that potentially overlap them. The boxes are
+	/// sorted by position and queried on the thread pool like in RayCastClosest.
+	/// @param maxFixtures the most fixtures kept per box. The query of a box stops once it has that many.
+	/// @param fixtures receives count * maxFixtures fixtures. Those of box i start at i * maxFixtures
+	/// and are in the order QueryAABB reports them.
+	/// @param fixtureCounts receives the number of fixtures of each box.
+	/// @param maskBits only fixtures with a category bit in maskBits are reported.
+	void QueryAABBs(const b2AABB* aabbs, int32 count, int32 maxFixtures,
+					b2Fixture** fixtures, int32* fixtureCounts, uint16 maskBits) const;
+
 	/// Get the world body list. With the returned body, use b2Body::GetNext to get
 	/// the next body in the world list. A nullptr body indicates the end of the list.
 	/// @return the head of the world body list.
@@ -162,6 +217,36 @@ public:
 	void SetSubStepping(bool flag) { m_subStepping = flag; }
 	bool GetSubStepping() const { return m_subStepping; }
 
+	/// Enable/disable batched TOI computation. Disabled scans all contacts for every TOI
+	/// event instead, the results are the same. For testing.
+	void SetTOIBatching(bool flag) { m_batchTOI = flag; }
+	bool GetTOIBatching() const { return m_batchTOI; }
+
+	/// Set the number of threads used to solve islands, including the thread that calls Step.
+	/// With more than one thread the islands of a step are solved in parallel. The results
+	/// are identical for any thread count. Contact listener PostSolve callbacks are still
+	/// made on the calling thread in island order, but only after all islands are solved.
+	/// The default is 1.
+	void SetThreadCount(int32 count);
+	int32 GetThreadCount() const;
+
+	/// Set the size of the stacks that hold the temporary memory of a step, the world has one
+	/// and each worker thread has one. Allocations that don't fit are made with the world's
+	/// allocator, GetAllocatorStats tells how large the stacks need to be to avoid that.
+	/// The default is b2_stackSize.
+	/// @warning this should be called outside of a time step.
+	void SetStackSize(int32 size);
+	int32 GetStackSize() const;
+
+	/// Set the number of contacts the contact solver works on at once. Above 1 the contacts
+	/// of larger islands are colored so that contacts of one color share no moving body,
+	/// and each SIMD lane solves one of them: 4 lanes with SSE2 and 8 with AVX2. This changes
+	/// the order contacts are solved in, so the results differ slightly from the scalar solver.
+	/// Use 0 for the widest the CPU supports. Unsupported widths use the next narrower one.
+	/// The default is 1, the scalar solver.
+	void SetContactSolverWidth(int32 width);
+	int32 GetContactSolverWidth() const { return m_contactSolverWidth; }
+
 	/// Get the number of broad-phase proxies.
 	int32 GetProxyCount() const;
 
@@ -174,6 +259,9 @@ public:
 	/// Get the number of contacts (each may have 0 or more contact points).
 	int32 GetContactCount() const;
 
+	/// Get the number of awake islands the last step solved.
+	int32 GetIslandCount() const;
+
 	/// Get the height of the dynamic tree.
 	int32 GetTreeHeight() const;
 
@@ -184,6 +272,18 @@ public:
 	/// The minimum is 1.
 	float GetTreeQuality() const;
 
+	/// Rebuild the dynamic tree top-down from its leaves. Fixtures are inserted one at a
+	/// time, call this after creating many of them, e.g. when loading a level, to get
+	/// a better tree and faster queries.
+	void RebuildBroadPhase();
+
+	/// Enable/disable refitting of the dynamic tree. A fixture proxy that leaves its fat
+	/// AABB then grows its ancestors instead of being re-inserted, which is cheaper but
+	/// makes the tree worse over time. Watch GetTreeQuality and call RebuildBroadPhase
+	/// when it gets too large. Disabled by default.
+	void SetBroadPhaseRefitting(bool flag);
+	bool GetBroadPhaseRefitting() const;
+
 	/// Change the global gravity vector.
 	void SetGravity(const b2Vec2& gravity);
 
@@ -210,14 +310,37 @@ public:
 	/// Get the current profile.
 	const b2Profile& GetProfile() const;
 
+	/// Get the memory use of the block and stack allocators.
+	b2AllocatorStats GetAllocatorStats() const;
+
 	/// Dump the world into the log file.
 	/// @warning this should be called outside of a time step.
 	void Dump();
 
+	/// Save the world to a compact binary snapshot: bodies, fixtures, shapes, joints, contacts
+	/// with their warm starting impulses and the broad-phase tree. A world loaded from it with
+	/// LoadSnapshot steps bit-exactly like this one. The snapshot is only valid for the same
+	/// build of Box2D on the same platform. User data is stored as is.
+	/// @param buffer receives the snapshot, may be nullptr.
+	/// @param capacity the size of the buffer in bytes. Nothing is written past it.
+	/// @return the size of the snapshot in bytes, call with a nullptr buffer to get it first.
+	/// @warning this should be called outside of a time step.
+	int32 SaveSnapshot(void* buffer, int32 capacity);
+
+	/// Replace everything in this world with a snapshot from SaveSnapshot. No fixture is
+	/// inserted into the broad-phase, the tree is restored as it was. The data is only read,
+	/// so it can be a memory mapped file. The listeners, the debug draw, the thread count and
+	/// the contact solver width of this world are kept. Nothing is reported to the listeners.
+	/// @return false if the data is not a valid snapshot. The world is then left empty,
+	/// unless the data was not a snapshot of this build at all, which leaves the world as it was.
+	/// @warning this should be called outside of a time step.
+	bool LoadSnapshot(const void* data, int32 size);
+
 private:
 
 	friend class b2Body;
 	friend class b2Fixture;
+	friend class b2Contact;
 	friend class b2ContactManager;
 	friend class b2Controller;
 
@@ -225,12 +348,81 @@ private:
 	void operator=(const b2World&) = delete;
 
 	void Solve(const b2TimeStep& step);
+	void SolveParallel(const b2TimeStep& step);
+	void SynchronizeFixtures(b2Body** bodies, int32 count);
 	void SolveTOI(const b2TimeStep& step);
+	void GatherTOI(b2TOIBatch* batch, b2Contact* contact);
+	void MarkTOIContacts(b2TOIBatch* batch, b2Body* body);
+	void RegatherTOIs(b2TOIBatch* batch);
+	void ComputeTOIs(b2TOIBatch* batch);
+	b2Contact* FindMinTOI(b2TOIBatch* batch, float* minAlpha);
+	b2Contact* ScanMinTOI(float* minAlpha);
+	void AddTOIWake(b2Body* body);
+
+	// Free all bodies, joints and contacts without callbacks and reset the broad-phase.
+	void Clear();
+
+	// Save or load everything after the snapshot header.
+	void Snapshot(b2Snapshot* snapshot);
+
+	// Persistent islands, see b2_world_island.cpp.
+	int32 CreateIsland();
+	void DestroyIsland(int32 islandId);
+	void AddToIsland(b2Body* body);
+	void RemoveFromIsland(b2Body* body);
+	void LinkBodies(b2Body* bodyA, b2Body* bodyB);
+	void UnlinkBodies(b2Body* bodyA, b2Body* bodyB);
+	void SearchIsland(b2Body* seed, b2IslandGather* gather);
+	bool GatherIsland(int32 islandId, b2IslandGather* gather);
+	void WakeIsland(int32 islandId);
+	void SleepIsland(int32 islandId);
+	void SplitIsland(int32 islandId);
+	void SplitCandidateIsland(int32 islandId);
+	void ClearIslands();
+	void SnapshotIslands(b2Snapshot* snapshot, b2Body** bodies);
+
+	// Arrays of Solve and SolveParallel that are sized by the whole world. They are kept from
+	// step to step and only grow, so they don't overflow the stack allocators.
+	enum b2SolveBufferType
+	{
+		e_islandBodyBuffer,
+		e_islandContactBuffer,
+		e_islandJointBuffer,
+		e_islandStaticBuffer,
+		e_islandStackBuffer,
+		e_islandRangeBuffer,
+		e_positionBuffer,
+		e_velocityBuffer,
+		e_solveBufferCount
+	};
+
+	struct b2SolveBuffer
+	{
+		void* data;
+		int32 capacity;
+	};
+
+	// Get a solve buffer of at least size bytes, its content is not kept when it grows.
+	void* ReserveSolveBuffer(int32 type, int32 size);
+	void FreeSolveBuffers();
+
+	friend struct b2WorldDebugDrawWrapper;
+
+	// Counts the culled DebugDraw calls, a body is stamped with it when the view query
+	// first reaches one of its proxies.
+	uint32 m_drawStamp;
 
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
 
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
+	b2Allocator* m_allocator;
+
+	// Only created for more than one thread.
+	b2ThreadPool* m_threadPool;
+
+	// Set while SolveTOI finds events, it is told about woken bodies.
+	b2TOIBatch* m_toiBatch;
 
 	b2ContactManager m_contactManager;
 
@@ -238,6 +430,9 @@ private:
 	b2Joint* m_jointList;
 
 	int32 m_bodyCount;
+
+	// Bodies created so far, see b2Body::m_creationIndex.
+	uint32 m_bodyCreationCount;
 	int32 m_jointCount;
 
 	b2Vec2 m_gravity;
@@ -258,10 +453,24 @@ private:
 	bool m_warmStarting;
 	bool m_continuousPhysics;
 	bool m_subStepping;
+	bool m_batchTOI;
+	int32 m_contactSolverWidth;
 
 	bool m_stepComplete;
 
 	b2Profile m_profile;
+	int32 m_islandCount;
+
+	// Indexed by b2Body::m_islandId. Unused islands are in a free list.
+	b2PersistentIsland* m_islands;
+	int32 m_islandCapacity;
+	int32 m_freeIsland;
+
+	// The islands the next step solves, as many as m_islandCapacity.
+	int32* m_awakeIslands;
+	int32 m_awakeIslandCount;
+
+	b2SolveBuffer m_solveBuffers[e_solveBufferCount];
 };
 
 inline b2Body* b2World::GetBodyList()
@@ -309,6 +518,11 @@ inline int32 b2World::GetContactCount() const
 	return m_contactManager.m_contactCount;
 }
 
+inline int32 b2World::GetIslandCount() const
+{
+	return m_islandCount;
+}
+
 inline void b2World::SetGravity(const b2Vec2& gravity)
 {
 	m_gravity = gravity;
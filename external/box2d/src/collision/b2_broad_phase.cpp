@@ -20,26 +20,71 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "box2d/b2_allocator.h"
 #include "box2d/b2_broad_phase.h"
+#include "common/b2_snapshot.h"
+#include "common/b2_thread_pool.h"
 #include <string.h>
 
-b2BroadPhase::b2BroadPhase()
+b2BroadPhase::b2BroadPhase(b2Allocator* allocator)
 {
+	m_allocator = allocator;
 	m_proxyCount = 0;
 
 	m_pairCapacity = 16;
 	m_pairCount = 0;
-	m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+	m_pairBuffer = (b2Pair*)b2Allocate(m_allocator, m_pairCapacity * sizeof(b2Pair));
 
 	m_moveCapacity = 16;
 	m_moveCount = 0;
-	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+	m_moveBuffer = (int32*)b2Allocate(m_allocator, m_moveCapacity * sizeof(int32));
+
+	m_refitProxies = false;
+
+	m_threadPool = nullptr;
+	m_workerPairs = nullptr;
+	m_workerCount = 0;
+	m_movePairCapacity = 16;
+	m_movePairs = (b2MovePairs*)b2Allocate(m_allocator, m_movePairCapacity * sizeof(b2MovePairs));
 }
 
 b2BroadPhase::~b2BroadPhase()
 {
-	b2Free(m_moveBuffer);
-	b2Free(m_pairBuffer);
+	SetThreadPool(nullptr);
+
+	b2Deallocate(m_allocator, m_moveBuffer, m_moveCapacity * sizeof(int32));
+	b2Deallocate(m_allocator, m_pairBuffer, m_pairCapacity * sizeof(b2Pair));
+	b2Deallocate(m_allocator, m_movePairs, m_movePairCapacity * sizeof(b2MovePairs));
+}
+
+void b2BroadPhase::SetThreadPool(b2ThreadPool* threadPool)
+{
+	if (m_workerPairs)
+	{
+		// The old thread pool may already be gone.
+		for (int32 i = 0; i < m_workerCount; ++i)
+		{
+			b2Deallocate(m_allocator, m_workerPairs[i].pairs, m_workerPairs[i].capacity * sizeof(b2Pair));
+		}
+
+		b2Deallocate(m_allocator, m_workerPairs, m_workerCount * sizeof(b2WorkerPairs));
+		m_workerPairs = nullptr;
+		m_workerCount = 0;
+	}
+
+	m_threadPool = threadPool;
+
+	if (m_threadPool)
+	{
+		m_workerCount = m_threadPool->GetThreadCount();
+		m_workerPairs = (b2WorkerPairs*)b2Allocate(m_allocator, m_workerCount * sizeof(b2WorkerPairs));
+		for (int32 i = 0; i < m_workerCount; ++i)
+		{
+			m_workerPairs[i].capacity = 16;
+			m_workerPairs[i].count = 0;
+			m_workerPairs[i].pairs = (b2Pair*)b2Allocate(m_allocator, m_workerPairs[i].capacity * sizeof(b2Pair));
+		}
+	}
 }
 
 int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
@@ -50,6 +95,17 @@ int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 	return proxyId;
 }
 
+void b2BroadPhase::CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds)
+{
+	m_tree.CreateProxies(aabbs, userData, count, proxyIds);
+	m_proxyCount += count;
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		BufferMove(proxyIds[i]);
+	}
+}
+
 void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
@@ -59,7 +115,16 @@ void b2BroadPhase::DestroyProxy(int32 proxyId)
 
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
-	bool buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	bool buffer;
+	if (m_refitProxies)
+	{
+		buffer = m_tree.RefitProxy(proxyId, aabb, displacement);
+	}
+	else
+	{
+		buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	}
+
 	if (buffer)
 	{
 		BufferMove(proxyId);
@@ -76,10 +141,11 @@ void b2BroadPhase::BufferMove(int32 proxyId)
 	if (m_moveCount == m_moveCapacity)
 	{
 		int32* oldBuffer = m_moveBuffer;
+		int32 oldCapacity = m_moveCapacity;
 		m_moveCapacity *= 2;
-		m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+		m_moveBuffer = (int32*)b2Allocate(m_allocator, m_moveCapacity * sizeof(int32));
 		memcpy(m_moveBuffer, oldBuffer, m_moveCount * sizeof(int32));
-		b2Free(oldBuffer);
+		b2Deallocate(m_allocator, oldBuffer, oldCapacity * sizeof(int32));
 	}
 
 	m_moveBuffer[m_moveCount] = proxyId;
@@ -97,6 +163,65 @@ void b2BroadPhase::UnBufferMove(int32 proxyId)
 	}
 }
 
+int32 b2BroadPhase::GetBufferBytes() const
+{
+	int32 bytes = m_pairCapacity * sizeof(b2Pair) + m_moveCapacity * sizeof(int32);
+	bytes += m_movePairCapacity * sizeof(b2MovePairs);
+	bytes += m_workerCount * sizeof(b2WorkerPairs);
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		bytes += m_workerPairs[i].capacity * sizeof(b2Pair);
+	}
+	return bytes;
+}
+
+void b2BroadPhase::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_proxyCount);
+	snapshot->Count(m_moveCount, sizeof(int32));
+
+	if (snapshot->IsLoading() && m_moveCount > m_moveCapacity)
+	{
+		b2Deallocate(m_allocator, m_moveBuffer, m_moveCapacity * sizeof(int32));
+		m_moveCapacity = m_moveCount;
+		m_moveBuffer = (int32*)b2Allocate(m_allocator, m_moveCapacity * sizeof(int32));
+	}
+
+	snapshot->Bytes(m_moveBuffer, m_moveCount * sizeof(int32));
+
+	m_tree.Snapshot(snapshot);
+
+	if (snapshot->IsLoading())
+	{
+		for (int32 i = 0; i < m_moveCount; ++i)
+		{
+			int32 proxyId = m_moveBuffer[i];
+			if (proxyId < e_nullProxy || proxyId >= m_tree.m_nodeCapacity)
+			{
+				snapshot->SetInvalid();
+				m_moveBuffer[i] = e_nullProxy;
+			}
+		}
+	}
+}
+
+bool b2BroadPhase::RestoreUserData(int32 proxyId, void* userData)
+{
+	if (proxyId < 0 || proxyId >= m_tree.m_nodeCapacity)
+	{
+		return false;
+	}
+
+	b2TreeNode* node = m_tree.m_nodes + proxyId;
+	if (node->IsLeaf() == false || node->height != 0 || node->userData != nullptr)
+	{
+		return false;
+	}
+
+	node->userData = userData;
+	return true;
+}
+
 // This is called from b2DynamicTree::Query when we are gathering pairs.
 bool b2BroadPhase::QueryCallback(int32 proxyId)
 {
@@ -117,10 +242,11 @@ bool b2BroadPhase::QueryCallback(int32 proxyId)
 	if (m_pairCount == m_pairCapacity)
 	{
 		b2Pair* oldBuffer = m_pairBuffer;
+		int32 oldCapacity = m_pairCapacity;
 		m_pairCapacity = m_pairCapacity + (m_pairCapacity >> 1);
-		m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+		m_pairBuffer = (b2Pair*)b2Allocate(m_allocator, m_pairCapacity * sizeof(b2Pair));
 		memcpy(m_pairBuffer, oldBuffer, m_pairCount * sizeof(b2Pair));
-		b2Free(oldBuffer);
+		b2Deallocate(m_allocator, oldBuffer, oldCapacity * sizeof(b2Pair));
 	}
 
 	m_pairBuffer[m_pairCount].proxyIdA = b2Min(proxyId, m_queryProxyId);
@@ -129,3 +255,149 @@ bool b2BroadPhase::QueryCallback(int32 proxyId)
 
 	return true;
 }
+
+// Below this many moved proxies the queries are not worth spreading over threads.
+#define b2_parallelPairMinMoves 64
+
+void b2BroadPhase::FindNewPairs()
+{
+	// Reset pair buffer
+	m_pairCount = 0;
+
+	if (m_threadPool && m_moveCount >= b2_parallelPairMinMoves)
+	{
+		FindNewPairsParallel();
+		return;
+	}
+
+	for (int32 i = 0; i < m_moveCount; ++i)
+	{
+		m_queryProxyId = m_moveBuffer[i];
+		if (m_queryProxyId == e_nullProxy)
+		{
+			continue;
+		}
+
+		// We have to query the tree with the fat AABB so that
+		// we don't fail to create a pair that may touch later.
+		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
+
+		// Query tree, create pairs and add them pair buffer.
+		m_tree.Query(this, fatAABB);
+	}
+}
+
+// Collects the pairs of one moved proxy into a worker's buffer. This is the
+// thread safe version of b2BroadPhase::QueryCallback.
+struct b2PairQuery
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		// A proxy cannot form a pair with itself.
+		if (proxyId == queryProxyId)
+		{
+			return true;
+		}
+
+		const bool moved = tree->WasMoved(proxyId);
+		if (moved && proxyId > queryProxyId)
+		{
+			// Both proxies are moving. Avoid duplicate pairs.
+			return true;
+		}
+
+		// Grow the pair buffer as needed.
+		if (*count == *capacity)
+		{
+			b2Pair* oldPairs = *pairs;
+			int32 oldCapacity = *capacity;
+			*capacity = *capacity + (*capacity >> 1);
+			*pairs = (b2Pair*)b2Allocate(allocator, *capacity * sizeof(b2Pair));
+			memcpy(*pairs, oldPairs, *count * sizeof(b2Pair));
+			b2Deallocate(allocator, oldPairs, oldCapacity * sizeof(b2Pair));
+		}
+
+		(*pairs)[*count].proxyIdA = b2Min(proxyId, queryProxyId);
+		(*pairs)[*count].proxyIdB = b2Max(proxyId, queryProxyId);
+		++(*count);
+
+		return true;
+	}
+
+	const b2DynamicTree* tree;
+	b2Allocator* allocator;
+	int32 queryProxyId;
+	b2Pair** pairs;
+	int32* count;
+	int32* capacity;
+};
+
+void b2BroadPhase::FindPairsTask(int32 begin, int32 end, int32 workerIndex, void* context)
+{
+	b2BroadPhase* broadPhase = (b2BroadPhase*)context;
+	b2WorkerPairs* worker = broadPhase->m_workerPairs + workerIndex;
+
+	b2PairQuery query;
+	query.tree = &broadPhase->m_tree;
+	query.allocator = broadPhase->m_allocator;
+	query.pairs = &worker->pairs;
+	query.count = &worker->count;
+	query.capacity = &worker->capacity;
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2MovePairs* movePairs = broadPhase->m_movePairs + i;
+		movePairs->workerIndex = workerIndex;
+		movePairs->begin = worker->count;
+
+		query.queryProxyId = broadPhase->m_moveBuffer[i];
+		if (query.queryProxyId != e_nullProxy)
+		{
+			const b2AABB& fatAABB = broadPhase->m_tree.GetFatAABB(query.queryProxyId);
+			broadPhase->m_tree.Query(&query, fatAABB);
+		}
+
+		movePairs->count = worker->count - movePairs->begin;
+	}
+}
+
+// The queries of the move buffer are spread over the threads, each thread adding its
+// pairs to its own buffer. The buffers are then merged in move buffer order, which
+// gives the pairs in the same order as the serial loop.
+void b2BroadPhase::FindNewPairsParallel()
+{
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		m_workerPairs[i].count = 0;
+	}
+
+	if (m_moveCount > m_movePairCapacity)
+	{
+		b2Deallocate(m_allocator, m_movePairs, m_movePairCapacity * sizeof(b2MovePairs));
+		m_movePairCapacity = m_moveCount + (m_moveCount >> 1);
+		m_movePairs = (b2MovePairs*)b2Allocate(m_allocator, m_movePairCapacity * sizeof(b2MovePairs));
+	}
+
+	m_threadPool->ParallelFor(m_moveCount, 16, FindPairsTask, this);
+
+	int32 pairCount = 0;
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		pairCount += m_workerPairs[i].count;
+	}
+
+	if (pairCount > m_pairCapacity)
+	{
+		b2Deallocate(m_allocator, m_pairBuffer, m_pairCapacity * sizeof(b2Pair));
+		m_pairCapacity = pairCount + (pairCount >> 1);
+		m_pairBuffer = (b2Pair*)b2Allocate(m_allocator, m_pairCapacity * sizeof(b2Pair));
+	}
+
+	for (int32 i = 0; i < m_moveCount; ++i)
+	{
+		const b2MovePairs* movePairs = m_movePairs + i;
+		const b2Pair* pairs = m_workerPairs[movePairs->workerIndex].pairs + movePairs->begin;
+		memcpy(m_pairBuffer + m_pairCount, pairs, movePairs->count * sizeof(b2Pair));
+		m_pairCount += movePairs->count;
+	}
+}
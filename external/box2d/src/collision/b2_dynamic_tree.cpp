@@ -20,6 +20,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 #include "box2d/b2_dynamic_tree.h"
+#include "common/b2_snapshot.h"
 #include <string.h>
 
 b2DynamicTree::b2DynamicTree()
@@ -130,12 +131,31 @@ void b2DynamicTree::DestroyProxy(int32 proxyId)
 	FreeNode(proxyId);
 }
 
-bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+void b2DynamicTree::CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds)
 {
-	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
 
-	b2Assert(m_nodes[proxyId].IsLeaf());
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 proxyId = AllocateNode();
+
+		// Fatten the aabb.
+		m_nodes[proxyId].aabb.lowerBound = aabbs[i].lowerBound - r;
+		m_nodes[proxyId].aabb.upperBound = aabbs[i].upperBound + r;
+		m_nodes[proxyId].userData = userData[i];
+		m_nodes[proxyId].height = 0;
+		m_nodes[proxyId].moved = true;
 
+		proxyIds[i] = proxyId;
+	}
+
+	// The new leaves are not linked yet, RebuildTopDown collects every leaf in the pool.
+	RebuildTopDown();
+}
+
+// The fat AABB of a proxy that moved by displacement.
+static b2AABB b2ComputeFatAABB(const b2AABB& aabb, const b2Vec2& displacement)
+{
 	// Extend AABB
 	b2AABB fatAABB;
 	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
@@ -163,12 +183,18 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 		fatAABB.upperBound.y += d.y;
 	}
 
-	const b2AABB& treeAABB = m_nodes[proxyId].aabb;
+	return fatAABB;
+}
+
+// Can the proxy keep its tree AABB?
+static bool b2KeepTreeAABB(const b2AABB& treeAABB, const b2AABB& aabb, const b2AABB& fatAABB)
+{
 	if (treeAABB.Contains(aabb))
 	{
 		// The tree AABB still contains the object, but it might be too large.
 		// Perhaps the object was moving fast but has since gone to sleep.
 		// The huge AABB is larger than the new fat AABB.
+		b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
 		b2AABB hugeAABB;
 		hugeAABB.lowerBound = fatAABB.lowerBound - 4.0f * r;
 		hugeAABB.upperBound = fatAABB.upperBound + 4.0f * r;
@@ -177,12 +203,28 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 		{
 			// The tree AABB contains the object AABB and the tree AABB is
 			// not too large. No tree update needed.
-			return false;
+			return true;
 		}
 
 		// Otherwise the tree AABB is huge and needs to be shrunk
 	}
 
+	return false;
+}
+
+bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+
+	b2Assert(m_nodes[proxyId].IsLeaf());
+
+	b2AABB fatAABB = b2ComputeFatAABB(aabb, displacement);
+
+	if (b2KeepTreeAABB(m_nodes[proxyId].aabb, aabb, fatAABB))
+	{
+		return false;
+	}
+
 	RemoveLeaf(proxyId);
 
 	m_nodes[proxyId].aabb = fatAABB;
@@ -194,6 +236,43 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 	return true;
 }
 
+bool b2DynamicTree::RefitProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+
+	b2Assert(m_nodes[proxyId].IsLeaf());
+
+	b2AABB fatAABB = b2ComputeFatAABB(aabb, displacement);
+
+	if (b2KeepTreeAABB(m_nodes[proxyId].aabb, aabb, fatAABB))
+	{
+		return false;
+	}
+
+	m_nodes[proxyId].aabb = fatAABB;
+	m_nodes[proxyId].moved = true;
+
+	// Walk back up the tree fixing the AABBs. Stop once an ancestor is unchanged.
+	int32 index = m_nodes[proxyId].parent;
+	while (index != b2_nullNode)
+	{
+		b2TreeNode* node = m_nodes + index;
+
+		b2AABB nodeAABB;
+		nodeAABB.Combine(m_nodes[node->child1].aabb, m_nodes[node->child2].aabb);
+
+		if (nodeAABB.lowerBound == node->aabb.lowerBound && nodeAABB.upperBound == node->aabb.upperBound)
+		{
+			break;
+		}
+
+		node->aabb = nodeAABB;
+		index = node->parent;
+	}
+
+	return true;
+}
+
 void b2DynamicTree::InsertLeaf(int32 leaf)
 {
 	++m_insertionCount;
@@ -790,6 +869,244 @@ void b2DynamicTree::RebuildBottomUp()
 	Validate();
 }
 
+#define b2_treeBinCount 16
+
+// Split the leaves in two and return the size of the first part. Leaves are binned
+// along the longest axis of their centers and split at the bin boundary with the
+// lowest perimeter cost. bounds receives the AABB of all the leaves.
+int32 b2DynamicTree::PartitionLeaves(int32* leaves, b2Vec2* centers, int32 count, b2AABB* bounds) const
+{
+	b2Assert(count >= 2);
+
+	b2AABB centerBounds;
+	centerBounds.lowerBound = centers[0];
+	centerBounds.upperBound = centers[0];
+	*bounds = m_nodes[leaves[0]].aabb;
+
+	for (int32 i = 1; i < count; ++i)
+	{
+		centerBounds.lowerBound = b2Min(centerBounds.lowerBound, centers[i]);
+		centerBounds.upperBound = b2Max(centerBounds.upperBound, centers[i]);
+		bounds->Combine(m_nodes[leaves[i]].aabb);
+	}
+
+	b2Vec2 extent = centerBounds.upperBound - centerBounds.lowerBound;
+	int32 axis = extent.x >= extent.y ? 0 : 1;
+	float minCenter = axis == 0 ? centerBounds.lowerBound.x : centerBounds.lowerBound.y;
+	float axisExtent = axis == 0 ? extent.x : extent.y;
+
+	if (axisExtent <= 0.0f)
+	{
+		// All the centers are the same, any split is as good as another.
+		return count / 2;
+	}
+
+	struct b2Bin
+	{
+		b2AABB aabb;
+		int32 count;
+	};
+
+	b2Bin bins[b2_treeBinCount];
+	for (int32 i = 0; i < b2_treeBinCount; ++i)
+	{
+		bins[i].count = 0;
+	}
+
+	float binScale = b2_treeBinCount / axisExtent;
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		float center = axis == 0 ? centers[i].x : centers[i].y;
+		int32 binIndex = b2Min(int32(binScale * (center - minCenter)), b2_treeBinCount - 1);
+
+		b2Bin* bin = bins + binIndex;
+		if (bin->count == 0)
+		{
+			bin->aabb = m_nodes[leaves[i]].aabb;
+		}
+		else
+		{
+			bin->aabb.Combine(m_nodes[leaves[i]].aabb);
+		}
+		++bin->count;
+	}
+
+	// Sweep from the right to get the cost of everything right of each plane.
+	float rightCosts[b2_treeBinCount];
+	b2AABB rightAABB;
+	int32 rightCount = 0;
+	for (int32 i = b2_treeBinCount - 1; i > 0; --i)
+	{
+		if (bins[i].count > 0)
+		{
+			if (rightCount == 0)
+			{
+				rightAABB = bins[i].aabb;
+			}
+			else
+			{
+				rightAABB.Combine(bins[i].aabb);
+			}
+			rightCount += bins[i].count;
+		}
+
+		rightCosts[i] = rightCount > 0 ? rightCount * rightAABB.GetPerimeter() : 0.0f;
+	}
+
+	// Sweep from the left. Plane i separates the bins [0, i) from [i, b2_treeBinCount).
+	// The first and last bins are never empty, so there is always a valid plane.
+	float minCost = b2_maxFloat;
+	int32 bestPlane = 1;
+	b2AABB leftAABB = bins[0].aabb;
+	int32 leftCount = bins[0].count;
+	for (int32 i = 1; i < b2_treeBinCount; ++i)
+	{
+		float cost = leftCount * leftAABB.GetPerimeter() + rightCosts[i];
+		if (bins[i].count > 0 && cost < minCost)
+		{
+			minCost = cost;
+			bestPlane = i;
+		}
+
+		if (bins[i].count > 0)
+		{
+			leftAABB.Combine(bins[i].aabb);
+			leftCount += bins[i].count;
+		}
+	}
+
+	// Move the leaves left of the plane to the front.
+	int32 i1 = 0, i2 = count;
+	while (i1 < i2)
+	{
+		float center = axis == 0 ? centers[i1].x : centers[i1].y;
+		int32 binIndex = b2Min(int32(binScale * (center - minCenter)), b2_treeBinCount - 1);
+
+		if (binIndex < bestPlane)
+		{
+			++i1;
+		}
+		else
+		{
+			--i2;
+			b2Swap(leaves[i1], leaves[i2]);
+			b2Swap(centers[i1], centers[i2]);
+		}
+	}
+
+	b2Assert(0 < i1 && i1 < count);
+	return i1;
+}
+
+void b2DynamicTree::RebuildTopDown()
+{
+	int32* leaves = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 count = 0;
+
+	// Build array of leaves. Free the rest.
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height < 0)
+		{
+			// free node in pool
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			m_nodes[i].parent = b2_nullNode;
+			leaves[count] = i;
+			++count;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	if (count == 0)
+	{
+		m_root = b2_nullNode;
+		b2Free(leaves);
+		return;
+	}
+
+	b2Vec2* centers = (b2Vec2*)b2Alloc(count * sizeof(b2Vec2));
+	for (int32 i = 0; i < count; ++i)
+	{
+		centers[i] = m_nodes[leaves[i]].aabb.GetCenter();
+	}
+
+	// Internal nodes in the order they were created. Children are always created
+	// after their parent, so walking this backwards visits children first.
+	int32* internalNodes = (int32*)b2Alloc(b2Max(count - 1, 1) * sizeof(int32));
+	int32 internalCount = 0;
+
+	struct b2BuildItem
+	{
+		int32 begin;
+		int32 count;
+		int32 parent;
+		bool isChild1;
+	};
+
+	b2GrowableStack<b2BuildItem, 64> stack;
+	stack.Push({ 0, count, b2_nullNode, true });
+
+	while (stack.GetCount() > 0)
+	{
+		b2BuildItem item = stack.Pop();
+
+		int32 nodeId;
+		if (item.count == 1)
+		{
+			nodeId = leaves[item.begin];
+		}
+		else
+		{
+			b2AABB bounds;
+			int32 leftCount = PartitionLeaves(leaves + item.begin, centers + item.begin, item.count, &bounds);
+
+			nodeId = AllocateNode();
+			m_nodes[nodeId].aabb = bounds;
+			internalNodes[internalCount] = nodeId;
+			++internalCount;
+
+			stack.Push({ item.begin + leftCount, item.count - leftCount, nodeId, false });
+			stack.Push({ item.begin, leftCount, nodeId, true });
+		}
+
+		m_nodes[nodeId].parent = item.parent;
+		if (item.parent == b2_nullNode)
+		{
+			m_root = nodeId;
+		}
+		else if (item.isChild1)
+		{
+			m_nodes[item.parent].child1 = nodeId;
+		}
+		else
+		{
+			m_nodes[item.parent].child2 = nodeId;
+		}
+	}
+
+	b2Assert(internalCount == count - 1);
+
+	for (int32 i = internalCount - 1; i >= 0; --i)
+	{
+		b2TreeNode* node = m_nodes + internalNodes[i];
+		node->height = 1 + b2Max(m_nodes[node->child1].height, m_nodes[node->child2].height);
+	}
+
+	b2Free(internalNodes);
+	b2Free(centers);
+	b2Free(leaves);
+
+	Validate();
+}
+
 void b2DynamicTree::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	// Build array of leaves. Free the rest.
@@ -799,3 +1116,89 @@ void b2DynamicTree::ShiftOrigin(const b2Vec2& newOrigin)
 		m_nodes[i].aabb.upperBound -= newOrigin;
 	}
 }
+
+void b2DynamicTree::Snapshot(b2Snapshot* snapshot)
+{
+	int32 nodeCapacity = m_nodeCapacity;
+	snapshot->Count(nodeCapacity, sizeof(b2TreeNode));
+	snapshot->Value(m_nodeCount);
+	snapshot->Value(m_root);
+	snapshot->Value(m_freeList);
+	snapshot->Value(m_insertionCount);
+
+	if (snapshot->IsLoading() == false)
+	{
+		// Copy only what is in use, leaving out the user data, the padding and the
+		// uninitialized members of free nodes. So equal trees give equal snapshots.
+		for (int32 i = 0; i < m_nodeCapacity; ++i)
+		{
+			const b2TreeNode* source = m_nodes + i;
+
+			b2TreeNode node;
+			memset(&node, 0, sizeof(b2TreeNode));
+			node.next = source->next;
+			node.height = source->height;
+			node.child1 = b2_nullNode;
+			node.child2 = b2_nullNode;
+
+			if (source->height >= 0)
+			{
+				node.aabb = source->aabb;
+				node.child1 = source->child1;
+				node.child2 = source->child2;
+				node.moved = source->moved;
+			}
+
+			snapshot->Value(node);
+		}
+		return;
+	}
+
+	if (nodeCapacity == 0 || m_nodeCount < 0 || m_nodeCount > nodeCapacity ||
+		m_root < b2_nullNode || m_root >= nodeCapacity ||
+		m_freeList < b2_nullNode || m_freeList >= nodeCapacity)
+	{
+		snapshot->SetInvalid();
+		nodeCapacity = 0;
+	}
+
+	if (nodeCapacity != m_nodeCapacity)
+	{
+		b2Free(m_nodes);
+		m_nodeCapacity = b2Max(nodeCapacity, 1);
+		m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
+	}
+
+	if (nodeCapacity == 0)
+	{
+		// Leave an empty tree.
+		m_nodes[0].next = b2_nullNode;
+		m_nodes[0].height = -1;
+		m_nodeCount = 0;
+		m_root = b2_nullNode;
+		m_freeList = 0;
+		return;
+	}
+
+	snapshot->Bytes(m_nodes, m_nodeCapacity * sizeof(b2TreeNode));
+
+	// Check the links so that a damaged snapshot cannot send queries out of the pool.
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		b2TreeNode* node = m_nodes + i;
+		node->userData = nullptr;
+
+		if (node->parent < b2_nullNode || node->parent >= m_nodeCapacity)
+		{
+			snapshot->SetInvalid();
+		}
+
+		// The children of free nodes are not initialized.
+		if (node->height >= 0 &&
+			(node->child1 < b2_nullNode || node->child1 >= m_nodeCapacity ||
+			node->child2 < b2_nullNode || node->child2 >= m_nodeCapacity))
+		{
+			snapshot->SetInvalid();
+		}
+	}
+}
@@ -0,0 +1,238 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/b2_allocator.h"
+#include "box2d/b2_math.h"
+
+#if defined(_WIN32)
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+
+#elif defined(__linux__)
+
+#include <sys/mman.h>
+
+#endif
+
+// Allocations are aligned like malloc on 64 bit platforms. A freed block must hold a free
+// list entry, so this is also the smallest block.
+static const int32 b2_arenaAlignment = 16;
+
+static int32 b2ArenaBlockSize(int32 size)
+{
+	int32 alignedSize = (size + b2_arenaAlignment - 1) & ~(b2_arenaAlignment - 1);
+	return b2Max(alignedSize, b2_arenaAlignment);
+}
+
+// The free list of a block size, blocks of list i are at least 2^i bytes.
+static int32 b2FreeListIndex(int32 size)
+{
+	int32 index = 0;
+	while (size >>= 1)
+	{
+		++index;
+	}
+	return index;
+}
+
+// Reserve the arena with huge pages. Returns nullptr if the system has none to give,
+// mappedSize receives the size of the mapping.
+static char* b2MapHugePages(int32 capacity, int32* mappedSize)
+{
+#if defined(_WIN32)
+	SIZE_T pageSize = GetLargePageMinimum();
+	if (pageSize == 0)
+	{
+		return nullptr;
+	}
+
+	SIZE_T size = (capacity + pageSize - 1) & ~(pageSize - 1);
+	void* data = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	*mappedSize = (int32)size;
+	return (char*)data;
+#elif defined(__linux__) && defined(MADV_HUGEPAGE)
+	// Transparent huge pages, the mapping is aligned to them so they can back all of it.
+	const size_t pageSize = 2 * 1024 * 1024;
+	size_t size = ((size_t)capacity + pageSize - 1) & ~(pageSize - 1);
+	void* data = mmap(nullptr, size + pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	char* start = (char*)data;
+	char* aligned = (char*)(((size_t)start + pageSize - 1) & ~(pageSize - 1));
+	if (aligned > start)
+	{
+		munmap(start, aligned - start);
+	}
+	munmap(aligned + size, start + pageSize - aligned);
+
+	if (madvise(aligned, size, MADV_HUGEPAGE) != 0)
+	{
+		munmap(aligned, size);
+		return nullptr;
+	}
+
+	*mappedSize = (int32)size;
+	return aligned;
+#else
+	B2_NOT_USED(capacity);
+	B2_NOT_USED(mappedSize);
+	return nullptr;
+#endif
+}
+
+static void b2UnmapHugePages(char* data, int32 mappedSize)
+{
+#if defined(_WIN32)
+	B2_NOT_USED(mappedSize);
+	VirtualFree(data, 0, MEM_RELEASE);
+#elif defined(__linux__) && defined(MADV_HUGEPAGE)
+	munmap(data, mappedSize);
+#else
+	B2_NOT_USED(data);
+	B2_NOT_USED(mappedSize);
+#endif
+}
+
+b2ArenaAllocator::b2ArenaAllocator(int32 capacity, bool hugePages)
+{
+	b2Assert(capacity >= 0);
+
+	m_capacity = capacity;
+	m_used = 0;
+	m_freeBytes = 0;
+	m_overflowCount = 0;
+	m_mappedSize = 0;
+	m_hugePages = false;
+	m_data = nullptr;
+
+	for (int32 i = 0; i < e_freeListCount; ++i)
+	{
+		m_freeLists[i] = nullptr;
+	}
+
+	if (hugePages)
+	{
+		m_data = b2MapHugePages(capacity, &m_mappedSize);
+		m_hugePages = m_data != nullptr;
+	}
+
+	if (m_data == nullptr)
+	{
+		m_data = (char*)b2Alloc(capacity);
+	}
+}
+
+b2ArenaAllocator::~b2ArenaAllocator()
+{
+	if (m_hugePages)
+	{
+		b2UnmapHugePages(m_data, m_mappedSize);
+	}
+	else
+	{
+		b2Free(m_data);
+	}
+}
+
+void* b2ArenaAllocator::Allocate(int32 size)
+{
+	int32 blockSize = b2ArenaBlockSize(size);
+	int32 index = b2FreeListIndex(blockSize);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// The blocks of the lists after the first one are all large enough.
+	b2FreeBlock** link = m_freeLists + index;
+	while (*link && (*link)->size < blockSize)
+	{
+		link = &(*link)->next;
+	}
+
+	for (int32 i = index + 1; *link == nullptr && i < e_freeListCount; ++i)
+	{
+		link = m_freeLists + i;
+	}
+
+	b2FreeBlock* block = *link;
+	if (block)
+	{
+		*link = block->next;
+		m_freeBytes -= block->size;
+
+		if (block->size > blockSize)
+		{
+			AddFreeBlock((char*)block + blockSize, block->size - blockSize);
+		}
+
+		return block;
+	}
+
+	if (blockSize > m_capacity - m_used)
+	{
+		++m_overflowCount;
+		return b2Alloc(size);
+	}
+
+	void* mem = m_data + m_used;
+	m_used += blockSize;
+	return mem;
+}
+
+void b2ArenaAllocator::Free(void* mem, int32 size)
+{
+	char* p = (char*)mem;
+	if (p < m_data || m_data + m_capacity <= p)
+	{
+		b2Free(mem);
+		return;
+	}
+
+	int32 blockSize = b2ArenaBlockSize(size);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (p + blockSize == m_data + m_used)
+	{
+		m_used -= blockSize;
+	}
+	else
+	{
+		AddFreeBlock(p, blockSize);
+	}
+}
+
+void b2ArenaAllocator::AddFreeBlock(char* mem, int32 size)
+{
+	b2FreeBlock* block = (b2FreeBlock*)mem;
+	int32 index = b2FreeListIndex(size);
+	block->size = size;
+	block->next = m_freeLists[index];
+	m_freeLists[index] = block;
+	m_freeBytes += size;
+}
@@ -21,6 +21,8 @@
 // SOFTWARE.
 
 #include "box2d/b2_block_allocator.h"
+#include "box2d/b2_allocator.h"
+#include "box2d/b2_math.h"
 #include <limits.h>
 #include <string.h>
 #include <stddef.h>
@@ -86,26 +88,32 @@ struct b2Block
 	b2Block* next;
 };
 
-b2BlockAllocator::b2BlockAllocator()
+b2BlockAllocator::b2BlockAllocator(b2Allocator* allocator)
 {
 	b2Assert(b2_blockSizeCount < UCHAR_MAX);
 
+	m_allocator = allocator;
 	m_chunkSpace = b2_chunkArrayIncrement;
 	m_chunkCount = 0;
-	m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
+	m_chunks = (b2Chunk*)b2Allocate(m_allocator, m_chunkSpace * sizeof(b2Chunk));
 	
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+
+	m_blockBytes = 0;
+	m_maxBlockBytes = 0;
+	m_largeCount = 0;
+	m_largeBytes = 0;
 }
 
 b2BlockAllocator::~b2BlockAllocator()
 {
 	for (int32 i = 0; i < m_chunkCount; ++i)
 	{
-		b2Free(m_chunks[i].blocks);
+		b2Deallocate(m_allocator, m_chunks[i].blocks, b2_chunkSize);
 	}
 
-	b2Free(m_chunks);
+	b2Deallocate(m_allocator, m_chunks, m_chunkSpace * sizeof(b2Chunk));
 }
 
 void* b2BlockAllocator::Allocate(int32 size)
@@ -119,12 +127,17 @@ void* b2BlockAllocator::Allocate(int32 size)
 
 	if (size > b2_maxBlockSize)
 	{
-		return b2Alloc(size);
+		++m_largeCount;
+		m_largeBytes += size;
+		return b2Allocate(m_allocator, size);
 	}
 
 	int32 index = b2_sizeMap.values[size];
 	b2Assert(0 <= index && index < b2_blockSizeCount);
 
+	m_blockBytes += b2_blockSizes[index];
+	m_maxBlockBytes = b2Max(m_maxBlockBytes, m_blockBytes);
+
 	if (m_freeLists[index])
 	{
 		b2Block* block = m_freeLists[index];
@@ -136,15 +149,16 @@ void* b2BlockAllocator::Allocate(int32 size)
 		if (m_chunkCount == m_chunkSpace)
 		{
 			b2Chunk* oldChunks = m_chunks;
+			int32 oldSpace = m_chunkSpace;
 			m_chunkSpace += b2_chunkArrayIncrement;
-			m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
+			m_chunks = (b2Chunk*)b2Allocate(m_allocator, m_chunkSpace * sizeof(b2Chunk));
 			memcpy(m_chunks, oldChunks, m_chunkCount * sizeof(b2Chunk));
 			memset(m_chunks + m_chunkCount, 0, b2_chunkArrayIncrement * sizeof(b2Chunk));
-			b2Free(oldChunks);
+			b2Deallocate(m_allocator, oldChunks, oldSpace * sizeof(b2Chunk));
 		}
 
 		b2Chunk* chunk = m_chunks + m_chunkCount;
-		chunk->blocks = (b2Block*)b2Alloc(b2_chunkSize);
+		chunk->blocks = (b2Block*)b2Allocate(m_allocator, b2_chunkSize);
 #if defined(_DEBUG)
 		memset(chunk->blocks, 0xcd, b2_chunkSize);
 #endif
@@ -179,13 +193,17 @@ void b2BlockAllocator::Free(void* p, int32 size)
 
 	if (size > b2_maxBlockSize)
 	{
-		b2Free(p);
+		--m_largeCount;
+		m_largeBytes -= size;
+		b2Deallocate(m_allocator, p, size);
 		return;
 	}
 
 	int32 index = b2_sizeMap.values[size];
 	b2Assert(0 <= index && index < b2_blockSizeCount);
 
+	m_blockBytes -= b2_blockSizes[index];
+
 #if defined(_DEBUG)
 	// Verify the memory address and size is valid.
 	int32 blockSize = b2_blockSizes[index];
@@ -221,10 +239,42 @@ void b2BlockAllocator::Clear()
 {
 	for (int32 i = 0; i < m_chunkCount; ++i)
 	{
-		b2Free(m_chunks[i].blocks);
+		b2Deallocate(m_allocator, m_chunks[i].blocks, b2_chunkSize);
 	}
 
 	m_chunkCount = 0;
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+
+	m_blockBytes = 0;
+}
+
+int32 b2BlockAllocator::GetChunkCount() const
+{
+	return m_chunkCount;
+}
+
+int32 b2BlockAllocator::GetChunkBytes() const
+{
+	return m_chunkCount * b2_chunkSize;
+}
+
+int32 b2BlockAllocator::GetBlockBytes() const
+{
+	return m_blockBytes;
+}
+
+int32 b2BlockAllocator::GetMaxBlockBytes() const
+{
+	return m_maxBlockBytes;
+}
+
+int32 b2BlockAllocator::GetLargeCount() const
+{
+	return m_largeCount;
+}
+
+int32 b2BlockAllocator::GetLargeBytes() const
+{
+	return m_largeBytes;
 }
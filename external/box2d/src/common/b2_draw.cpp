@@ -19,6 +19,7 @@
 // LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
+#include "box2d/b2_body.h"
 #include "box2d/b2_draw.h"
 
 b2Draw::b2Draw()
@@ -45,3 +46,8 @@ void b2Draw::ClearFlags(uint32 flags)
 {
 	m_drawFlags &= ~flags;
 }
+
+b2Transform b2Draw::GetBodyTransform(const b2Body* body) const
+{
+	return body->GetTransform();
+}
@@ -0,0 +1,129 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef B2_SNAPSHOT_H
+#define B2_SNAPSHOT_H
+
+#include "box2d/b2_settings.h"
+
+#include <string.h>
+
+/// This is an internal class. Saves or loads the binary snapshot of a world, see
+/// b2World::SaveSnapshot. Saving and loading make the same sequence of calls, so
+/// the two directions cannot disagree about the layout. Values are stored in the
+/// native byte order without padding.
+class b2Snapshot
+{
+public:
+	/// Save into a buffer. Nothing is written past capacity, but the size keeps
+	/// counting so a first pass with a null buffer gives the size of the snapshot.
+	b2Snapshot(void* buffer, int32 capacity)
+	{
+		m_data = (char*)buffer;
+		m_capacity = buffer ? capacity : 0;
+		m_offset = 0;
+		m_loading = false;
+		m_valid = true;
+	}
+
+	/// Load from data, which is only read.
+	b2Snapshot(const void* data, int32 size)
+	{
+		m_data = (char*)data;
+		m_capacity = size;
+		m_offset = 0;
+		m_loading = true;
+		m_valid = true;
+	}
+
+	bool IsLoading() const
+	{
+		return m_loading;
+	}
+
+	/// False once loading has read past the end of the data or found a bad value.
+	bool IsValid() const
+	{
+		return m_valid;
+	}
+
+	void SetInvalid()
+	{
+		m_valid = false;
+	}
+
+	/// The number of bytes saved or loaded so far.
+	int32 GetSize() const
+	{
+		return m_offset;
+	}
+
+	/// Save or load size bytes. Loading past the end zeroes the data.
+	void Bytes(void* data, int32 size)
+	{
+		if (size <= m_capacity - m_offset)
+		{
+			if (m_loading)
+			{
+				memcpy(data, m_data + m_offset, size);
+			}
+			else
+			{
+				memcpy(m_data + m_offset, data, size);
+			}
+		}
+		else if (m_loading)
+		{
+			memset(data, 0, size);
+			m_valid = false;
+		}
+
+		m_offset += size;
+	}
+
+	template <typename T>
+	void Value(T& value)
+	{
+		Bytes(&value, sizeof(T));
+	}
+
+	/// Save or load the length of an array that follows. A loaded count is checked
+	/// against the data that is left, so a damaged snapshot cannot cause a huge
+	/// allocation. Each element must take at least elementSize bytes.
+	void Count(int32& count, int32 elementSize)
+	{
+		Value(count);
+		if (m_loading && (count < 0 || count > (m_capacity - m_offset) / elementSize))
+		{
+			count = 0;
+			m_valid = false;
+		}
+	}
+
+private:
+	char* m_data;
+	int32 m_capacity;
+	int32 m_offset;
+	bool m_loading;
+	bool m_valid;
+};
+
+#endif
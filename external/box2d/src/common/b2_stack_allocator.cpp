@@ -21,13 +21,20 @@
 // SOFTWARE.
 
 #include "box2d/b2_stack_allocator.h"
+#include "box2d/b2_allocator.h"
 #include "box2d/b2_math.h"
 
-b2StackAllocator::b2StackAllocator()
+b2StackAllocator::b2StackAllocator(b2Allocator* allocator, int32 size)
 {
+	b2Assert(size >= 0);
+
+	m_allocator = allocator;
+	m_size = size;
+	m_data = (char*)b2Allocate(m_allocator, m_size);
 	m_index = 0;
 	m_allocation = 0;
 	m_maxAllocation = 0;
+	m_overflowCount = 0;
 	m_entryCount = 0;
 }
 
@@ -35,6 +42,8 @@ b2StackAllocator::~b2StackAllocator()
 {
 	b2Assert(m_index == 0);
 	b2Assert(m_entryCount == 0);
+
+	b2Deallocate(m_allocator, m_data, m_size);
 }
 
 void* b2StackAllocator::Allocate(int32 size)
@@ -43,10 +52,11 @@ void* b2StackAllocator::Allocate(int32 size)
 
 	b2StackEntry* entry = m_entries + m_entryCount;
 	entry->size = size;
-	if (m_index + size > b2_stackSize)
+	if (m_index + size > m_size)
 	{
-		entry->data = (char*)b2Alloc(size);
+		entry->data = (char*)b2Allocate(m_allocator, size);
 		entry->usedMalloc = true;
+		++m_overflowCount;
 	}
 	else
 	{
@@ -69,7 +79,7 @@ void b2StackAllocator::Free(void* p)
 	b2Assert(p == entry->data);
 	if (entry->usedMalloc)
 	{
-		b2Free(p);
+		b2Deallocate(m_allocator, p, entry->size);
 	}
 	else
 	{
@@ -81,7 +91,32 @@ void b2StackAllocator::Free(void* p)
 	p = nullptr;
 }
 
+void b2StackAllocator::SetSize(int32 size)
+{
+	b2Assert(m_entryCount == 0);
+	b2Assert(size >= 0);
+
+	if (size == m_size)
+	{
+		return;
+	}
+
+	b2Deallocate(m_allocator, m_data, m_size);
+	m_size = size;
+	m_data = (char*)b2Allocate(m_allocator, m_size);
+}
+
+int32 b2StackAllocator::GetSize() const
+{
+	return m_size;
+}
+
 int32 b2StackAllocator::GetMaxAllocation() const
 {
 	return m_maxAllocation;
 }
+
+int32 b2StackAllocator::GetOverflowCount() const
+{
+	return m_overflowCount;
+}
@@ -0,0 +1,194 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "b2_thread_pool.h"
+
+#include "box2d/b2_math.h"
+#include "box2d/b2_stack_allocator.h"
+#include "box2d/b2_trace.h"
+
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+
+b2ThreadPool::b2ThreadPool(int32 threadCount, b2Allocator* allocator, int32 stackSize)
+{
+	b2Assert(threadCount >= 1);
+
+	m_threadCount = threadCount;
+	m_callback = nullptr;
+	m_context = nullptr;
+	m_grainSize = 1;
+	m_generation = 0;
+	m_pendingWorkers = 0;
+	m_exit = false;
+	m_running = false;
+
+	m_spans = new b2Span[threadCount];
+	m_allocators = (b2StackAllocator**)b2Alloc(threadCount * sizeof(b2StackAllocator*));
+	for (int32 i = 0; i < threadCount; ++i)
+	{
+		void* mem = b2Alloc(sizeof(b2StackAllocator));
+		m_allocators[i] = new (mem) b2StackAllocator(allocator, stackSize);
+	}
+
+	// The calling thread is worker 0, so one less thread is started.
+	m_threads = new std::thread[threadCount - 1];
+	for (int32 i = 1; i < threadCount; ++i)
+	{
+		m_threads[i - 1] = std::thread(&b2ThreadPool::WorkerMain, this, i);
+	}
+}
+
+b2ThreadPool::~b2ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+	m_startCondition.notify_all();
+
+	for (int32 i = 1; i < m_threadCount; ++i)
+	{
+		m_threads[i - 1].join();
+	}
+
+	delete [] m_threads;
+
+	for (int32 i = 0; i < m_threadCount; ++i)
+	{
+		m_allocators[i]->~b2StackAllocator();
+		b2Free(m_allocators[i]);
+	}
+	b2Free(m_allocators);
+
+	delete [] m_spans;
+}
+
+void b2ThreadPool::SetStackSize(int32 stackSize)
+{
+	b2Assert(m_running == false);
+
+	for (int32 i = 0; i < m_threadCount; ++i)
+	{
+		m_allocators[i]->SetSize(stackSize);
+	}
+}
+
+void b2ThreadPool::ParallelFor(int32 count, int32 grainSize, b2TaskCallback* callback, void* context)
+{
+	b2Assert(m_running == false);
+	b2Assert(grainSize > 0);
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	// Not worth waking the workers.
+	if (m_threadCount == 1 || count <= grainSize)
+	{
+		callback(0, count, 0, context);
+		return;
+	}
+
+	// Give every thread an equal contiguous span so neighboring items stay on one thread.
+	for (int32 i = 0; i < m_threadCount; ++i)
+	{
+		int32 begin = (int32)((int64_t)count * i / m_threadCount);
+		int32 end = (int32)((int64_t)count * (i + 1) / m_threadCount);
+		m_spans[i].next.store(begin, std::memory_order_relaxed);
+		m_spans[i].end = end;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_callback = callback;
+		m_context = context;
+		m_grainSize = grainSize;
+		m_pendingWorkers = m_threadCount - 1;
+		m_running = true;
+		++m_generation;
+	}
+	m_startCondition.notify_all();
+
+	RunTasks(0);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return m_pendingWorkers == 0; });
+	m_running = false;
+}
+
+void b2ThreadPool::RunTasks(int32 workerIndex)
+{
+	// Start with the own span, then steal from the others in order.
+	for (int32 k = 0; k < m_threadCount; ++k)
+	{
+		b2Span* span = m_spans + (workerIndex + k) % m_threadCount;
+
+		for (;;)
+		{
+			int32 begin = span->next.fetch_add(m_grainSize, std::memory_order_relaxed);
+			if (begin >= span->end)
+			{
+				break;
+			}
+
+			int32 end = b2Min(begin + m_grainSize, span->end);
+			m_callback(begin, end, workerIndex, m_context);
+		}
+	}
+}
+
+void b2ThreadPool::WorkerMain(int32 workerIndex)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "Box2D worker %d", workerIndex);
+	b2SetTraceThreadName(name);
+
+	uint32 generation = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_startCondition.wait(lock, [this, generation]() { return m_exit || m_generation != generation; });
+
+			if (m_exit)
+			{
+				return;
+			}
+
+			generation = m_generation;
+		}
+
+		RunTasks(workerIndex);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_pendingWorkers;
+			if (m_pendingWorkers == 0)
+			{
+				m_doneCondition.notify_one();
+			}
+		}
+	}
+}
@@ -0,0 +1,104 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef B2_THREAD_POOL_H
+#define B2_THREAD_POOL_H
+
+#include "box2d/b2_settings.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+class b2Allocator;
+class b2StackAllocator;
+
+/// Processes the items [begin, end) of a parallel loop. workerIndex identifies
+/// the thread, 0 being the thread that called ParallelFor.
+typedef void b2TaskCallback(int32 begin, int32 end, int32 workerIndex, void* context);
+
+/// This is an internal class. A fixed set of worker threads that run parallel
+/// loops together with the calling thread. Each worker owns a stack allocator
+/// for its per-task scratch memory.
+class b2ThreadPool
+{
+public:
+	/// @param threadCount the number of threads including the calling thread.
+	/// @param allocator provides the stacks of the workers, nullptr uses b2Alloc.
+	/// @param stackSize the size of each worker's stack.
+	b2ThreadPool(int32 threadCount, b2Allocator* allocator, int32 stackSize);
+	~b2ThreadPool();
+
+	int32 GetThreadCount() const
+	{
+		return m_threadCount;
+	}
+
+	b2StackAllocator* GetStackAllocator(int32 workerIndex)
+	{
+		b2Assert(0 <= workerIndex && workerIndex < m_threadCount);
+		return m_allocators[workerIndex];
+	}
+
+	/// Replace the stacks of the workers, call this outside of a parallel loop.
+	void SetStackSize(int32 stackSize);
+
+	/// Run the callback over the items [0, count) and return once all of them are done.
+	/// The items are split into one span per thread. A thread takes ranges of at most
+	/// grainSize items from its own span and steals from the other spans once its own
+	/// is empty. Parallel loops cannot be nested.
+	void ParallelFor(int32 count, int32 grainSize, b2TaskCallback* callback, void* context);
+
+private:
+
+	struct b2Span
+	{
+		std::atomic<int32> next;
+		int32 end;
+
+		// Keep the spans on separate cache lines.
+		char padding[64 - sizeof(std::atomic<int32>) - sizeof(int32)];
+	};
+
+	void WorkerMain(int32 workerIndex);
+	void RunTasks(int32 workerIndex);
+
+	int32 m_threadCount;
+	std::thread* m_threads;
+	b2StackAllocator** m_allocators;
+	b2Span* m_spans;
+
+	// The current loop.
+	b2TaskCallback* m_callback;
+	void* m_context;
+	int32 m_grainSize;
+
+	std::mutex m_mutex;
+	std::condition_variable m_startCondition;
+	std::condition_variable m_doneCondition;
+	uint32 m_generation;
+	int32 m_pendingWorkers;
+	bool m_exit;
+	bool m_running;
+};
+
+#endif
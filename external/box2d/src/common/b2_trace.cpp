@@ -0,0 +1,203 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/b2_math.h"
+#include "box2d/b2_trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#define b2_maxTraceThreads 64
+
+enum b2TraceEventType
+{
+	e_traceComplete,
+	e_traceCounter
+};
+
+struct b2TraceRecord
+{
+	const char* name;
+	uint64_t time;
+
+	// Duration in nanoseconds of a complete event.
+	uint64_t duration;
+	float value;
+	int32 thread;
+	int32 type;
+};
+
+static b2TraceRecord* s_traceRecords = nullptr;
+static int32 s_traceCapacity = 0;
+static std::atomic<uint64_t> s_traceNext(0);
+static std::atomic<bool> s_tracing(false);
+static uint64_t s_traceOrigin = 0;
+
+// Threads are numbered in the order they first record, and named by b2SetTraceThreadName.
+static std::atomic<int32> s_traceThreadCount(0);
+static char s_traceThreadNames[b2_maxTraceThreads][32];
+static thread_local int32 s_traceThread = -1;
+
+static int32 b2GetTraceThread()
+{
+	if (s_traceThread < 0)
+	{
+		int32 thread = s_traceThreadCount.fetch_add(1);
+		s_traceThread = thread < b2_maxTraceThreads ? thread : b2_maxTraceThreads - 1;
+	}
+
+	return s_traceThread;
+}
+
+static b2TraceRecord* b2AddTraceRecord()
+{
+	uint64_t index = s_traceNext.fetch_add(1, std::memory_order_relaxed);
+	return s_traceRecords + index % (uint64_t)s_traceCapacity;
+}
+
+void b2StartTrace(int32 capacity)
+{
+	b2Assert(capacity > 0);
+
+	s_tracing = false;
+
+	b2Free(s_traceRecords);
+	s_traceRecords = (b2TraceRecord*)b2Alloc(capacity * sizeof(b2TraceRecord));
+	s_traceCapacity = capacity;
+	s_traceNext = 0;
+	s_traceOrigin = b2GetTraceTime();
+
+	s_tracing = true;
+}
+
+void b2StopTrace()
+{
+	s_tracing = false;
+}
+
+bool b2IsTracing()
+{
+	return s_tracing.load(std::memory_order_relaxed);
+}
+
+uint64_t b2GetTraceTime()
+{
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+void b2SetTraceThreadName(const char* name)
+{
+	int32 thread = b2GetTraceThread();
+	strncpy(s_traceThreadNames[thread], name, sizeof(s_traceThreadNames[thread]) - 1);
+}
+
+void b2TraceEvent(const char* name, uint64_t start)
+{
+	uint64_t end = b2GetTraceTime();
+	if (s_tracing.load(std::memory_order_relaxed) == false)
+	{
+		return;
+	}
+
+	b2TraceRecord* record = b2AddTraceRecord();
+	record->name = name;
+	record->time = start;
+	record->duration = end - start;
+	record->value = 0.0f;
+	record->thread = b2GetTraceThread();
+	record->type = e_traceComplete;
+}
+
+void b2TraceCounter(const char* name, float value)
+{
+	if (s_tracing.load(std::memory_order_relaxed) == false)
+	{
+		return;
+	}
+
+	b2TraceRecord* record = b2AddTraceRecord();
+	record->name = name;
+	record->time = b2GetTraceTime();
+	record->duration = 0;
+	record->value = value;
+	record->thread = b2GetTraceThread();
+	record->type = e_traceCounter;
+}
+
+bool b2WriteTrace(const char* fileName)
+{
+	FILE* file = fopen(fileName, "w");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+
+	// JSON allows no comma after the last event.
+	const char* separator = "\n";
+
+	int32 threadCount = b2Min(s_traceThreadCount.load(), b2_maxTraceThreads);
+	for (int32 i = 0; i < threadCount; ++i)
+	{
+		const char* name = s_traceThreadNames[i];
+		if (name[0] == 0)
+		{
+			continue;
+		}
+
+		fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+			separator, i, name);
+		separator = ",\n";
+	}
+
+	// Only the last capacity records are in the ring, oldest first.
+	uint64_t next = s_traceNext.load();
+	uint64_t count = next < (uint64_t)s_traceCapacity ? next : (uint64_t)s_traceCapacity;
+	for (uint64_t i = next - count; i < next; ++i)
+	{
+		const b2TraceRecord* record = s_traceRecords + i % (uint64_t)s_traceCapacity;
+
+		// Events that started before the trace did get negative time stamps.
+		double time = 1e-3 * (double)(int64_t)(record->time - s_traceOrigin);
+
+		if (record->type == e_traceComplete)
+		{
+			fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+				separator, record->name, record->thread, time, 1e-3 * (double)record->duration);
+		}
+		else
+		{
+			fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"C\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"args\": {\"value\": %g}}",
+				separator, record->name, record->thread, time, record->value);
+		}
+
+		separator = ",\n";
+	}
+
+	fprintf(file, "\n]}\n");
+
+	return fclose(file) == 0;
+}
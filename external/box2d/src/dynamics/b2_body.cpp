@@ -20,6 +20,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_island.h"
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_contact.h"
 #include "box2d/b2_fixture.h"
@@ -65,6 +68,8 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	m_xf.p = bd->position;
 	m_xf.q.Set(bd->angle);
 
+	m_creationIndex = world->m_bodyCreationCount++;
+
 	m_sweep.localCenter.SetZero();
 	m_sweep.c0 = m_xf.p;
 	m_sweep.c = m_xf.p;
@@ -77,6 +82,12 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	m_prev = nullptr;
 	m_next = nullptr;
 
+	m_islandId = b2_nullIsland;
+	m_islandPrev = nullptr;
+	m_islandNext = nullptr;
+
+	m_drawStamp = 0;
+
 	m_linearVelocity = bd->linearVelocity;
 	m_angularVelocity = bd->angularVelocity;
 
@@ -121,7 +132,19 @@ void b2Body::SetType(b2BodyType type)
 		return;
 	}
 
-	m_type = type;
+	if (m_type == b2_staticBody)
+	{
+		m_type = type;
+		m_world->AddToIsland(this);
+	}
+	else
+	{
+		m_type = type;
+		if (m_type == b2_staticBody)
+		{
+			m_world->RemoveFromIsland(this);
+		}
+	}
 
 	ResetMassData();
 
@@ -490,11 +513,15 @@ void b2Body::SetEnabled(bool flag)
 
 		// Contacts are created at the beginning of the next
 		m_world->m_newContacts = true;
+
+		m_world->AddToIsland(this);
 	}
 	else
 	{
 		m_flags &= ~e_enabledFlag;
 
+		m_world->RemoveFromIsland(this);
+
 		// Destroy all proxies.
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 		for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
@@ -514,6 +541,44 @@ void b2Body::SetEnabled(bool flag)
 	}
 }
 
+void b2Body::SetAwake(bool flag)
+{
+	if (m_type == b2_staticBody)
+	{
+		return;
+	}
+
+	if (flag)
+	{
+		if ((m_flags & e_awakeFlag) == 0)
+		{
+			// An awake body is always in an awake island.
+			if (m_islandId != b2_nullIsland)
+			{
+				m_world->WakeIsland(m_islandId);
+			}
+
+			// Its contacts may have become TOI candidates.
+			if (m_world->m_toiBatch != nullptr)
+			{
+				m_world->AddTOIWake(this);
+			}
+		}
+
+		m_flags |= e_awakeFlag;
+		m_sleepTime = 0.0f;
+	}
+	else
+	{
+		m_flags &= ~e_awakeFlag;
+		m_sleepTime = 0.0f;
+		m_linearVelocity.SetZero();
+		m_angularVelocity = 0.0f;
+		m_force.SetZero();
+		m_torque = 0.0f;
+	}
+}
+
 void b2Body::SetFixedRotation(bool flag)
 {
 	bool status = (m_flags & e_fixedRotationFlag) == e_fixedRotationFlag;
@@ -536,6 +601,33 @@ void b2Body::SetFixedRotation(bool flag)
 	ResetMassData();
 }
 
+void b2Body::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_type);
+	snapshot->Value(m_flags);
+	snapshot->Value(m_xf);
+	snapshot->Value(m_sweep);
+	snapshot->Value(m_linearVelocity);
+	snapshot->Value(m_angularVelocity);
+	snapshot->Value(m_force);
+	snapshot->Value(m_torque);
+	snapshot->Value(m_mass);
+	snapshot->Value(m_invMass);
+	snapshot->Value(m_I);
+	snapshot->Value(m_invI);
+	snapshot->Value(m_linearDamping);
+	snapshot->Value(m_angularDamping);
+	snapshot->Value(m_gravityScale);
+	snapshot->Value(m_sleepTime);
+	snapshot->Value(m_userData);
+
+	if (m_type != b2_staticBody && m_type != b2_kinematicBody && m_type != b2_dynamicBody)
+	{
+		m_type = b2_staticBody;
+		snapshot->SetInvalid();
+	}
+}
+
 void b2Body::Dump()
 {
 	int32 bodyIndex = m_islandIndex;
@@ -28,6 +28,7 @@
 #include "b2_edge_polygon_contact.h"
 #include "b2_polygon_circle_contact.h"
 #include "b2_polygon_contact.h"
+#include "common/b2_snapshot.h"
 
 #include "box2d/b2_contact.h"
 #include "box2d/b2_block_allocator.h"
@@ -153,6 +154,7 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_nodeB.other = nullptr;
 
 	m_toiCount = 0;
+	m_toiIndex = 0;
 
 	m_friction = b2MixFriction(m_fixtureA->m_friction, m_fixtureB->m_friction);
 	m_restitution = b2MixRestitution(m_fixtureA->m_restitution, m_fixtureB->m_restitution);
@@ -165,22 +167,23 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 // Note: do not assume the fixture AABBs are overlapping or are valid.
 void b2Contact::Update(b2ContactListener* listener)
 {
-	b2Manifold oldManifold = m_manifold;
+	b2Manifold oldManifold;
+	bool touching = UpdateManifold(&oldManifold);
+	FinishUpdate(touching, &oldManifold, listener);
+}
 
-	// Re-enable this contact.
-	m_flags |= e_enabledFlag;
+bool b2Contact::UpdateManifold(b2Manifold* oldManifold)
+{
+	*oldManifold = m_manifold;
 
 	bool touching = false;
-	bool wasTouching = (m_flags & e_touchingFlag) == e_touchingFlag;
 
 	bool sensorA = m_fixtureA->IsSensor();
 	bool sensorB = m_fixtureB->IsSensor();
 	bool sensor = sensorA || sensorB;
 
-	b2Body* bodyA = m_fixtureA->GetBody();
-	b2Body* bodyB = m_fixtureB->GetBody();
-	const b2Transform& xfA = bodyA->GetTransform();
-	const b2Transform& xfB = bodyB->GetTransform();
+	const b2Transform& xfA = m_fixtureA->GetBody()->GetTransform();
+	const b2Transform& xfB = m_fixtureB->GetBody()->GetTransform();
 
 	// Is this contact a sensor?
 	if (sensor)
@@ -206,9 +209,9 @@ void b2Contact::Update(b2ContactListener* listener)
 			mp2->tangentImpulse = 0.0f;
 			b2ContactID id2 = mp2->id;
 
-			for (int32 j = 0; j < oldManifold.pointCount; ++j)
+			for (int32 j = 0; j < oldManifold->pointCount; ++j)
 			{
-				b2ManifoldPoint* mp1 = oldManifold.points + j;
+				b2ManifoldPoint* mp1 = oldManifold->points + j;
 
 				if (mp1->id.key == id2.key)
 				{
@@ -218,12 +221,24 @@ void b2Contact::Update(b2ContactListener* listener)
 				}
 			}
 		}
+	}
 
-		if (touching != wasTouching)
-		{
-			bodyA->SetAwake(true);
-			bodyB->SetAwake(true);
-		}
+	return touching;
+}
+
+void b2Contact::FinishUpdate(bool touching, const b2Manifold* oldManifold, b2ContactListener* listener)
+{
+	// Re-enable this contact.
+	m_flags |= e_enabledFlag;
+
+	bool wasTouching = (m_flags & e_touchingFlag) == e_touchingFlag;
+
+	bool sensor = m_fixtureA->IsSensor() || m_fixtureB->IsSensor();
+
+	if (sensor == false && touching != wasTouching)
+	{
+		m_fixtureA->GetBody()->SetAwake(true);
+		m_fixtureB->GetBody()->SetAwake(true);
 	}
 
 	if (touching)
@@ -235,6 +250,26 @@ void b2Contact::Update(b2ContactListener* listener)
 		m_flags &= ~e_touchingFlag;
 	}
 
+	// A sensor can be turned off while it touches, so this is not only checked when
+	// touching changes.
+	bool linked = touching && sensor == false;
+	if (linked != ((m_flags & e_linkedFlag) == e_linkedFlag))
+	{
+		b2Body* bodyA = m_fixtureA->GetBody();
+		b2Body* bodyB = m_fixtureB->GetBody();
+
+		if (linked)
+		{
+			m_flags |= e_linkedFlag;
+			bodyA->m_world->LinkBodies(bodyA, bodyB);
+		}
+		else
+		{
+			m_flags &= ~e_linkedFlag;
+			bodyA->m_world->UnlinkBodies(bodyA, bodyB);
+		}
+	}
+
 	if (wasTouching == false && touching == true && listener)
 	{
 		listener->BeginContact(this);
@@ -247,6 +282,47 @@ void b2Contact::Update(b2ContactListener* listener)
 
 	if (sensor == false && touching && listener)
 	{
-		listener->PreSolve(this, &oldManifold);
+		listener->PreSolve(this, oldManifold);
+	}
+}
+
+void b2Contact::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_flags);
+
+	// Points past the point count and a toi without the toi flag are left over
+	// from earlier steps or never set. Save zeros so equal worlds give equal snapshots.
+	if (snapshot->IsLoading() == false)
+	{
+		for (int32 i = m_manifold.pointCount; i < b2_maxManifoldPoints; ++i)
+		{
+			memset(m_manifold.points + i, 0, sizeof(b2ManifoldPoint));
+		}
+
+		if (m_manifold.pointCount == 0)
+		{
+			m_manifold.localNormal.SetZero();
+			m_manifold.localPoint.SetZero();
+			m_manifold.type = b2Manifold::e_circles;
+		}
+
+		if ((m_flags & e_toiFlag) == 0)
+		{
+			m_toi = 1.0f;
+		}
+	}
+
+	snapshot->Value(m_manifold);
+	snapshot->Value(m_toiCount);
+	snapshot->Value(m_toi);
+	snapshot->Value(m_friction);
+	snapshot->Value(m_restitution);
+	snapshot->Value(m_restitutionThreshold);
+	snapshot->Value(m_tangentSpeed);
+
+	if (m_manifold.pointCount < 0 || m_manifold.pointCount > b2_maxManifoldPoints)
+	{
+		m_manifold.pointCount = 0;
+		snapshot->SetInvalid();
 	}
 }
@@ -20,22 +20,51 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "box2d/b2_allocator.h"
 #include "box2d/b2_body.h"
 #include "box2d/b2_contact.h"
 #include "box2d/b2_contact_manager.h"
 #include "box2d/b2_fixture.h"
+#include "box2d/b2_stack_allocator.h"
+#include "box2d/b2_trace.h"
+#include "box2d/b2_world.h"
 #include "box2d/b2_world_callbacks.h"
+#include "common/b2_thread_pool.h"
 
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
 
-b2ContactManager::b2ContactManager()
+struct b2ContactUpdate
+{
+	b2Contact* contact;
+	b2Manifold oldManifold;
+	bool touching;
+	bool sensor;	// the sensor flags the manifold was evaluated with
+};
+
+b2ContactManager::b2ContactManager(b2Allocator* allocator)
+	: m_broadPhase(allocator)
 {
 	m_contactList = nullptr;
 	m_contactCount = 0;
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = &b2_defaultListener;
 	m_allocator = nullptr;
+	m_stackAllocator = nullptr;
+	m_threadPool = nullptr;
+	m_bufferAllocator = allocator;
+	m_updateCapacity = 16;
+	m_updateBuffer = (b2ContactUpdate*)b2Allocate(m_bufferAllocator, m_updateCapacity * sizeof(b2ContactUpdate));
+}
+
+b2ContactManager::~b2ContactManager()
+{
+	b2Deallocate(m_bufferAllocator, m_updateBuffer, m_updateCapacity * sizeof(b2ContactUpdate));
+}
+
+int32 b2ContactManager::GetBufferBytes() const
+{
+	return m_updateCapacity * sizeof(b2ContactUpdate) + m_broadPhase.GetBufferBytes();
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -50,6 +79,11 @@ void b2ContactManager::Destroy(b2Contact* c)
 		m_contactListener->EndContact(c);
 	}
 
+	if (c->m_flags & b2Contact::e_linkedFlag)
+	{
+		bodyA->m_world->UnlinkBodies(bodyA, bodyB);
+	}
+
 	// Remove from the world.
 	if (c->m_prev)
 	{
@@ -108,6 +142,12 @@ void b2ContactManager::Destroy(b2Contact* c)
 // contact list.
 void b2ContactManager::Collide()
 {
+	if (m_threadPool)
+	{
+		CollideParallel();
+		return;
+	}
+
 	// Update awake contacts.
 	b2Contact* c = m_contactList;
 	while (c)
@@ -173,8 +213,209 @@ void b2ContactManager::Collide()
 	}
 }
 
+// What CollideParallel does with a contact after its manifold is evaluated.
+enum b2CollideAction
+{
+	e_collideDestroy,
+	e_collideUpdate,
+
+	// Both bodies were asleep before the manifolds were evaluated. A contact updated
+	// earlier in the list may still wake one of them.
+	e_collideDeferred
+};
+
+// Parallel task evaluating the manifolds of a range of b2ContactUpdate.
+void b2ContactManager::UpdateManifolds(int32 begin, int32 end, int32 workerIndex, void* context)
+{
+	B2_NOT_USED(workerIndex);
+
+	b2ContactUpdate* updates = (b2ContactUpdate*)context;
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2ContactUpdate* update = updates + i;
+		b2Contact* c = update->contact;
+		update->sensor = c->GetFixtureA()->IsSensor() || c->GetFixtureB()->IsSensor();
+		update->touching = c->UpdateManifold(&update->oldManifold);
+	}
+}
+
+bool b2ContactManager::FilterContact(b2Contact* c)
+{
+	b2Fixture* fixtureA = c->GetFixtureA();
+	b2Fixture* fixtureB = c->GetFixtureB();
+
+	// Should these bodies collide?
+	if (fixtureB->GetBody()->ShouldCollide(fixtureA->GetBody()) == false)
+	{
+		return false;
+	}
+
+	// Check user filtering.
+	if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
+	{
+		return false;
+	}
+
+	// Clear the filtering flag.
+	c->m_flags &= ~b2Contact::e_filterFlag;
+	return true;
+}
+
+// Same result as the serial loop in Collide. Filtering and the overlap tests run first,
+// then the manifolds of the awake contacts are evaluated in parallel. The flag changes,
+// body wake ups, destruction and listener callbacks follow in contact list order.
+// A listener called there may refilter a later contact, put its bodies to sleep or
+// change a sensor flag. The serial loop would see that before evaluating the contact,
+// so those contacts are checked again and their parallel manifold is dropped.
+void b2ContactManager::CollideParallel()
+{
+	int32 contactCount = m_contactCount;
+	if (contactCount == 0)
+	{
+		return;
+	}
+
+	// An update holds a whole manifold, so the updates would not fit the stack allocator
+	// for larger worlds. The buffer is kept instead.
+	if (contactCount > m_updateCapacity)
+	{
+		b2Deallocate(m_bufferAllocator, m_updateBuffer, m_updateCapacity * sizeof(b2ContactUpdate));
+		m_updateCapacity = contactCount + (contactCount >> 1);
+		m_updateBuffer = (b2ContactUpdate*)b2Allocate(m_bufferAllocator, m_updateCapacity * sizeof(b2ContactUpdate));
+	}
+
+	uint8* actions = (uint8*)m_stackAllocator->Allocate(contactCount * sizeof(uint8));
+	b2ContactUpdate* updates = m_updateBuffer;
+	int32 updateCount = 0;
+
+	int32 index = 0;
+	for (b2Contact* c = m_contactList; c; c = c->GetNext(), ++index)
+	{
+		b2Fixture* fixtureA = c->GetFixtureA();
+		b2Fixture* fixtureB = c->GetFixtureB();
+		b2Body* bodyA = fixtureA->GetBody();
+		b2Body* bodyB = fixtureB->GetBody();
+
+		// Is this contact flagged for filtering?
+		if ((c->m_flags & b2Contact::e_filterFlag) && FilterContact(c) == false)
+		{
+			actions[index] = e_collideDestroy;
+			continue;
+		}
+
+		bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+		bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+
+		if (activeA == false && activeB == false)
+		{
+			actions[index] = e_collideDeferred;
+			continue;
+		}
+
+		int32 proxyIdA = fixtureA->m_proxies[c->GetChildIndexA()].proxyId;
+		int32 proxyIdB = fixtureB->m_proxies[c->GetChildIndexB()].proxyId;
+
+		// Here we destroy contacts that cease to overlap in the broad-phase.
+		if (m_broadPhase.TestOverlap(proxyIdA, proxyIdB) == false)
+		{
+			actions[index] = e_collideDestroy;
+			continue;
+		}
+
+		actions[index] = e_collideUpdate;
+		updates[updateCount].contact = c;
+		++updateCount;
+	}
+
+	b2Assert(index == contactCount);
+
+	m_threadPool->ParallelFor(updateCount, 64, UpdateManifolds, updates);
+
+	// Only the contact itself is destroyed, so the next one is taken first.
+	int32 updateIndex = 0;
+	b2Contact* next = m_contactList;
+	for (int32 i = 0; i < contactCount; ++i)
+	{
+		b2Contact* c = next;
+		next = c->GetNext();
+
+		switch (actions[i])
+		{
+		case e_collideDestroy:
+			Destroy(c);
+			break;
+
+		case e_collideUpdate:
+		{
+			b2ContactUpdate* update = updates + updateIndex;
+			b2Assert(update->contact == c);
+			++updateIndex;
+
+			b2Body* bodyA = c->GetFixtureA()->GetBody();
+			b2Body* bodyB = c->GetFixtureB()->GetBody();
+			bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+			bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+			bool sensor = c->GetFixtureA()->IsSensor() || c->GetFixtureB()->IsSensor();
+
+			// Changed by a listener since the manifold was evaluated. The overlap test
+			// still holds, the broad-phase doesn't move proxies before the next step.
+			if ((c->m_flags & b2Contact::e_filterFlag) || (activeA == false && activeB == false) || sensor != update->sensor)
+			{
+				c->m_manifold = update->oldManifold;
+
+				if ((c->m_flags & b2Contact::e_filterFlag) && FilterContact(c) == false)
+				{
+					Destroy(c);
+				}
+				else if (activeA || activeB)
+				{
+					c->Update(m_contactListener);
+				}
+				break;
+			}
+
+			c->FinishUpdate(update->touching, &update->oldManifold, m_contactListener);
+			break;
+		}
+
+		case e_collideDeferred:
+		{
+			if ((c->m_flags & b2Contact::e_filterFlag) && FilterContact(c) == false)
+			{
+				Destroy(c);
+				break;
+			}
+
+			b2Body* bodyA = c->GetFixtureA()->GetBody();
+			b2Body* bodyB = c->GetFixtureB()->GetBody();
+			bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+			bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+
+			if (activeA == false && activeB == false)
+			{
+				break;
+			}
+
+			int32 proxyIdA = c->GetFixtureA()->m_proxies[c->GetChildIndexA()].proxyId;
+			int32 proxyIdB = c->GetFixtureB()->m_proxies[c->GetChildIndexB()].proxyId;
+			if (m_broadPhase.TestOverlap(proxyIdA, proxyIdB) == false)
+			{
+				Destroy(c);
+				break;
+			}
+
+			c->Update(m_contactListener);
+			break;
+		}
+		}
+	}
+
+	m_stackAllocator->Free(actions);
+}
+
 void b2ContactManager::FindNewContacts()
 {
+	B2_TRACE_SCOPE("UpdatePairs");
 	m_broadPhase.UpdatePairs(this);
 }
 
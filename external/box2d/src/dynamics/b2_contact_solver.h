@@ -30,7 +30,9 @@
 class b2Contact;
 class b2Body;
 class b2StackAllocator;
-struct b2ContactPositionConstraint;
+struct b2WideContactSolver;
+
+extern B2_API bool g_blockSolve;
 
 struct b2VelocityConstraintPoint
 {
@@ -61,6 +63,21 @@ struct b2ContactVelocityConstraint
 	int32 contactIndex;
 };
 
+struct b2ContactPositionConstraint
+{
+	b2Vec2 localPoints[b2_maxManifoldPoints];
+	b2Vec2 localNormal;
+	b2Vec2 localPoint;
+	int32 indexA;
+	int32 indexB;
+	float invMassA, invMassB;
+	b2Vec2 localCenterA, localCenterB;
+	float invIA, invIB;
+	b2Manifold::Type type;
+	float radiusA, radiusB;
+	int32 pointCount;
+};
+
 struct b2ContactSolverDef
 {
 	b2TimeStep step;
@@ -94,6 +111,22 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+
+	// The wide solver, if the step asks for one. It solves the colored contacts
+	// and the scalar solver solves the overflow contacts after them.
+	const b2WideContactSolver* m_wide;
+	int32* m_wideLanes;
+	void* m_wideVelocityConstraints;
+	void* m_widePositionConstraints;
+	int32 m_wideBatchCount;
+	int32* m_overflowConstraints;
+	int32 m_overflowCount;
+
+private:
+
+	void PrepareWide();
+	void SolveVelocityConstraint(b2ContactVelocityConstraint* vc);
+	float SolvePositionConstraint(const b2ContactPositionConstraint* pc);
 };
 
 #endif
@@ -0,0 +1,160 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// This file is compiled with AVX2 enabled. b2GetWideContactSolver only uses it
+// after checking that the CPU supports AVX2.
+
+#include "b2_contact_solver.h"
+#include "b2_contact_solver_wide.h"
+
+#include "box2d/b2_time_step.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace
+{
+
+struct b2FloatW
+{
+	enum { width = 8 };
+
+	static b2FloatW Load(const float* p)
+	{
+		b2FloatW r = { _mm256_loadu_ps(p) };
+		return r;
+	}
+
+	static void Store(float* p, b2FloatW a)
+	{
+		_mm256_storeu_ps(p, a.m);
+	}
+
+	static b2FloatW Splat(float a)
+	{
+		b2FloatW r = { _mm256_set1_ps(a) };
+		return r;
+	}
+
+	static b2FloatW Zero()
+	{
+		b2FloatW r = { _mm256_setzero_ps() };
+		return r;
+	}
+
+	__m256 m;
+};
+
+inline b2FloatW operator+(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm256_add_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW operator-(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm256_sub_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW operator*(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm256_mul_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW operator/(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm256_div_ps(a.m, b.m) };
+	return r;
+}
+
+// Flips the sign bit like scalar negation.
+inline b2FloatW operator-(b2FloatW a)
+{
+	b2FloatW r = { _mm256_xor_ps(a.m, _mm256_set1_ps(-0.0f)) };
+	return r;
+}
+
+// Same as b2Min and b2Max: the second argument when the comparison fails.
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm256_min_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm256_max_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW b2SqrtW(b2FloatW a)
+{
+	b2FloatW r = { _mm256_sqrt_ps(a.m) };
+	return r;
+}
+
+inline b2FloatW b2GreaterW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm256_cmp_ps(a.m, b.m, _CMP_GT_OQ) };
+	return r;
+}
+
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm256_cmp_ps(a.m, b.m, _CMP_GE_OQ) };
+	return r;
+}
+
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm256_and_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW b2BlendW(b2FloatW a, b2FloatW b, b2FloatW mask)
+{
+	b2FloatW r = { _mm256_blendv_ps(a.m, b.m, mask.m) };
+	return r;
+}
+
+#include "b2_contact_solver_wide_impl.h"
+
+}
+
+const b2WideContactSolver* b2GetAVX2ContactSolver()
+{
+	return &b2_wideContactSolver;
+}
+
+#else
+
+const b2WideContactSolver* b2GetAVX2ContactSolver()
+{
+	return nullptr;
+}
+
+#endif
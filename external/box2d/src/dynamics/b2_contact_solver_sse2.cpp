@@ -0,0 +1,157 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "b2_contact_solver.h"
+#include "b2_contact_solver_wide.h"
+
+#include "box2d/b2_time_step.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include <emmintrin.h>
+
+namespace
+{
+
+struct b2FloatW
+{
+	enum { width = 4 };
+
+	static b2FloatW Load(const float* p)
+	{
+		b2FloatW r = { _mm_loadu_ps(p) };
+		return r;
+	}
+
+	static void Store(float* p, b2FloatW a)
+	{
+		_mm_storeu_ps(p, a.m);
+	}
+
+	static b2FloatW Splat(float a)
+	{
+		b2FloatW r = { _mm_set1_ps(a) };
+		return r;
+	}
+
+	static b2FloatW Zero()
+	{
+		b2FloatW r = { _mm_setzero_ps() };
+		return r;
+	}
+
+	__m128 m;
+};
+
+inline b2FloatW operator+(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm_add_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW operator-(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm_sub_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW operator*(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm_mul_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW operator/(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm_div_ps(a.m, b.m) };
+	return r;
+}
+
+// Flips the sign bit like scalar negation.
+inline b2FloatW operator-(b2FloatW a)
+{
+	b2FloatW r = { _mm_xor_ps(a.m, _mm_set1_ps(-0.0f)) };
+	return r;
+}
+
+// Same as b2Min and b2Max: the second argument when the comparison fails.
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm_min_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm_max_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW b2SqrtW(b2FloatW a)
+{
+	b2FloatW r = { _mm_sqrt_ps(a.m) };
+	return r;
+}
+
+inline b2FloatW b2GreaterW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm_cmpgt_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm_cmpge_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b)
+{
+	b2FloatW r = { _mm_and_ps(a.m, b.m) };
+	return r;
+}
+
+inline b2FloatW b2BlendW(b2FloatW a, b2FloatW b, b2FloatW mask)
+{
+	b2FloatW r = { _mm_or_ps(_mm_and_ps(mask.m, b.m), _mm_andnot_ps(mask.m, a.m)) };
+	return r;
+}
+
+#include "b2_contact_solver_wide_impl.h"
+
+}
+
+const b2WideContactSolver* b2GetSSE2ContactSolver()
+{
+	return &b2_wideContactSolver;
+}
+
+#else
+
+const b2WideContactSolver* b2GetSSE2ContactSolver()
+{
+	return nullptr;
+}
+
+#endif
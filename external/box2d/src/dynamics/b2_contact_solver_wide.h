@@ -0,0 +1,74 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef B2_CONTACT_SOLVER_WIDE_H
+#define B2_CONTACT_SOLVER_WIDE_H
+
+#include "box2d/b2_settings.h"
+
+struct b2ContactVelocityConstraint;
+struct b2ContactPositionConstraint;
+struct b2Position;
+struct b2Velocity;
+
+/// The graph coloring never uses more colors than this. Contacts that don't
+/// fit are solved by the scalar solver after the colored ones.
+#define b2_wideColorCount 16
+
+/// This is an internal structure. Solves contacts several at a time, one in
+/// each SIMD lane. The contacts are given as batches of width contacts that
+/// share no moving body, see b2ContactSolver. A lane without a contact holds
+/// the index -1.
+struct b2WideContactSolver
+{
+	int32 width;
+
+	/// Size in bytes of one batch of velocity or position constraints.
+	int32 velocityBatchSize;
+	int32 positionBatchSize;
+
+	/// Copy the scalar constraints into the batches. lanes holds batchCount * width
+	/// constraint indices.
+	void (*prepare)(void* velocityBatches, void* positionBatches, const int32* lanes, int32 batchCount,
+					const b2ContactVelocityConstraint* velocityConstraints,
+					const b2ContactPositionConstraint* positionConstraints);
+
+	void (*solveVelocity)(void* velocityBatches, int32 batchCount, b2Velocity* velocities);
+
+	/// Copy the accumulated impulses back into the scalar constraints.
+	void (*storeImpulses)(const void* velocityBatches, const int32* lanes, int32 batchCount,
+						  b2ContactVelocityConstraint* velocityConstraints);
+
+	/// Returns the smallest separation found.
+	float (*solvePosition)(const void* positionBatches, int32 batchCount, b2Position* positions);
+};
+
+/// The widest contact solver the CPU supports: 8 lanes with AVX2, 4 lanes with SSE2
+/// and 1 when there is no wide solver.
+int32 b2GetMaxContactSolverWidth();
+
+/// Get the solver with the given number of lanes, nullptr if the CPU doesn't support it.
+const b2WideContactSolver* b2GetWideContactSolver(int32 width);
+
+const b2WideContactSolver* b2GetSSE2ContactSolver();
+const b2WideContactSolver* b2GetAVX2ContactSolver();
+
+#endif
@@ -0,0 +1,770 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The SIMD contact solvers include this file inside an anonymous namespace after
+// they define their lane type b2FloatW, so each of them gets its own copy compiled
+// for its instruction set. Box2D inline functions must not be called here, a copy
+// compiled for a wider instruction set could replace the one the rest of the
+// library uses. The includer also provides b2_contact_solver.h, b2_time_step.h,
+// math.h and string.h.
+//
+// b2FloatW provides:
+// - width, the number of lanes
+// - Load, Store, Splat and Zero as static functions
+// - the arithmetic operators
+// - b2MinW, b2MaxW, b2SqrtW, b2GreaterW, b2GreaterEqualW and b2AndW, the
+//   comparisons return a lane mask
+// - b2BlendW(a, b, mask) returns b in the lanes of the mask and a elsewhere
+
+#ifndef B2_CONTACT_SOLVER_WIDE_IMPL_H
+#define B2_CONTACT_SOLVER_WIDE_IMPL_H
+
+// The velocity constraints of width contacts, one per lane. See b2ContactVelocityConstraint.
+// Points that a contact doesn't have are zero.
+struct b2WideVelocityConstraint
+{
+	float normalX[b2FloatW::width];
+	float normalY[b2FloatW::width];
+	float friction[b2FloatW::width];
+	float tangentSpeed[b2FloatW::width];
+	float invMassA[b2FloatW::width];
+	float invIA[b2FloatW::width];
+	float invMassB[b2FloatW::width];
+	float invIB[b2FloatW::width];
+
+	float rA1X[b2FloatW::width];
+	float rA1Y[b2FloatW::width];
+	float rB1X[b2FloatW::width];
+	float rB1Y[b2FloatW::width];
+	float normalMass1[b2FloatW::width];
+	float tangentMass1[b2FloatW::width];
+	float velocityBias1[b2FloatW::width];
+	float normalImpulse1[b2FloatW::width];
+	float tangentImpulse1[b2FloatW::width];
+
+	float rA2X[b2FloatW::width];
+	float rA2Y[b2FloatW::width];
+	float rB2X[b2FloatW::width];
+	float rB2Y[b2FloatW::width];
+	float normalMass2[b2FloatW::width];
+	float tangentMass2[b2FloatW::width];
+	float velocityBias2[b2FloatW::width];
+	float normalImpulse2[b2FloatW::width];
+	float tangentImpulse2[b2FloatW::width];
+
+	// Block solver, K and its inverse by rows.
+	float blockSolve[b2FloatW::width];
+	float k11[b2FloatW::width];
+	float k12[b2FloatW::width];
+	float k21[b2FloatW::width];
+	float k22[b2FloatW::width];
+	float normalMass11[b2FloatW::width];
+	float normalMass12[b2FloatW::width];
+	float normalMass21[b2FloatW::width];
+	float normalMass22[b2FloatW::width];
+
+	int32 indexA[b2FloatW::width];
+	int32 indexB[b2FloatW::width];
+};
+
+// The position constraints of width contacts. See b2ContactPositionConstraint.
+struct b2WidePositionConstraint
+{
+	float localCenterAX[b2FloatW::width];
+	float localCenterAY[b2FloatW::width];
+	float localCenterBX[b2FloatW::width];
+	float localCenterBY[b2FloatW::width];
+	float invMassA[b2FloatW::width];
+	float invIA[b2FloatW::width];
+	float invMassB[b2FloatW::width];
+	float invIB[b2FloatW::width];
+
+	float localNormalX[b2FloatW::width];
+	float localNormalY[b2FloatW::width];
+	float localPointX[b2FloatW::width];
+	float localPointY[b2FloatW::width];
+	float localPoint1X[b2FloatW::width];
+	float localPoint1Y[b2FloatW::width];
+	float localPoint2X[b2FloatW::width];
+	float localPoint2Y[b2FloatW::width];
+	float radiusA[b2FloatW::width];
+	float radiusB[b2FloatW::width];
+
+	// 1 or 0 per lane
+	float hasPoint1[b2FloatW::width];
+	float hasPoint2[b2FloatW::width];
+	float isCircles[b2FloatW::width];
+	float isFaceB[b2FloatW::width];
+
+	int32 indexA[b2FloatW::width];
+	int32 indexB[b2FloatW::width];
+};
+
+struct b2Vec2W
+{
+	b2FloatW x, y;
+};
+
+static inline b2FloatW b2LoadMaskW(const float* flags)
+{
+	return b2GreaterW(b2FloatW::Load(flags), b2FloatW::Zero());
+}
+
+static inline void b2GatherVelocitiesW(b2Vec2W* v, b2FloatW* w, const int32* indices, const b2Velocity* velocities)
+{
+	float x[b2FloatW::width], y[b2FloatW::width], a[b2FloatW::width];
+	for (int32 i = 0; i < b2FloatW::width; ++i)
+	{
+		int32 index = indices[i];
+		if (index < 0)
+		{
+			x[i] = 0.0f;
+			y[i] = 0.0f;
+			a[i] = 0.0f;
+		}
+		else
+		{
+			x[i] = velocities[index].v.x;
+			y[i] = velocities[index].v.y;
+			a[i] = velocities[index].w;
+		}
+	}
+
+	v->x = b2FloatW::Load(x);
+	v->y = b2FloatW::Load(y);
+	*w = b2FloatW::Load(a);
+}
+
+// Bodies that appear in several lanes have no mass and get back the value they had.
+static inline void b2ScatterVelocitiesW(b2Velocity* velocities, const int32* indices, const b2Vec2W& v, b2FloatW w)
+{
+	float x[b2FloatW::width], y[b2FloatW::width], a[b2FloatW::width];
+	b2FloatW::Store(x, v.x);
+	b2FloatW::Store(y, v.y);
+	b2FloatW::Store(a, w);
+
+	for (int32 i = 0; i < b2FloatW::width; ++i)
+	{
+		int32 index = indices[i];
+		if (index >= 0)
+		{
+			velocities[index].v.x = x[i];
+			velocities[index].v.y = y[i];
+			velocities[index].w = a[i];
+		}
+	}
+}
+
+static inline void b2GatherPositionsW(b2Vec2W* c, b2FloatW* a, const int32* indices, const b2Position* positions)
+{
+	float x[b2FloatW::width], y[b2FloatW::width], angle[b2FloatW::width];
+	for (int32 i = 0; i < b2FloatW::width; ++i)
+	{
+		int32 index = indices[i];
+		if (index < 0)
+		{
+			x[i] = 0.0f;
+			y[i] = 0.0f;
+			angle[i] = 0.0f;
+		}
+		else
+		{
+			x[i] = positions[index].c.x;
+			y[i] = positions[index].c.y;
+			angle[i] = positions[index].a;
+		}
+	}
+
+	c->x = b2FloatW::Load(x);
+	c->y = b2FloatW::Load(y);
+	*a = b2FloatW::Load(angle);
+}
+
+static inline void b2ScatterPositionsW(b2Position* positions, const int32* indices, const b2Vec2W& c, b2FloatW a)
+{
+	float x[b2FloatW::width], y[b2FloatW::width], angle[b2FloatW::width];
+	b2FloatW::Store(x, c.x);
+	b2FloatW::Store(y, c.y);
+	b2FloatW::Store(angle, a);
+
+	for (int32 i = 0; i < b2FloatW::width; ++i)
+	{
+		int32 index = indices[i];
+		if (index >= 0)
+		{
+			positions[index].c.x = x[i];
+			positions[index].c.y = y[i];
+			positions[index].a = angle[i];
+		}
+	}
+}
+
+// Sine and cosine per lane with the same functions b2Rot uses.
+static inline void b2SinCosW(b2FloatW* s, b2FloatW* c, b2FloatW angle)
+{
+	float a[b2FloatW::width], sines[b2FloatW::width], cosines[b2FloatW::width];
+	b2FloatW::Store(a, angle);
+
+	for (int32 i = 0; i < b2FloatW::width; ++i)
+	{
+		sines[i] = sinf(a[i]);
+		cosines[i] = cosf(a[i]);
+	}
+
+	*s = b2FloatW::Load(sines);
+	*c = b2FloatW::Load(cosines);
+}
+
+static inline b2FloatW b2CrossW(const b2Vec2W& a, const b2Vec2W& b)
+{
+	return a.x * b.y - a.y * b.x;
+}
+
+static inline b2FloatW b2DotW(const b2Vec2W& a, const b2Vec2W& b)
+{
+	return a.x * b.x + a.y * b.y;
+}
+
+// vB + b2Cross(wB, rB) - vA - b2Cross(wA, rA)
+static inline b2Vec2W b2RelativeVelocityW(const b2Vec2W& vA, b2FloatW wA, const b2Vec2W& rA,
+										  const b2Vec2W& vB, b2FloatW wB, const b2Vec2W& rB)
+{
+	b2Vec2W dv;
+	dv.x = vB.x - wB * rB.y - vA.x + wA * rA.y;
+	dv.y = vB.y + wB * rB.x - vA.y - wA * rA.x;
+	return dv;
+}
+
+struct b2BodyPairW
+{
+	b2Vec2W vA;
+	b2FloatW wA;
+	b2Vec2W vB;
+	b2FloatW wB;
+};
+
+static inline void b2ApplyImpulseW(b2BodyPairW* bodies, b2FloatW mA, b2FloatW iA, b2FloatW mB, b2FloatW iB,
+								   const b2Vec2W& rA, const b2Vec2W& rB, const b2Vec2W& P)
+{
+	bodies->vA.x = bodies->vA.x - mA * P.x;
+	bodies->vA.y = bodies->vA.y - mA * P.y;
+	bodies->wA = bodies->wA - iA * b2CrossW(rA, P);
+
+	bodies->vB.x = bodies->vB.x + mB * P.x;
+	bodies->vB.y = bodies->vB.y + mB * P.y;
+	bodies->wB = bodies->wB + iB * b2CrossW(rB, P);
+}
+
+static inline b2BodyPairW b2BlendW(const b2BodyPairW& a, const b2BodyPairW& b, b2FloatW mask)
+{
+	b2BodyPairW r;
+	r.vA.x = b2BlendW(a.vA.x, b.vA.x, mask);
+	r.vA.y = b2BlendW(a.vA.y, b.vA.y, mask);
+	r.wA = b2BlendW(a.wA, b.wA, mask);
+	r.vB.x = b2BlendW(a.vB.x, b.vB.x, mask);
+	r.vB.y = b2BlendW(a.vB.y, b.vB.y, mask);
+	r.wB = b2BlendW(a.wB, b.wB, mask);
+	return r;
+}
+
+static void b2PrepareW(void* velocityBatches, void* positionBatches, const int32* lanes, int32 batchCount,
+					   const b2ContactVelocityConstraint* velocityConstraints,
+					   const b2ContactPositionConstraint* positionConstraints)
+{
+	b2WideVelocityConstraint* wvcs = (b2WideVelocityConstraint*)velocityBatches;
+	b2WidePositionConstraint* wpcs = (b2WidePositionConstraint*)positionBatches;
+
+	memset(wvcs, 0, batchCount * sizeof(b2WideVelocityConstraint));
+	memset(wpcs, 0, batchCount * sizeof(b2WidePositionConstraint));
+
+	for (int32 i = 0; i < batchCount; ++i)
+	{
+		b2WideVelocityConstraint* wvc = wvcs + i;
+		b2WidePositionConstraint* wpc = wpcs + i;
+
+		for (int32 j = 0; j < b2FloatW::width; ++j)
+		{
+			int32 index = lanes[i * b2FloatW::width + j];
+			if (index < 0)
+			{
+				wvc->indexA[j] = -1;
+				wvc->indexB[j] = -1;
+				wpc->indexA[j] = -1;
+				wpc->indexB[j] = -1;
+				continue;
+			}
+
+			const b2ContactVelocityConstraint* vc = velocityConstraints + index;
+
+			wvc->indexA[j] = vc->indexA;
+			wvc->indexB[j] = vc->indexB;
+			wvc->normalX[j] = vc->normal.x;
+			wvc->normalY[j] = vc->normal.y;
+			wvc->friction[j] = vc->friction;
+			wvc->tangentSpeed[j] = vc->tangentSpeed;
+			wvc->invMassA[j] = vc->invMassA;
+			wvc->invIA[j] = vc->invIA;
+			wvc->invMassB[j] = vc->invMassB;
+			wvc->invIB[j] = vc->invIB;
+
+			const b2VelocityConstraintPoint* vcp1 = vc->points + 0;
+			wvc->rA1X[j] = vcp1->rA.x;
+			wvc->rA1Y[j] = vcp1->rA.y;
+			wvc->rB1X[j] = vcp1->rB.x;
+			wvc->rB1Y[j] = vcp1->rB.y;
+			wvc->normalMass1[j] = vcp1->normalMass;
+			wvc->tangentMass1[j] = vcp1->tangentMass;
+			wvc->velocityBias1[j] = vcp1->velocityBias;
+			wvc->normalImpulse1[j] = vcp1->normalImpulse;
+			wvc->tangentImpulse1[j] = vcp1->tangentImpulse;
+
+			// The point count may have been reduced to one for the block solver.
+			if (vc->pointCount == 2)
+			{
+				const b2VelocityConstraintPoint* vcp2 = vc->points + 1;
+				wvc->rA2X[j] = vcp2->rA.x;
+				wvc->rA2Y[j] = vcp2->rA.y;
+				wvc->rB2X[j] = vcp2->rB.x;
+				wvc->rB2Y[j] = vcp2->rB.y;
+				wvc->normalMass2[j] = vcp2->normalMass;
+				wvc->tangentMass2[j] = vcp2->tangentMass;
+				wvc->velocityBias2[j] = vcp2->velocityBias;
+				wvc->normalImpulse2[j] = vcp2->normalImpulse;
+				wvc->tangentImpulse2[j] = vcp2->tangentImpulse;
+
+				if (g_blockSolve)
+				{
+					wvc->blockSolve[j] = 1.0f;
+					wvc->k11[j] = vc->K.ex.x;
+					wvc->k12[j] = vc->K.ey.x;
+					wvc->k21[j] = vc->K.ex.y;
+					wvc->k22[j] = vc->K.ey.y;
+					wvc->normalMass11[j] = vc->normalMass.ex.x;
+					wvc->normalMass12[j] = vc->normalMass.ey.x;
+					wvc->normalMass21[j] = vc->normalMass.ex.y;
+					wvc->normalMass22[j] = vc->normalMass.ey.y;
+				}
+			}
+
+			const b2ContactPositionConstraint* pc = positionConstraints + index;
+
+			wpc->indexA[j] = pc->indexA;
+			wpc->indexB[j] = pc->indexB;
+			wpc->localCenterAX[j] = pc->localCenterA.x;
+			wpc->localCenterAY[j] = pc->localCenterA.y;
+			wpc->localCenterBX[j] = pc->localCenterB.x;
+			wpc->localCenterBY[j] = pc->localCenterB.y;
+			wpc->invMassA[j] = pc->invMassA;
+			wpc->invIA[j] = pc->invIA;
+			wpc->invMassB[j] = pc->invMassB;
+			wpc->invIB[j] = pc->invIB;
+			wpc->localNormalX[j] = pc->localNormal.x;
+			wpc->localNormalY[j] = pc->localNormal.y;
+			wpc->localPointX[j] = pc->localPoint.x;
+			wpc->localPointY[j] = pc->localPoint.y;
+			wpc->localPoint1X[j] = pc->localPoints[0].x;
+			wpc->localPoint1Y[j] = pc->localPoints[0].y;
+			wpc->radiusA[j] = pc->radiusA;
+			wpc->radiusB[j] = pc->radiusB;
+			wpc->hasPoint1[j] = 1.0f;
+			wpc->isCircles[j] = pc->type == b2Manifold::e_circles ? 1.0f : 0.0f;
+			wpc->isFaceB[j] = pc->type == b2Manifold::e_faceB ? 1.0f : 0.0f;
+
+			if (pc->pointCount == 2)
+			{
+				wpc->localPoint2X[j] = pc->localPoints[1].x;
+				wpc->localPoint2Y[j] = pc->localPoints[1].y;
+				wpc->hasPoint2[j] = 1.0f;
+			}
+		}
+	}
+}
+
+static void b2SolveVelocityW(void* velocityBatches, int32 batchCount, b2Velocity* velocities)
+{
+	b2WideVelocityConstraint* wvcs = (b2WideVelocityConstraint*)velocityBatches;
+	const b2FloatW zero = b2FloatW::Zero();
+
+	for (int32 i = 0; i < batchCount; ++i)
+	{
+		b2WideVelocityConstraint* wvc = wvcs + i;
+
+		b2BodyPairW bodies;
+		b2GatherVelocitiesW(&bodies.vA, &bodies.wA, wvc->indexA, velocities);
+		b2GatherVelocitiesW(&bodies.vB, &bodies.wB, wvc->indexB, velocities);
+
+		b2FloatW mA = b2FloatW::Load(wvc->invMassA);
+		b2FloatW iA = b2FloatW::Load(wvc->invIA);
+		b2FloatW mB = b2FloatW::Load(wvc->invMassB);
+		b2FloatW iB = b2FloatW::Load(wvc->invIB);
+
+		b2Vec2W normal = { b2FloatW::Load(wvc->normalX), b2FloatW::Load(wvc->normalY) };
+		b2Vec2W tangent = { normal.y, -normal.x };
+		b2FloatW friction = b2FloatW::Load(wvc->friction);
+		b2FloatW tangentSpeed = b2FloatW::Load(wvc->tangentSpeed);
+
+		b2Vec2W rA1 = { b2FloatW::Load(wvc->rA1X), b2FloatW::Load(wvc->rA1Y) };
+		b2Vec2W rB1 = { b2FloatW::Load(wvc->rB1X), b2FloatW::Load(wvc->rB1Y) };
+		b2Vec2W rA2 = { b2FloatW::Load(wvc->rA2X), b2FloatW::Load(wvc->rA2Y) };
+		b2Vec2W rB2 = { b2FloatW::Load(wvc->rB2X), b2FloatW::Load(wvc->rB2Y) };
+
+		b2FloatW normalImpulse1 = b2FloatW::Load(wvc->normalImpulse1);
+		b2FloatW normalImpulse2 = b2FloatW::Load(wvc->normalImpulse2);
+
+		// Solve tangent constraints first because non-penetration is more important
+		// than friction.
+		{
+			b2FloatW tangentImpulse1 = b2FloatW::Load(wvc->tangentImpulse1);
+			b2Vec2W dv = b2RelativeVelocityW(bodies.vA, bodies.wA, rA1, bodies.vB, bodies.wB, rB1);
+			b2FloatW vt = b2DotW(dv, tangent) - tangentSpeed;
+			b2FloatW lambda = b2FloatW::Load(wvc->tangentMass1) * (-vt);
+			b2FloatW maxFriction = friction * normalImpulse1;
+			b2FloatW newImpulse = b2MaxW(-maxFriction, b2MinW(tangentImpulse1 + lambda, maxFriction));
+			lambda = newImpulse - tangentImpulse1;
+			b2FloatW::Store(wvc->tangentImpulse1, newImpulse);
+
+			b2Vec2W P = { lambda * tangent.x, lambda * tangent.y };
+			b2ApplyImpulseW(&bodies, mA, iA, mB, iB, rA1, rB1, P);
+		}
+
+		{
+			// Missing second points have no mass and no normal impulse, so this does nothing for them.
+			b2FloatW tangentImpulse2 = b2FloatW::Load(wvc->tangentImpulse2);
+			b2Vec2W dv = b2RelativeVelocityW(bodies.vA, bodies.wA, rA2, bodies.vB, bodies.wB, rB2);
+			b2FloatW vt = b2DotW(dv, tangent) - tangentSpeed;
+			b2FloatW lambda = b2FloatW::Load(wvc->tangentMass2) * (-vt);
+			b2FloatW maxFriction = friction * normalImpulse2;
+			b2FloatW newImpulse = b2MaxW(-maxFriction, b2MinW(tangentImpulse2 + lambda, maxFriction));
+			lambda = newImpulse - tangentImpulse2;
+			b2FloatW::Store(wvc->tangentImpulse2, newImpulse);
+
+			b2Vec2W P = { lambda * tangent.x, lambda * tangent.y };
+			b2ApplyImpulseW(&bodies, mA, iA, mB, iB, rA2, rB2, P);
+		}
+
+		// Solve normal constraints one point after the other.
+		b2BodyPairW sequential = bodies;
+		b2FloatW sequentialImpulse1, sequentialImpulse2;
+		{
+			b2Vec2W dv = b2RelativeVelocityW(sequential.vA, sequential.wA, rA1, sequential.vB, sequential.wB, rB1);
+			b2FloatW vn = b2DotW(dv, normal);
+			b2FloatW lambda = -b2FloatW::Load(wvc->normalMass1) * (vn - b2FloatW::Load(wvc->velocityBias1));
+			sequentialImpulse1 = b2MaxW(normalImpulse1 + lambda, zero);
+			lambda = sequentialImpulse1 - normalImpulse1;
+
+			b2Vec2W P = { lambda * normal.x, lambda * normal.y };
+			b2ApplyImpulseW(&sequential, mA, iA, mB, iB, rA1, rB1, P);
+		}
+
+		{
+			b2Vec2W dv = b2RelativeVelocityW(sequential.vA, sequential.wA, rA2, sequential.vB, sequential.wB, rB2);
+			b2FloatW vn = b2DotW(dv, normal);
+			b2FloatW lambda = -b2FloatW::Load(wvc->normalMass2) * (vn - b2FloatW::Load(wvc->velocityBias2));
+			sequentialImpulse2 = b2MaxW(normalImpulse2 + lambda, zero);
+			lambda = sequentialImpulse2 - normalImpulse2;
+
+			b2Vec2W P = { lambda * normal.x, lambda * normal.y };
+			b2ApplyImpulseW(&sequential, mA, iA, mB, iB, rA2, rB2, P);
+		}
+
+		// Block solver, see b2ContactSolver::SolveVelocityConstraints. All four cases are
+		// evaluated and the first valid one is taken. Without a valid case nothing changes.
+		b2FloatW blockSolve = b2LoadMaskW(wvc->blockSolve);
+		b2BodyPairW block = bodies;
+		b2FloatW blockImpulse1, blockImpulse2;
+		{
+			b2FloatW k11 = b2FloatW::Load(wvc->k11);
+			b2FloatW k12 = b2FloatW::Load(wvc->k12);
+			b2FloatW k21 = b2FloatW::Load(wvc->k21);
+			b2FloatW k22 = b2FloatW::Load(wvc->k22);
+
+			b2FloatW ax = normalImpulse1;
+			b2FloatW ay = normalImpulse2;
+
+			b2Vec2W dv1 = b2RelativeVelocityW(block.vA, block.wA, rA1, block.vB, block.wB, rB1);
+			b2Vec2W dv2 = b2RelativeVelocityW(block.vA, block.wA, rA2, block.vB, block.wB, rB2);
+
+			b2FloatW vn1 = b2DotW(dv1, normal);
+			b2FloatW vn2 = b2DotW(dv2, normal);
+
+			b2FloatW bx = vn1 - b2FloatW::Load(wvc->velocityBias1);
+			b2FloatW by = vn2 - b2FloatW::Load(wvc->velocityBias2);
+
+			// Compute b'
+			bx = bx - (k11 * ax + k12 * ay);
+			by = by - (k21 * ax + k22 * ay);
+
+			// Case 4: x1 = 0 and x2 = 0
+			b2FloatW xx = b2BlendW(ax, zero, b2AndW(b2GreaterEqualW(bx, zero), b2GreaterEqualW(by, zero)));
+			b2FloatW xy = b2BlendW(ay, zero, b2AndW(b2GreaterEqualW(bx, zero), b2GreaterEqualW(by, zero)));
+
+			// Case 3: vn2 = 0 and x1 = 0
+			b2FloatW x3 = -b2FloatW::Load(wvc->normalMass2) * by;
+			b2FloatW valid = b2AndW(b2GreaterEqualW(x3, zero), b2GreaterEqualW(k12 * x3 + bx, zero));
+			xx = b2BlendW(xx, zero, valid);
+			xy = b2BlendW(xy, x3, valid);
+
+			// Case 2: vn1 = 0 and x2 = 0
+			b2FloatW x2 = -b2FloatW::Load(wvc->normalMass1) * bx;
+			valid = b2AndW(b2GreaterEqualW(x2, zero), b2GreaterEqualW(k21 * x2 + by, zero));
+			xx = b2BlendW(xx, x2, valid);
+			xy = b2BlendW(xy, zero, valid);
+
+			// Case 1: vn = 0
+			b2FloatW x1x = -(b2FloatW::Load(wvc->normalMass11) * bx + b2FloatW::Load(wvc->normalMass12) * by);
+			b2FloatW x1y = -(b2FloatW::Load(wvc->normalMass21) * bx + b2FloatW::Load(wvc->normalMass22) * by);
+			valid = b2AndW(b2GreaterEqualW(x1x, zero), b2GreaterEqualW(x1y, zero));
+			xx = b2BlendW(xx, x1x, valid);
+			xy = b2BlendW(xy, x1y, valid);
+
+			// Apply incremental impulse
+			b2FloatW dx = xx - ax;
+			b2FloatW dy = xy - ay;
+			b2Vec2W P1 = { dx * normal.x, dx * normal.y };
+			b2Vec2W P2 = { dy * normal.x, dy * normal.y };
+
+			block.vA.x = block.vA.x - mA * (P1.x + P2.x);
+			block.vA.y = block.vA.y - mA * (P1.y + P2.y);
+			block.wA = block.wA - iA * (b2CrossW(rA1, P1) + b2CrossW(rA2, P2));
+
+			block.vB.x = block.vB.x + mB * (P1.x + P2.x);
+			block.vB.y = block.vB.y + mB * (P1.y + P2.y);
+			block.wB = block.wB + iB * (b2CrossW(rB1, P1) + b2CrossW(rB2, P2));
+
+			blockImpulse1 = xx;
+			blockImpulse2 = xy;
+		}
+
+		bodies = b2BlendW(sequential, block, blockSolve);
+		b2FloatW::Store(wvc->normalImpulse1, b2BlendW(sequentialImpulse1, blockImpulse1, blockSolve));
+		b2FloatW::Store(wvc->normalImpulse2, b2BlendW(sequentialImpulse2, blockImpulse2, blockSolve));
+
+		b2ScatterVelocitiesW(velocities, wvc->indexA, bodies.vA, bodies.wA);
+		b2ScatterVelocitiesW(velocities, wvc->indexB, bodies.vB, bodies.wB);
+	}
+}
+
+static void b2StoreImpulsesW(const void* velocityBatches, const int32* lanes, int32 batchCount,
+							 b2ContactVelocityConstraint* velocityConstraints)
+{
+	const b2WideVelocityConstraint* wvcs = (const b2WideVelocityConstraint*)velocityBatches;
+
+	for (int32 i = 0; i < batchCount; ++i)
+	{
+		const b2WideVelocityConstraint* wvc = wvcs + i;
+
+		for (int32 j = 0; j < b2FloatW::width; ++j)
+		{
+			int32 index = lanes[i * b2FloatW::width + j];
+			if (index < 0)
+			{
+				continue;
+			}
+
+			b2ContactVelocityConstraint* vc = velocityConstraints + index;
+			vc->points[0].normalImpulse = wvc->normalImpulse1[j];
+			vc->points[0].tangentImpulse = wvc->tangentImpulse1[j];
+
+			if (vc->pointCount == 2)
+			{
+				vc->points[1].normalImpulse = wvc->normalImpulse2[j];
+				vc->points[1].tangentImpulse = wvc->tangentImpulse2[j];
+			}
+		}
+	}
+}
+
+struct b2TransformW
+{
+	b2FloatW s, c;
+	b2Vec2W p;
+};
+
+// b2Mul(xf, v)
+static inline b2Vec2W b2MulW(const b2TransformW& xf, const b2Vec2W& v)
+{
+	b2Vec2W r;
+	r.x = (xf.c * v.x - xf.s * v.y) + xf.p.x;
+	r.y = (xf.s * v.x + xf.c * v.y) + xf.p.y;
+	return r;
+}
+
+static inline b2TransformW b2BlendW(const b2TransformW& a, const b2TransformW& b, b2FloatW mask)
+{
+	b2TransformW r;
+	r.s = b2BlendW(a.s, b.s, mask);
+	r.c = b2BlendW(a.c, b.c, mask);
+	r.p.x = b2BlendW(a.p.x, b.p.x, mask);
+	r.p.y = b2BlendW(a.p.y, b.p.y, mask);
+	return r;
+}
+
+static inline b2TransformW b2BodyTransformW(const b2Vec2W& center, b2FloatW angle, const b2Vec2W& localCenter)
+{
+	b2TransformW xf;
+	b2SinCosW(&xf.s, &xf.c, angle);
+	xf.p.x = center.x - (xf.c * localCenter.x - xf.s * localCenter.y);
+	xf.p.y = center.y - (xf.s * localCenter.x + xf.c * localCenter.y);
+	return xf;
+}
+
+static float b2SolvePositionW(const void* positionBatches, int32 batchCount, b2Position* positions)
+{
+	const b2WidePositionConstraint* wpcs = (const b2WidePositionConstraint*)positionBatches;
+	const b2FloatW zero = b2FloatW::Zero();
+	const b2FloatW half = b2FloatW::Splat(0.5f);
+	const b2FloatW epsilon = b2FloatW::Splat(b2_epsilon);
+	const b2FloatW baumgarte = b2FloatW::Splat(b2_baumgarte);
+	const b2FloatW linearSlop = b2FloatW::Splat(b2_linearSlop);
+	const b2FloatW maxCorrection = b2FloatW::Splat(b2_maxLinearCorrection);
+
+	b2FloatW minSeparation = zero;
+
+	for (int32 i = 0; i < batchCount; ++i)
+	{
+		const b2WidePositionConstraint* wpc = wpcs + i;
+
+		b2Vec2W cA, cB;
+		b2FloatW aA, aB;
+		b2GatherPositionsW(&cA, &aA, wpc->indexA, positions);
+		b2GatherPositionsW(&cB, &aB, wpc->indexB, positions);
+
+		b2FloatW mA = b2FloatW::Load(wpc->invMassA);
+		b2FloatW iA = b2FloatW::Load(wpc->invIA);
+		b2FloatW mB = b2FloatW::Load(wpc->invMassB);
+		b2FloatW iB = b2FloatW::Load(wpc->invIB);
+		b2Vec2W localCenterA = { b2FloatW::Load(wpc->localCenterAX), b2FloatW::Load(wpc->localCenterAY) };
+		b2Vec2W localCenterB = { b2FloatW::Load(wpc->localCenterBX), b2FloatW::Load(wpc->localCenterBY) };
+		b2Vec2W localNormal = { b2FloatW::Load(wpc->localNormalX), b2FloatW::Load(wpc->localNormalY) };
+		b2Vec2W localPoint = { b2FloatW::Load(wpc->localPointX), b2FloatW::Load(wpc->localPointY) };
+		b2FloatW radiusA = b2FloatW::Load(wpc->radiusA);
+		b2FloatW radiusB = b2FloatW::Load(wpc->radiusB);
+		b2FloatW isCircles = b2LoadMaskW(wpc->isCircles);
+		b2FloatW isFaceB = b2LoadMaskW(wpc->isFaceB);
+
+		// Solve normal constraints
+		for (int32 j = 0; j < 2; ++j)
+		{
+			b2Vec2W clipPoint;
+			b2FloatW hasPoint;
+			if (j == 0)
+			{
+				clipPoint.x = b2FloatW::Load(wpc->localPoint1X);
+				clipPoint.y = b2FloatW::Load(wpc->localPoint1Y);
+				hasPoint = b2LoadMaskW(wpc->hasPoint1);
+			}
+			else
+			{
+				clipPoint.x = b2FloatW::Load(wpc->localPoint2X);
+				clipPoint.y = b2FloatW::Load(wpc->localPoint2Y);
+				hasPoint = b2LoadMaskW(wpc->hasPoint2);
+			}
+
+			b2TransformW xfA = b2BodyTransformW(cA, aA, localCenterA);
+			b2TransformW xfB = b2BodyTransformW(cB, aB, localCenterB);
+
+			// See b2PositionSolverManifold. The reference body holds the plane or the
+			// first circle, it is B for e_faceB and A otherwise.
+			b2TransformW xfRef = b2BlendW(xfA, xfB, isFaceB);
+			b2TransformW xfInc = b2BlendW(xfB, xfA, isFaceB);
+
+			b2Vec2W planePoint = b2MulW(xfRef, localPoint);
+			b2Vec2W incidentPoint = b2MulW(xfInc, clipPoint);
+			b2Vec2W d = { incidentPoint.x - planePoint.x, incidentPoint.y - planePoint.y };
+
+			b2Vec2W normal;
+			normal.x = xfRef.c * localNormal.x - xfRef.s * localNormal.y;
+			normal.y = xfRef.s * localNormal.x + xfRef.c * localNormal.y;
+
+			// Circles use the normalized direction between the centers.
+			b2FloatW length = b2SqrtW(d.x * d.x + d.y * d.y);
+			b2FloatW invLength = b2FloatW::Splat(1.0f) / length;
+			b2FloatW normalize = b2AndW(isCircles, b2GreaterEqualW(length, epsilon));
+			normal.x = b2BlendW(b2BlendW(normal.x, d.x, isCircles), d.x * invLength, normalize);
+			normal.y = b2BlendW(b2BlendW(normal.y, d.y, isCircles), d.y * invLength, normalize);
+
+			b2FloatW separation = b2DotW(d, normal) - radiusA - radiusB;
+
+			b2Vec2W point;
+			point.x = b2BlendW(incidentPoint.x, half * (planePoint.x + incidentPoint.x), isCircles);
+			point.y = b2BlendW(incidentPoint.y, half * (planePoint.y + incidentPoint.y), isCircles);
+
+			// Ensure normal points from A to B
+			normal.x = b2BlendW(normal.x, -normal.x, isFaceB);
+			normal.y = b2BlendW(normal.y, -normal.y, isFaceB);
+
+			b2Vec2W rA = { point.x - cA.x, point.y - cA.y };
+			b2Vec2W rB = { point.x - cB.x, point.y - cB.y };
+
+			// Track max constraint error.
+			minSeparation = b2MinW(minSeparation, b2BlendW(zero, separation, hasPoint));
+
+			// Prevent large corrections and allow slop.
+			b2FloatW C = b2MaxW(-maxCorrection, b2MinW(baumgarte * (separation + linearSlop), zero));
+
+			// Compute the effective mass.
+			b2FloatW rnA = b2CrossW(rA, normal);
+			b2FloatW rnB = b2CrossW(rB, normal);
+			b2FloatW K = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
+
+			// Compute normal impulse
+			b2FloatW impulse = b2BlendW(zero, -C / K, b2AndW(hasPoint, b2GreaterW(K, zero)));
+
+			b2Vec2W P = { impulse * normal.x, impulse * normal.y };
+
+			cA.x = cA.x - mA * P.x;
+			cA.y = cA.y - mA * P.y;
+			aA = aA - iA * b2CrossW(rA, P);
+
+			cB.x = cB.x + mB * P.x;
+			cB.y = cB.y + mB * P.y;
+			aB = aB + iB * b2CrossW(rB, P);
+		}
+
+		b2ScatterPositionsW(positions, wpc->indexA, cA, aA);
+		b2ScatterPositionsW(positions, wpc->indexB, cB, aB);
+	}
+
+	float lanes[b2FloatW::width];
+	b2FloatW::Store(lanes, minSeparation);
+
+	float result = 0.0f;
+	for (int32 i = 0; i < b2FloatW::width; ++i)
+	{
+		result = lanes[i] < result ? lanes[i] : result;
+	}
+
+	return result;
+}
+
+static const b2WideContactSolver b2_wideContactSolver =
+{
+	b2FloatW::width,
+	sizeof(b2WideVelocityConstraint),
+	sizeof(b2WidePositionConstraint),
+	b2PrepareW,
+	b2SolveVelocityW,
+	b2StoreImpulsesW,
+	b2SolvePositionW
+};
+
+#endif
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_draw.h"
 #include "box2d/b2_distance_joint.h"
@@ -365,6 +367,22 @@ float b2DistanceJoint::GetCurrentLength() const
 	return length;
 }
 
+void b2DistanceJoint::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_stiffness);
+	snapshot->Value(m_damping);
+	snapshot->Value(m_bias);
+	snapshot->Value(m_length);
+	snapshot->Value(m_minLength);
+	snapshot->Value(m_maxLength);
+	snapshot->Value(m_localAnchorA);
+	snapshot->Value(m_localAnchorB);
+	snapshot->Value(m_gamma);
+	snapshot->Value(m_impulse);
+	snapshot->Value(m_lowerImpulse);
+	snapshot->Value(m_upperImpulse);
+}
+
 void b2DistanceJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
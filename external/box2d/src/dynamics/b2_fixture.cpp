@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_fixture.h"
 #include "box2d/b2_block_allocator.h"
 #include "box2d/b2_broad_phase.h"
@@ -31,6 +33,8 @@
 #include "box2d/b2_polygon_shape.h"
 #include "box2d/b2_world.h"
 
+#include <new>
+
 b2Fixture::b2Fixture()
 {
 	m_body = nullptr;
@@ -123,6 +127,145 @@ void b2Fixture::Destroy(b2BlockAllocator* allocator)
 	m_shape = nullptr;
 }
 
+void b2Fixture::Snapshot(b2Snapshot* snapshot, b2BlockAllocator* allocator)
+{
+	snapshot->Value(m_density);
+	snapshot->Value(m_friction);
+	snapshot->Value(m_restitution);
+	snapshot->Value(m_restitutionThreshold);
+	snapshot->Value(m_filter);
+	snapshot->Value(m_isSensor);
+	snapshot->Value(m_userData);
+
+	b2Shape::Type type = snapshot->IsLoading() ? b2Shape::e_typeCount : m_shape->m_type;
+	snapshot->Value(type);
+
+	if (snapshot->IsLoading())
+	{
+		void* mem;
+		switch (type)
+		{
+		case b2Shape::e_circle:
+			mem = allocator->Allocate(sizeof(b2CircleShape));
+			m_shape = new (mem) b2CircleShape;
+			break;
+
+		case b2Shape::e_edge:
+			mem = allocator->Allocate(sizeof(b2EdgeShape));
+			m_shape = new (mem) b2EdgeShape;
+			break;
+
+		case b2Shape::e_polygon:
+			mem = allocator->Allocate(sizeof(b2PolygonShape));
+			m_shape = new (mem) b2PolygonShape;
+			break;
+
+		case b2Shape::e_chain:
+			mem = allocator->Allocate(sizeof(b2ChainShape));
+			m_shape = new (mem) b2ChainShape;
+			break;
+
+		default:
+			// Leave the fixture without a shape, the caller has to free it.
+			snapshot->SetInvalid();
+			return;
+		}
+	}
+
+	snapshot->Value(m_shape->m_radius);
+
+	// Bad counts are clamped, so a damaged snapshot still leaves a shape that can be destroyed.
+	switch (type)
+	{
+	case b2Shape::e_circle:
+		{
+			b2CircleShape* s = (b2CircleShape*)m_shape;
+			snapshot->Value(s->m_p);
+		}
+		break;
+
+	case b2Shape::e_edge:
+		{
+			b2EdgeShape* s = (b2EdgeShape*)m_shape;
+			snapshot->Value(s->m_vertex0);
+			snapshot->Value(s->m_vertex1);
+			snapshot->Value(s->m_vertex2);
+			snapshot->Value(s->m_vertex3);
+			snapshot->Value(s->m_oneSided);
+		}
+		break;
+
+	case b2Shape::e_polygon:
+		{
+			b2PolygonShape* s = (b2PolygonShape*)m_shape;
+			snapshot->Value(s->m_centroid);
+			snapshot->Value(s->m_count);
+			if (s->m_count < 3 || s->m_count > b2_maxPolygonVertices)
+			{
+				s->m_count = 3;
+				snapshot->SetInvalid();
+			}
+
+			snapshot->Bytes(s->m_vertices, s->m_count * sizeof(b2Vec2));
+			snapshot->Bytes(s->m_normals, s->m_count * sizeof(b2Vec2));
+		}
+		break;
+
+	case b2Shape::e_chain:
+		{
+			b2ChainShape* s = (b2ChainShape*)m_shape;
+			snapshot->Count(s->m_count, sizeof(b2Vec2));
+			if (snapshot->IsLoading())
+			{
+				if (s->m_count < 2)
+				{
+					s->m_count = 2;
+					snapshot->SetInvalid();
+				}
+
+				s->m_vertices = (b2Vec2*)b2Alloc(s->m_count * sizeof(b2Vec2));
+			}
+
+			snapshot->Bytes(s->m_vertices, s->m_count * sizeof(b2Vec2));
+			snapshot->Value(s->m_prevVertex);
+			snapshot->Value(s->m_nextVertex);
+		}
+		break;
+
+	default:
+		b2Assert(false);
+		break;
+	}
+
+	int32 childCount = m_shape->GetChildCount();
+	if (snapshot->IsLoading())
+	{
+		m_proxies = (b2FixtureProxy*)allocator->Allocate(childCount * sizeof(b2FixtureProxy));
+		for (int32 i = 0; i < childCount; ++i)
+		{
+			m_proxies[i].fixture = nullptr;
+			m_proxies[i].proxyId = b2BroadPhase::e_nullProxy;
+		}
+	}
+
+	// The proxy ids refer to the broad-phase tree, which is saved as a whole.
+	snapshot->Value(m_proxyCount);
+	if (m_proxyCount != 0 && m_proxyCount != childCount)
+	{
+		m_proxyCount = 0;
+		snapshot->SetInvalid();
+	}
+
+	for (int32 i = 0; i < m_proxyCount; ++i)
+	{
+		b2FixtureProxy* proxy = m_proxies + i;
+		snapshot->Value(proxy->aabb);
+		snapshot->Value(proxy->proxyId);
+		proxy->fixture = this;
+		proxy->childIndex = i;
+	}
+}
+
 void b2Fixture::CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf)
 {
 	b2Assert(m_proxyCount == 0);
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_friction_joint.h"
 #include "box2d/b2_body.h"
 #include "box2d/b2_time_step.h"
@@ -238,6 +240,16 @@ float b2FrictionJoint::GetMaxTorque() const
 	return m_maxTorque;
 }
 
+void b2FrictionJoint::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_localAnchorA);
+	snapshot->Value(m_localAnchorB);
+	snapshot->Value(m_linearImpulse);
+	snapshot->Value(m_angularImpulse);
+	snapshot->Value(m_maxForce);
+	snapshot->Value(m_maxTorque);
+}
+
 void b2FrictionJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_gear_joint.h"
 #include "box2d/b2_revolute_joint.h"
 #include "box2d/b2_prismatic_joint.h"
@@ -418,6 +420,22 @@ float b2GearJoint::GetRatio() const
 	return m_ratio;
 }
 
+void b2GearJoint::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_localAnchorA);
+	snapshot->Value(m_localAnchorB);
+	snapshot->Value(m_localAnchorC);
+	snapshot->Value(m_localAnchorD);
+	snapshot->Value(m_localAxisC);
+	snapshot->Value(m_localAxisD);
+	snapshot->Value(m_referenceAngleA);
+	snapshot->Value(m_referenceAngleB);
+	snapshot->Value(m_constant);
+	snapshot->Value(m_ratio);
+	snapshot->Value(m_tolerance);
+	snapshot->Value(m_impulse);
+}
+
 void b2GearJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -173,10 +173,49 @@ b2Island::b2Island(
 
 	m_velocities = (b2Velocity*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Velocity));
 	m_positions = (b2Position*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Position));
+
+	m_ownsArrays = true;
+	m_splitPending = false;
+	m_maxSleepTime = 0.0f;
+}
+
+b2Island::b2Island(
+	b2Body** bodies, int32 bodyCount,
+	b2Contact** contacts, int32 contactCount,
+	b2Joint** joints, int32 jointCount,
+	b2Position* positions,
+	b2Velocity* velocities,
+	b2StackAllocator* allocator)
+{
+	m_bodyCapacity = bodyCount;
+	m_contactCapacity = contactCount;
+	m_jointCapacity = jointCount;
+	m_bodyCount = bodyCount;
+	m_contactCount = contactCount;
+	m_jointCount = jointCount;
+
+	m_allocator = allocator;
+	m_listener = nullptr;
+
+	m_bodies = bodies;
+	m_contacts = contacts;
+	m_joints = joints;
+
+	m_velocities = velocities;
+	m_positions = positions;
+
+	m_ownsArrays = false;
+	m_splitPending = false;
+	m_maxSleepTime = 0.0f;
 }
 
 b2Island::~b2Island()
 {
+	if (m_ownsArrays == false)
+	{
+		return;
+	}
+
 	// Warning: the order should reverse the constructor order.
 	m_allocator->Free(m_positions);
 	m_allocator->Free(m_velocities);
@@ -349,6 +388,7 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	if (allowSleep)
 	{
 		float minSleepTime = b2_maxFloat;
+		float maxSleepTime = 0.0f;
 
 		const float linTolSqr = b2_linearSleepTolerance * b2_linearSleepTolerance;
 		const float angTolSqr = b2_angularSleepTolerance * b2_angularSleepTolerance;
@@ -372,10 +412,13 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 			{
 				b->m_sleepTime += h;
 				minSleepTime = b2Min(minSleepTime, b->m_sleepTime);
+				maxSleepTime = b2Max(maxSleepTime, b->m_sleepTime);
 			}
 		}
 
-		if (minSleepTime >= b2_timeToSleep && positionSolved)
+		m_maxSleepTime = maxSleepTime;
+
+		if (minSleepTime >= b2_timeToSleep && positionSolved && m_splitPending == false)
 		{
 			for (int32 i = 0; i < m_bodyCount; ++i)
 			{
@@ -34,12 +34,42 @@ class b2ContactListener;
 struct b2ContactVelocityConstraint;
 struct b2Profile;
 
+#define b2_nullIsland (-1)
+
+/// This is an internal structure. A set of bodies connected by touching contacts and joints
+/// that is kept from step to step. A new contact or joint merges the islands of its bodies
+/// right away. Removals are only counted, the island is searched for its parts when one of
+/// its bodies wants to sleep. Static bodies are not part of any island.
+struct b2PersistentIsland
+{
+	// Doubly linked through b2Body::m_islandPrev and b2Body::m_islandNext.
+	b2Body* bodyList;
+	int32 bodyCount;
+
+	// Contacts, joints and bodies removed since the island was built. It may have come apart.
+	int32 constraintRemoveCount;
+
+	// Index in b2World::m_awakeIslands, b2_nullIsland while the island sleeps.
+	int32 awakeIndex;
+
+	// The next free island while this one is unused.
+	int32 next;
+};
+
 /// This is an internal class.
 class b2Island
 {
 public:
 	b2Island(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity,
 			b2StackAllocator* allocator, b2ContactListener* listener);
+
+	/// Use arrays owned by the caller instead of allocating them. The bodies must have their
+	/// island index set. The positions and velocities also hold the static bodies the
+	/// constraints refer to, these are not part of the body array. Nothing is reported.
+	b2Island(b2Body** bodies, int32 bodyCount, b2Contact** contacts, int32 contactCount,
+			b2Joint** joints, int32 jointCount, b2Position* positions, b2Velocity* velocities,
+			b2StackAllocator* allocator);
+
 	~b2Island();
 
 	void Clear()
@@ -92,6 +122,15 @@ public:
 	int32 m_bodyCapacity;
 	int32 m_contactCapacity;
 	int32 m_jointCapacity;
+
+	bool m_ownsArrays;
+
+	// Set by the caller when the island may have come apart. It is kept awake then, so the
+	// parts can be split off and sleep on their own.
+	bool m_splitPending;
+
+	// The longest sleep time of a body after Solve.
+	float m_maxSleepTime;
 };
 
 #endif
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_motor_joint.h"
 #include "box2d/b2_time_step.h"
@@ -293,6 +295,17 @@ float b2MotorJoint::GetAngularOffset() const
 	return m_angularOffset;
 }
 
+void b2MotorJoint::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_linearOffset);
+	snapshot->Value(m_angularOffset);
+	snapshot->Value(m_linearImpulse);
+	snapshot->Value(m_angularImpulse);
+	snapshot->Value(m_maxForce);
+	snapshot->Value(m_maxTorque);
+	snapshot->Value(m_correctionFactor);
+}
+
 void b2MotorJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_mouse_joint.h"
 #include "box2d/b2_time_step.h"
@@ -188,3 +190,15 @@ void b2MouseJoint::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	m_targetA -= newOrigin;
 }
+
+void b2MouseJoint::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_localAnchorB);
+	snapshot->Value(m_targetA);
+	snapshot->Value(m_stiffness);
+	snapshot->Value(m_damping);
+	snapshot->Value(m_beta);
+	snapshot->Value(m_impulse);
+	snapshot->Value(m_maxForce);
+	snapshot->Value(m_gamma);
+}
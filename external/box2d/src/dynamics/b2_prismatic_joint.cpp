@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_draw.h"
 #include "box2d/b2_prismatic_joint.h"
@@ -583,6 +585,25 @@ float b2PrismaticJoint::GetMotorForce(float inv_dt) const
 	return inv_dt * m_motorImpulse;
 }
 
+void b2PrismaticJoint::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_localAnchorA);
+	snapshot->Value(m_localAnchorB);
+	snapshot->Value(m_localXAxisA);
+	snapshot->Value(m_localYAxisA);
+	snapshot->Value(m_referenceAngle);
+	snapshot->Value(m_impulse);
+	snapshot->Value(m_motorImpulse);
+	snapshot->Value(m_lowerImpulse);
+	snapshot->Value(m_upperImpulse);
+	snapshot->Value(m_lowerTranslation);
+	snapshot->Value(m_upperTranslation);
+	snapshot->Value(m_maxMotorForce);
+	snapshot->Value(m_motorSpeed);
+	snapshot->Value(m_enableLimit);
+	snapshot->Value(m_enableMotor);
+}
+
 void b2PrismaticJoint::Dump()
 {
 	// FLT_DECIMAL_DIG == 9
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_pulley_joint.h"
 #include "box2d/b2_time_step.h"
@@ -326,6 +328,19 @@ float b2PulleyJoint::GetCurrentLengthB() const
 	return d.Length();
 }
 
+void b2PulleyJoint::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_groundAnchorA);
+	snapshot->Value(m_groundAnchorB);
+	snapshot->Value(m_lengthA);
+	snapshot->Value(m_lengthB);
+	snapshot->Value(m_localAnchorA);
+	snapshot->Value(m_localAnchorB);
+	snapshot->Value(m_constant);
+	snapshot->Value(m_ratio);
+	snapshot->Value(m_impulse);
+}
+
 void b2PulleyJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_draw.h"
 #include "box2d/b2_revolute_joint.h"
@@ -437,6 +439,23 @@ void b2RevoluteJoint::SetLimits(float lower, float upper)
 	}
 }
 
+void b2RevoluteJoint::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_localAnchorA);
+	snapshot->Value(m_localAnchorB);
+	snapshot->Value(m_impulse);
+	snapshot->Value(m_motorImpulse);
+	snapshot->Value(m_lowerImpulse);
+	snapshot->Value(m_upperImpulse);
+	snapshot->Value(m_enableMotor);
+	snapshot->Value(m_maxMotorTorque);
+	snapshot->Value(m_motorSpeed);
+	snapshot->Value(m_enableLimit);
+	snapshot->Value(m_referenceAngle);
+	snapshot->Value(m_lowerAngle);
+	snapshot->Value(m_upperAngle);
+}
+
 void b2RevoluteJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_time_step.h"
 #include "box2d/b2_weld_joint.h"
@@ -326,6 +328,18 @@ float b2WeldJoint::GetReactionTorque(float inv_dt) const
 	return inv_dt * m_impulse.z;
 }
 
+void b2WeldJoint::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_stiffness);
+	snapshot->Value(m_damping);
+	snapshot->Value(m_bias);
+	snapshot->Value(m_localAnchorA);
+	snapshot->Value(m_localAnchorB);
+	snapshot->Value(m_referenceAngle);
+	snapshot->Value(m_gamma);
+	snapshot->Value(m_impulse);
+}
+
 void b2WeldJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
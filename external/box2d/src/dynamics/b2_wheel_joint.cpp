@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "common/b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_draw.h"
 #include "box2d/b2_wheel_joint.h"
@@ -68,6 +70,7 @@ b2WheelJoint::b2WheelJoint(const b2WheelJointDef* def)
 	m_axialMass = 0.0f;
 	m_lowerImpulse = 0.0f;
 	m_upperImpulse = 0.0f;
+	m_translation = 0.0f;
 	m_lowerTranslation = def->lowerTranslation;
 	m_upperTranslation = def->upperTranslation;
 	m_enableLimit = def->enableLimit;
@@ -613,6 +616,28 @@ float b2WheelJoint::GetDamping() const
 	return m_damping;
 }
 
+void b2WheelJoint::Snapshot(b2Snapshot* snapshot)
+{
+	snapshot->Value(m_localAnchorA);
+	snapshot->Value(m_localAnchorB);
+	snapshot->Value(m_localXAxisA);
+	snapshot->Value(m_localYAxisA);
+	snapshot->Value(m_impulse);
+	snapshot->Value(m_motorImpulse);
+	snapshot->Value(m_springImpulse);
+	snapshot->Value(m_lowerImpulse);
+	snapshot->Value(m_upperImpulse);
+	snapshot->Value(m_translation);
+	snapshot->Value(m_lowerTranslation);
+	snapshot->Value(m_upperTranslation);
+	snapshot->Value(m_maxMotorTorque);
+	snapshot->Value(m_motorSpeed);
+	snapshot->Value(m_enableLimit);
+	snapshot->Value(m_enableMotor);
+	snapshot->Value(m_stiffness);
+	snapshot->Value(m_damping);
+}
+
 void b2WheelJoint::Dump()
 {
 	// FLT_DECIMAL_DIG == 9
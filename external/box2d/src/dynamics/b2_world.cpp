@@ -21,7 +21,9 @@
 // SOFTWARE.
 
 #include "b2_contact_solver.h"
+#include "b2_contact_solver_wide.h"
 #include "b2_island.h"
+#include "common/b2_thread_pool.h"
 
 #include "box2d/b2_body.h"
 #include "box2d/b2_broad_phase.h"
@@ -32,20 +34,26 @@
 #include "box2d/b2_draw.h"
 #include "box2d/b2_edge_shape.h"
 #include "box2d/b2_fixture.h"
+#include "box2d/b2_growable_stack.h"
 #include "box2d/b2_polygon_shape.h"
 #include "box2d/b2_pulley_joint.h"
 #include "box2d/b2_time_of_impact.h"
 #include "box2d/b2_timer.h"
+#include "box2d/b2_trace.h"
 #include "box2d/b2_world.h"
 
 #include <new>
+#include <stdlib.h>
 
-b2World::b2World(const b2Vec2& gravity)
+b2World::b2World(const b2Vec2& gravity, b2Allocator* allocator)
+	: m_blockAllocator(allocator), m_stackAllocator(allocator), m_contactManager(allocator)
 {
 	m_destructionListener = nullptr;
 	m_debugDraw = nullptr;
 
 	m_bodyList = nullptr;
+	m_bodyCreationCount = 0;
+	m_drawStamp = 0;
 	m_jointList = nullptr;
 
 	m_bodyCount = 0;
@@ -54,8 +62,18 @@ b2World::b2World(const b2Vec2& gravity)
 	m_warmStarting = true;
 	m_continuousPhysics = true;
 	m_subStepping = false;
+	m_batchTOI = true;
 
 	m_stepComplete = true;
+	m_islandCount = 0;
+
+	m_allocator = allocator;
+
+	m_islands = nullptr;
+	m_islandCapacity = 0;
+	m_freeIsland = b2_nullIsland;
+	m_awakeIslands = nullptr;
+	m_awakeIslandCount = 0;
 
 	m_allowSleep = true;
 	m_gravity = gravity;
@@ -67,6 +85,17 @@ b2World::b2World(const b2Vec2& gravity)
 	m_inv_dt0 = 0.0f;
 
 	m_contactManager.m_allocator = &m_blockAllocator;
+	m_contactManager.m_stackAllocator = &m_stackAllocator;
+
+	m_threadPool = nullptr;
+	m_toiBatch = nullptr;
+	m_contactSolverWidth = 1;
+
+	for (int32 i = 0; i < e_solveBufferCount; ++i)
+	{
+		m_solveBuffers[i].data = nullptr;
+		m_solveBuffers[i].capacity = 0;
+	}
 
 	memset(&m_profile, 0, sizeof(b2Profile));
 }
@@ -90,6 +119,115 @@ b2World::~b2World()
 
 		b = bNext;
 	}
+
+	ClearIslands();
+	FreeSolveBuffers();
+	SetThreadCount(1);
+}
+
+void b2World::SetThreadCount(int32 count)
+{
+	b2Assert(IsLocked() == false);
+	b2Assert(count >= 1);
+
+	if (count == GetThreadCount())
+	{
+		return;
+	}
+
+	if (m_threadPool)
+	{
+		m_threadPool->~b2ThreadPool();
+		b2Free(m_threadPool);
+		m_threadPool = nullptr;
+	}
+
+	if (count > 1)
+	{
+		void* mem = b2Alloc(sizeof(b2ThreadPool));
+		m_threadPool = new (mem) b2ThreadPool(count, m_allocator, m_stackAllocator.GetSize());
+	}
+
+	m_contactManager.m_threadPool = m_threadPool;
+	m_contactManager.m_broadPhase.SetThreadPool(m_threadPool);
+}
+
+int32 b2World::GetThreadCount() const
+{
+	return m_threadPool ? m_threadPool->GetThreadCount() : 1;
+}
+
+void b2World::SetStackSize(int32 size)
+{
+	b2Assert(IsLocked() == false);
+	b2Assert(size >= 0);
+
+	m_stackAllocator.SetSize(size);
+	if (m_threadPool)
+	{
+		m_threadPool->SetStackSize(size);
+	}
+}
+
+int32 b2World::GetStackSize() const
+{
+	return m_stackAllocator.GetSize();
+}
+
+b2AllocatorStats b2World::GetAllocatorStats() const
+{
+	b2AllocatorStats stats;
+	stats.chunkCount = m_blockAllocator.GetChunkCount();
+	stats.chunkBytes = m_blockAllocator.GetChunkBytes();
+	stats.blockBytes = m_blockAllocator.GetBlockBytes();
+	stats.peakBlockBytes = m_blockAllocator.GetMaxBlockBytes();
+	stats.fragmentation = 0.0f;
+	if (stats.chunkBytes > 0)
+	{
+		stats.fragmentation = float(stats.chunkBytes - stats.blockBytes) / float(stats.chunkBytes);
+	}
+	stats.largeCount = m_blockAllocator.GetLargeCount();
+	stats.largeBytes = m_blockAllocator.GetLargeBytes();
+
+	stats.stackSize = m_stackAllocator.GetSize();
+	stats.peakStackBytes = m_stackAllocator.GetMaxAllocation();
+	stats.stackOverflowCount = m_stackAllocator.GetOverflowCount();
+
+	if (m_threadPool)
+	{
+		for (int32 i = 0; i < m_threadPool->GetThreadCount(); ++i)
+		{
+			const b2StackAllocator* allocator = m_threadPool->GetStackAllocator(i);
+			stats.peakStackBytes = b2Max(stats.peakStackBytes, allocator->GetMaxAllocation());
+			stats.stackOverflowCount += allocator->GetOverflowCount();
+		}
+	}
+
+	stats.bufferBytes = m_islandCapacity * (sizeof(b2PersistentIsland) + sizeof(int32));
+	for (int32 i = 0; i < e_solveBufferCount; ++i)
+	{
+		stats.bufferBytes += m_solveBuffers[i].capacity;
+	}
+	stats.bufferBytes += m_contactManager.GetBufferBytes();
+
+	return stats;
+}
+
+void b2World::SetContactSolverWidth(int32 width)
+{
+	int32 maxWidth = b2GetMaxContactSolverWidth();
+	if (width <= 0 || width >= maxWidth)
+	{
+		m_contactSolverWidth = maxWidth;
+	}
+	else if (width >= 4 && b2GetWideContactSolver(4))
+	{
+		m_contactSolverWidth = 4;
+	}
+	else
+	{
+		m_contactSolverWidth = 1;
+	}
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -133,6 +271,8 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	m_bodyList = b;
 	++m_bodyCount;
 
+	AddToIsland(b);
+
 	return b;
 }
 
@@ -196,6 +336,8 @@ void b2World::DestroyBody(b2Body* b)
 	b->m_fixtureList = nullptr;
 	b->m_fixtureCount = 0;
 
+	RemoveFromIsland(b);
+
 	// Remove world body list.
 	if (b->m_prev)
 	{
@@ -272,6 +414,10 @@ b2Joint* b2World::CreateJoint(const b2JointDef* def)
 		}
 	}
 
+	// The bodies are solved together from now on. The next step wakes the sleeping one
+	// if the other is awake.
+	LinkBodies(bodyA, bodyB);
+
 	// Note: creating a joint doesn't wake the bodies.
 
 	return j;
@@ -307,6 +453,8 @@ void b2World::DestroyJoint(b2Joint* j)
 	b2Body* bodyA = j->m_bodyA;
 	b2Body* bodyB = j->m_bodyB;
 
+	UnlinkBodies(bodyA, bodyB);
+
 	// Wake up connected bodies.
 	bodyA->SetAwake(true);
 	bodyB->SetAwake(true);
@@ -390,198 +538,1044 @@ void b2World::SetAllowSleeping(bool flag)
 	}
 }
 
-// Find islands, integrate and solve constraints, solve position constraints
+// The arrays persistent islands are gathered into by Solve and SolveParallel. Gathering
+// appends to them.
+struct b2IslandGather
+{
+	b2Body** bodies;
+	b2Contact** contacts;
+	b2Joint** joints;
+	b2Body** staticBodies;
+
+	// Depth first search stack.
+	b2Body** stack;
+
+	int32 bodyCount;
+	int32 contactCount;
+	int32 jointCount;
+	int32 staticCount;
+};
+
+// A search start of GatherIsland.
+struct b2IslandSeed
+{
+	b2Body* body;
+	uint32 creationIndex;
+};
+
+static int b2CompareIslandSeeds(const void* a, const void* b)
+{
+	uint32 indexA = ((const b2IslandSeed*)a)->creationIndex;
+	uint32 indexB = ((const b2IslandSeed*)b)->creationIndex;
+	return indexA < indexB ? -1 : (indexA > indexB ? 1 : 0);
+}
+
+// Gather the bodies, contacts and joints connected to the seed in depth first order.
+void b2World::SearchIsland(b2Body* seed, b2IslandGather* gather)
+{
+	b2Body** stack = gather->stack;
+	int32 stackCount = 0;
+	stack[stackCount++] = seed;
+	seed->m_flags |= b2Body::e_islandFlag;
+
+	while (stackCount > 0)
+	{
+		b2Body* b = stack[--stackCount];
+		gather->bodies[gather->bodyCount++] = b;
+
+		// Make sure the body is awake (without resetting sleep timer).
+		b->m_flags |= b2Body::e_awakeFlag;
+
+		// Search all contacts connected to this body.
+		for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+		{
+			b2Contact* contact = ce->contact;
+
+			// Has this contact already been added to the island?
+			if (contact->m_flags & b2Contact::e_islandFlag)
+			{
+				continue;
+			}
+
+			// Is this contact solid, touching and enabled?
+			if ((contact->m_flags & b2Contact::e_linkedFlag) == 0 ||
+				contact->IsEnabled() == false)
+			{
+				continue;
+			}
+
+			gather->contacts[gather->contactCount++] = contact;
+			contact->m_flags |= b2Contact::e_islandFlag;
+
+			b2Body* other = ce->other;
+			if (other->m_flags & b2Body::e_islandFlag)
+			{
+				continue;
+			}
+
+			// Static bodies are not part of an island, each island they touch adds them.
+			other->m_flags |= b2Body::e_islandFlag;
+			if (other->GetType() == b2_staticBody)
+			{
+				gather->staticBodies[gather->staticCount++] = other;
+			}
+			else
+			{
+				stack[stackCount++] = other;
+			}
+		}
+
+		// Search all joints connected to this body.
+		for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+		{
+			if (je->joint->m_islandFlag == true)
+			{
+				continue;
+			}
+
+			b2Body* other = je->other;
+
+			// Don't simulate joints connected to disabled bodies.
+			if (other->IsEnabled() == false)
+			{
+				continue;
+			}
+
+			gather->joints[gather->jointCount++] = je->joint;
+			je->joint->m_islandFlag = true;
+
+			if (other->m_flags & b2Body::e_islandFlag)
+			{
+				continue;
+			}
+
+			other->m_flags |= b2Body::e_islandFlag;
+			if (other->GetType() == b2_staticBody)
+			{
+				gather->staticBodies[gather->staticCount++] = other;
+			}
+			else
+			{
+				stack[stackCount++] = other;
+			}
+		}
+	}
+}
+
+// Gather a persistent island for the solver, false if the user put all its bodies to sleep.
+// The order of the island's body list comes from the merges that built it, so the search
+// starts from the oldest body instead. While a split is pending the island may be in
+// several parts, the parts not reached are searched from their oldest bodies as well.
+bool b2World::GatherIsland(int32 islandId, b2IslandGather* gather)
+{
+	b2PersistentIsland* persistentIsland = m_islands + islandId;
+
+	bool awake = false;
+	b2Body* seed = nullptr;
+	for (b2Body* b = persistentIsland->bodyList; b; b = b->m_islandNext)
+	{
+		b2Assert(b->IsEnabled() == true);
+		b2Assert(b->GetType() != b2_staticBody);
+		awake = awake || b->IsAwake();
+
+		if (seed == nullptr || b->m_creationIndex < seed->m_creationIndex)
+		{
+			seed = b;
+		}
+	}
+
+	if (awake == false)
+	{
+		return false;
+	}
+
+	int32 bodyStart = gather->bodyCount;
+	SearchIsland(seed, gather);
+
+	int32 remainingCount = persistentIsland->bodyCount - (gather->bodyCount - bodyStart);
+	if (remainingCount > 0)
+	{
+		b2IslandSeed* seeds = (b2IslandSeed*)m_stackAllocator.Allocate(remainingCount * sizeof(b2IslandSeed));
+		int32 seedCount = 0;
+
+		for (b2Body* b = persistentIsland->bodyList; b; b = b->m_islandNext)
+		{
+			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			{
+				seeds[seedCount].body = b;
+				seeds[seedCount].creationIndex = b->m_creationIndex;
+				++seedCount;
+			}
+		}
+
+		b2Assert(seedCount == remainingCount);
+		qsort(seeds, seedCount, sizeof(b2IslandSeed), b2CompareIslandSeeds);
+
+		for (int32 i = 0; i < seedCount; ++i)
+		{
+			if ((seeds[i].body->m_flags & b2Body::e_islandFlag) == 0)
+			{
+				SearchIsland(seeds[i].body, gather);
+			}
+		}
+
+		m_stackAllocator.Free(seeds);
+	}
+
+	return true;
+}
+
+void* b2World::ReserveSolveBuffer(int32 type, int32 size)
+{
+	b2SolveBuffer* buffer = m_solveBuffers + type;
+	if (size > buffer->capacity)
+	{
+		if (buffer->data)
+		{
+			b2Deallocate(m_allocator, buffer->data, buffer->capacity);
+		}
+
+		buffer->capacity = size + (size >> 1);
+		buffer->data = b2Allocate(m_allocator, buffer->capacity);
+	}
+
+	return buffer->data;
+}
+
+void b2World::FreeSolveBuffers()
+{
+	for (int32 i = 0; i < e_solveBufferCount; ++i)
+	{
+		b2SolveBuffer* buffer = m_solveBuffers + i;
+		if (buffer->data)
+		{
+			b2Deallocate(m_allocator, buffer->data, buffer->capacity);
+			buffer->data = nullptr;
+			buffer->capacity = 0;
+		}
+	}
+}
+
+// Integrate and solve constraints of the awake islands, solve position constraints
 void b2World::Solve(const b2TimeStep& step)
 {
 	m_profile.solveInit = 0.0f;
 	m_profile.solveVelocity = 0.0f;
 	m_profile.solvePosition = 0.0f;
 
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount,
-					m_contactManager.m_contactCount,
-					m_jointCount,
-					&m_stackAllocator,
-					m_contactManager.m_contactListener);
-
-	// Clear all the island flags.
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	if (m_threadPool)
 	{
-		b->m_flags &= ~b2Body::e_islandFlag;
+		SolveParallel(step);
+		return;
 	}
-	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+
+	// The bodies that moved, their fixtures are synchronized after all islands are solved.
+	b2Body** movedBodies = (b2Body**)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2Body*));
+	int32 movedCount = 0;
+
+	int32 islandCount = 0;
+	int32 splitIslandId = b2_nullIsland;
+	float splitSleepTime = 0.0f;
+
 	{
-		c->m_flags &= ~b2Contact::e_islandFlag;
+		// Size the island for the worst case.
+		b2Island island(m_bodyCount,
+						m_contactManager.m_contactCount,
+						m_jointCount,
+						&m_stackAllocator,
+						m_contactManager.m_contactListener);
+
+		// The island's own arrays take the gather, the static bodies are appended afterwards.
+		b2IslandGather gather;
+		gather.bodies = island.m_bodies;
+		gather.contacts = island.m_contacts;
+		gather.joints = island.m_joints;
+		gather.staticBodies = (b2Body**)ReserveSolveBuffer(e_islandStaticBuffer, m_bodyCount * sizeof(b2Body*));
+		gather.stack = (b2Body**)ReserveSolveBuffer(e_islandStackBuffer, m_bodyCount * sizeof(b2Body*));
+
+		// Islands that sleep are removed by swapping in the last island, which was solved
+		// already. An island woken by a listener is solved by the next step.
+		for (int32 i = m_awakeIslandCount - 1; i >= 0; --i)
+		{
+			int32 islandId = m_awakeIslands[i];
+			b2PersistentIsland* persistentIsland = m_islands + islandId;
+
+			gather.bodyCount = 0;
+			gather.contactCount = 0;
+			gather.jointCount = 0;
+			gather.staticCount = 0;
+
+			// The user put all bodies to sleep.
+			if (GatherIsland(islandId, &gather) == false)
+			{
+				SleepIsland(islandId);
+				continue;
+			}
+
+			island.m_bodyCount = gather.bodyCount;
+			island.m_contactCount = gather.contactCount;
+			island.m_jointCount = gather.jointCount;
+			for (int32 j = 0; j < gather.bodyCount; ++j)
+			{
+				gather.bodies[j]->m_islandIndex = j;
+				movedBodies[movedCount++] = gather.bodies[j];
+			}
+			for (int32 j = 0; j < gather.staticCount; ++j)
+			{
+				island.Add(gather.staticBodies[j]);
+			}
+
+			island.m_splitPending = persistentIsland->constraintRemoveCount > 0;
+
+			b2Profile profile;
+			{
+				B2_TRACE_SCOPE("Island");
+				island.Solve(&profile, step, m_gravity, m_allowSleep);
+			}
+			m_profile.solveInit += profile.solveInit;
+			m_profile.solveVelocity += profile.solveVelocity;
+			m_profile.solvePosition += profile.solvePosition;
+			++islandCount;
+
+			// Post solve cleanup.
+			for (int32 j = 0; j < island.m_contactCount; ++j)
+			{
+				island.m_contacts[j]->m_flags &= ~b2Contact::e_islandFlag;
+			}
+			for (int32 j = 0; j < island.m_jointCount; ++j)
+			{
+				island.m_joints[j]->m_islandFlag = false;
+			}
+			for (int32 j = 0; j < island.m_bodyCount; ++j)
+			{
+				island.m_bodies[j]->m_flags &= ~b2Body::e_islandFlag;
+			}
+
+			// The island either sleeps as a whole or not at all.
+			if (island.m_bodies[0]->IsAwake() == false)
+			{
+				SleepIsland(islandId);
+			}
+			else if (island.m_splitPending && island.m_maxSleepTime > splitSleepTime)
+			{
+				splitIslandId = islandId;
+				splitSleepTime = island.m_maxSleepTime;
+			}
+		}
+
 	}
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+
+	m_islandCount = islandCount;
+	B2_TRACE_COUNTER("Islands", islandCount);
+
+	SynchronizeFixtures(movedBodies, movedCount);
+	m_stackAllocator.Free(movedBodies);
+
+	SplitCandidateIsland(splitIslandId);
+}
+
+// An island found by SolveParallel. The ranges index arrays shared by all islands.
+struct b2IslandRange
+{
+	int32 islandId;
+	int32 bodyStart;
+	int32 bodyCount;
+	int32 contactStart;
+	int32 contactCount;
+	int32 jointStart;
+	int32 jointCount;
+	bool splitPending;
+	float maxSleepTime;
+};
+
+struct b2SolveIslandsContext
+{
+	b2TimeStep step;
+	b2Vec2 gravity;
+	bool allowSleep;
+
+	b2ThreadPool* threadPool;
+	b2IslandRange* islands;
+	b2Body** bodies;
+	b2Contact** contacts;
+	b2Joint** joints;
+
+	// Per worker
+	b2Position** positions;
+	b2Velocity** velocities;
+	b2Profile* profiles;
+};
+
+static void b2SolveIslands(int32 begin, int32 end, int32 workerIndex, void* context)
+{
+	b2SolveIslandsContext* ctx = (b2SolveIslandsContext*)context;
+	b2StackAllocator* allocator = ctx->threadPool->GetStackAllocator(workerIndex);
+	b2Profile* workerProfile = ctx->profiles + workerIndex;
+
+	for (int32 i = begin; i < end; ++i)
 	{
-		j->m_islandFlag = false;
+		b2IslandRange* range = ctx->islands + i;
+
+		b2Island island(ctx->bodies + range->bodyStart, range->bodyCount,
+						ctx->contacts + range->contactStart, range->contactCount,
+						ctx->joints + range->jointStart, range->jointCount,
+						ctx->positions[workerIndex], ctx->velocities[workerIndex],
+						allocator);
+		island.m_splitPending = range->splitPending;
+
+		B2_TRACE_SCOPE("Island");
+
+		b2Profile profile;
+		island.Solve(&profile, ctx->step, ctx->gravity, ctx->allowSleep);
+		workerProfile->solveInit += profile.solveInit;
+		workerProfile->solveVelocity += profile.solveVelocity;
+		workerProfile->solvePosition += profile.solvePosition;
+		range->maxSleepTime = island.m_maxSleepTime;
 	}
+}
 
-	// Build and simulate all awake islands.
-	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
-	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+// Gather the awake islands first, then solve them on the thread pool. The islands are
+// gathered like in Solve, so each island is solved exactly as it would be serially. The
+// bodies of an island get the solver slots from zero up and the static bodies get the
+// slots after the largest island. Static bodies are shared by islands, so each worker
+// solves into its own slot arrays.
+void b2World::SolveParallel(const b2TimeStep& step)
+{
+	b2IslandGather gather;
+	gather.bodies = (b2Body**)ReserveSolveBuffer(e_islandBodyBuffer, m_bodyCount * sizeof(b2Body*));
+	gather.contacts = (b2Contact**)ReserveSolveBuffer(e_islandContactBuffer, m_contactManager.m_contactCount * sizeof(b2Contact*));
+	gather.joints = (b2Joint**)ReserveSolveBuffer(e_islandJointBuffer, m_jointCount * sizeof(b2Joint*));
+	gather.staticBodies = (b2Body**)ReserveSolveBuffer(e_islandStaticBuffer, m_bodyCount * sizeof(b2Body*));
+	gather.stack = (b2Body**)ReserveSolveBuffer(e_islandStackBuffer, m_bodyCount * sizeof(b2Body*));
+	b2IslandRange* islands = (b2IslandRange*)ReserveSolveBuffer(e_islandRangeBuffer, m_awakeIslandCount * sizeof(b2IslandRange));
+	gather.bodyCount = 0;
+	gather.contactCount = 0;
+	gather.jointCount = 0;
+	gather.staticCount = 0;
+
+	int32 islandCount = 0;
+	int32 maxIslandBodyCount = 0;
+
+	for (int32 i = m_awakeIslandCount - 1; i >= 0; --i)
 	{
-		if (seed->m_flags & b2Body::e_islandFlag)
+		int32 islandId = m_awakeIslands[i];
+		b2PersistentIsland* persistentIsland = m_islands + islandId;
+
+		b2IslandRange* island = islands + islandCount;
+		island->islandId = islandId;
+		island->bodyStart = gather.bodyCount;
+		island->contactStart = gather.contactCount;
+		island->jointStart = gather.jointCount;
+		int32 staticStart = gather.staticCount;
+
+		// The user put all bodies to sleep.
+		if (GatherIsland(islandId, &gather) == false)
 		{
+			SleepIsland(islandId);
 			continue;
 		}
 
-		if (seed->IsAwake() == false || seed->IsEnabled() == false)
+		++islandCount;
+
+		island->bodyCount = gather.bodyCount - island->bodyStart;
+		island->contactCount = gather.contactCount - island->contactStart;
+		island->jointCount = gather.jointCount - island->jointStart;
+
+		for (int32 j = 0; j < island->bodyCount; ++j)
 		{
-			continue;
+			gather.bodies[island->bodyStart + j]->m_islandIndex = j;
 		}
 
-		// The seed can be dynamic or kinematic.
-		if (seed->GetType() == b2_staticBody)
+		// Static bodies are never part of an island, they only need a slot.
+		for (int32 j = staticStart; j < gather.staticCount; ++j)
 		{
-			continue;
+			gather.staticBodies[j]->m_islandIndex = j;
 		}
 
-		// Reset island and stack.
-		island.Clear();
-		int32 stackCount = 0;
-		stack[stackCount++] = seed;
-		seed->m_flags |= b2Body::e_islandFlag;
+		island->splitPending = persistentIsland->constraintRemoveCount > 0;
+		island->maxSleepTime = 0.0f;
+		maxIslandBodyCount = b2Max(maxIslandBodyCount, island->bodyCount);
+	}
+
+	b2Body** bodies = gather.bodies;
+	b2Contact** contacts = gather.contacts;
+	b2Joint** joints = gather.joints;
+	b2Body** staticBodies = gather.staticBodies;
+	int32 bodyCount = gather.bodyCount;
+	int32 contactCount = gather.contactCount;
+	int32 jointCount = gather.jointCount;
+	int32 staticCount = gather.staticCount;
+
+	m_islandCount = islandCount;
+	B2_TRACE_COUNTER("Islands", islandCount);
+
+	int32 splitIslandId = b2_nullIsland;
+
+	if (islandCount > 0)
+	{
+		for (int32 i = 0; i < staticCount; ++i)
+		{
+			staticBodies[i]->m_islandIndex += maxIslandBodyCount;
+		}
+
+		int32 threadCount = m_threadPool->GetThreadCount();
+		int32 slotCount = maxIslandBodyCount + staticCount;
 
-		// Perform a depth first search (DFS) on the constraint graph.
-		while (stackCount > 0)
+		b2Position** positions = (b2Position**)m_stackAllocator.Allocate(threadCount * sizeof(b2Position*));
+		b2Velocity** velocities = (b2Velocity**)m_stackAllocator.Allocate(threadCount * sizeof(b2Velocity*));
+		b2Profile* profiles = (b2Profile*)m_stackAllocator.Allocate(threadCount * sizeof(b2Profile));
+		memset(profiles, 0, threadCount * sizeof(b2Profile));
+
+		b2Position* positionSlots = (b2Position*)ReserveSolveBuffer(e_positionBuffer, threadCount * slotCount * sizeof(b2Position));
+		b2Velocity* velocitySlots = (b2Velocity*)ReserveSolveBuffer(e_velocityBuffer, threadCount * slotCount * sizeof(b2Velocity));
+
+		for (int32 i = 0; i < threadCount; ++i)
 		{
-			// Grab the next body off the stack and add it to the island.
-			b2Body* b = stack[--stackCount];
-			b2Assert(b->IsEnabled() == true);
-			island.Add(b);
+			positions[i] = positionSlots + i * slotCount;
+			velocities[i] = velocitySlots + i * slotCount;
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->GetType() == b2_staticBody)
+			// Static bodies don't move, so their slots are only written once.
+			for (int32 j = 0; j < staticCount; ++j)
 			{
-				continue;
+				b2Body* b = staticBodies[j];
+				positions[i][b->m_islandIndex].c = b->m_sweep.c;
+				positions[i][b->m_islandIndex].a = b->m_sweep.a;
+				velocities[i][b->m_islandIndex].v = b->m_linearVelocity;
+				velocities[i][b->m_islandIndex].w = b->m_angularVelocity;
 			}
+		}
+
+		b2SolveIslandsContext context;
+		context.step = step;
+		context.gravity = m_gravity;
+		context.allowSleep = m_allowSleep;
+		context.threadPool = m_threadPool;
+		context.islands = islands;
+		context.bodies = bodies;
+		context.contacts = contacts;
+		context.joints = joints;
+		context.positions = positions;
+		context.velocities = velocities;
+		context.profiles = profiles;
+
+		m_threadPool->ParallelFor(islandCount, 1, b2SolveIslands, &context);
+
+		for (int32 i = 0; i < threadCount; ++i)
+		{
+			m_profile.solveInit += profiles[i].solveInit;
+			m_profile.solveVelocity += profiles[i].solveVelocity;
+			m_profile.solvePosition += profiles[i].solvePosition;
+		}
 
-			// Make sure the body is awake (without resetting sleep timer).
-			b->m_flags |= b2Body::e_awakeFlag;
+		m_stackAllocator.Free(profiles);
+		m_stackAllocator.Free(velocities);
+		m_stackAllocator.Free(positions);
 
-			// Search all contacts connected to this body.
-			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+		// The contacts are stored in island order. The listener is called here because
+		// it may not be thread safe. The solver stored the impulses in the manifolds.
+		b2ContactListener* listener = m_contactManager.m_contactListener;
+		if (listener)
+		{
+			for (int32 i = 0; i < contactCount; ++i)
 			{
-				b2Contact* contact = ce->contact;
+				b2Contact* c = contacts[i];
+				const b2Manifold* manifold = c->GetManifold();
 
-				// Has this contact already been added to an island?
-				if (contact->m_flags & b2Contact::e_islandFlag)
+				b2ContactImpulse impulse;
+				impulse.count = manifold->pointCount;
+				for (int32 j = 0; j < manifold->pointCount; ++j)
 				{
-					continue;
+					impulse.normalImpulses[j] = manifold->points[j].normalImpulse;
+					impulse.tangentImpulses[j] = manifold->points[j].tangentImpulse;
 				}
 
-				// Is this contact solid and touching?
-				if (contact->IsEnabled() == false ||
-					contact->IsTouching() == false)
-				{
-					continue;
-				}
+				listener->PostSolve(c, &impulse);
+			}
+		}
 
-				// Skip sensors.
-				bool sensorA = contact->m_fixtureA->m_isSensor;
-				bool sensorB = contact->m_fixtureB->m_isSensor;
-				if (sensorA || sensorB)
-				{
-					continue;
-				}
+		// Same order as in Solve, so the same island is split.
+		float splitSleepTime = 0.0f;
+		for (int32 i = 0; i < islandCount; ++i)
+		{
+			const b2IslandRange* island = islands + i;
 
-				island.Add(contact);
-				contact->m_flags |= b2Contact::e_islandFlag;
+			if (bodies[island->bodyStart]->IsAwake() == false)
+			{
+				SleepIsland(island->islandId);
+			}
+			else if (island->splitPending && island->maxSleepTime > splitSleepTime)
+			{
+				splitIslandId = island->islandId;
+				splitSleepTime = island->maxSleepTime;
+			}
+		}
+	}
 
-				b2Body* other = ce->other;
+	// Post solve cleanup.
+	for (int32 i = 0; i < contactCount; ++i)
+	{
+		contacts[i]->m_flags &= ~b2Contact::e_islandFlag;
+	}
+	for (int32 i = 0; i < jointCount; ++i)
+	{
+		joints[i]->m_islandFlag = false;
+	}
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		bodies[i]->m_flags &= ~b2Body::e_islandFlag;
+	}
+	for (int32 i = 0; i < staticCount; ++i)
+	{
+		staticBodies[i]->m_flags &= ~b2Body::e_islandFlag;
+	}
 
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+	SynchronizeFixtures(bodies, bodyCount);
+
+	SplitCandidateIsland(splitIslandId);
+}
+
+void b2World::SynchronizeFixtures(b2Body** bodies, int32 count)
+{
+	B2_TRACE_SCOPE("SynchronizeFixtures");
+	b2Timer timer;
+
+	// Synchronize fixtures of the bodies that were solved, check for out of range bodies.
+	for (int32 i = 0; i < count; ++i)
+	{
+		// Update fixtures (for broad-phase).
+		bodies[i]->SynchronizeFixtures();
+	}
+
+	// Look for new contacts.
+	m_contactManager.FindNewContacts();
+	m_profile.broadphase = timer.GetMilliseconds();
+}
+
+// A contact whose TOI is computed in a batch. The sweeps are put on the common time
+// interval when the contact is gathered, computing the TOI then only reads the shapes.
+struct b2TOIQuery
+{
+	b2Contact* contact;
+	b2Sweep sweepA;
+	b2Sweep sweepB;
+
+	// alpha0 of the sweeps going in, the TOI coming out
+	float alpha;
+};
+
+// A contact to gather again after an event, sorted by its contact list position.
+struct b2TOIRegather
+{
+	b2Contact* contact;
+	int32 index;
+};
+
+struct b2TOIBatch
+{
+	b2TOIBatch(b2Allocator* allocator)
+		: queries(allocator), events(allocator), wokenBodies(allocator), regathers(allocator)
+	{
+		queryCount = 0;
+	}
+
+	b2GrowableStack<b2TOIQuery, 64> queries;
+
+	// Contacts with a cached TOI below one, the only ones that can be the next event.
+	b2GrowableStack<b2Contact*, 64> events;
+
+	// Bodies woken since the last gather, by the event or by listener callbacks.
+	b2GrowableStack<b2Body*, 64> wokenBodies;
+
+	b2GrowableStack<b2TOIRegather, 64> regathers;
+
+	int32 queryCount;
+};
+
+static int b2CompareRegathers(const void* a, const void* b)
+{
+	return ((const b2TOIRegather*)a)->index - ((const b2TOIRegather*)b)->index;
+}
+
+// Parallel task computing the TOI of a range of b2TOIQuery.
+static void b2ComputeTOIRange(int32 begin, int32 end, int32 workerIndex, void* context)
+{
+	B2_NOT_USED(workerIndex);
+
+	b2TOIQuery* queries = (b2TOIQuery*)context;
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2TOIQuery* query = queries + i;
+		b2Contact* c = query->contact;
+
+		b2TOIInput input;
+		input.proxyA.Set(c->GetFixtureA()->GetShape(), c->GetChildIndexA());
+		input.proxyB.Set(c->GetFixtureB()->GetShape(), c->GetChildIndexB());
+		input.sweepA = query->sweepA;
+		input.sweepB = query->sweepB;
+		input.tMax = 1.0f;
+
+		b2TOIOutput output;
+		b2TimeOfImpact(&output, &input);
+
+		// Beta is the fraction of the remaining portion of the .
+		float alpha0 = query->alpha;
+		float beta = output.t;
+		if (output.state == b2TOIOutput::e_touching)
+		{
+			query->alpha = b2Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
+		}
+		else
+		{
+			query->alpha = 1.0f;
+		}
+	}
+}
+
+// Adds the contact to the TOI events or queues the computation of its TOI.
+void b2World::GatherTOI(b2TOIBatch* batch, b2Contact* c)
+{
+	// Is this contact disabled?
+	if (c->IsEnabled() == false)
+	{
+		return;
+	}
+
+	// Prevent excessive sub-stepping.
+	if (c->m_toiCount > b2_maxSubSteps)
+	{
+		return;
+	}
+
+	if (c->m_flags & b2Contact::e_toiFlag)
+	{
+		// This contact has a valid cached TOI.
+		if (c->m_toi < 1.0f && (c->m_flags & b2Contact::e_toiEventFlag) == 0)
+		{
+			c->m_flags |= b2Contact::e_toiEventFlag;
+			batch->events.Push(c);
+		}
+		return;
+	}
+
+	b2Fixture* fA = c->GetFixtureA();
+	b2Fixture* fB = c->GetFixtureB();
+
+	// Is there a sensor?
+	if (fA->IsSensor() || fB->IsSensor())
+	{
+		return;
+	}
+
+	b2Body* bA = fA->GetBody();
+	b2Body* bB = fB->GetBody();
+
+	b2BodyType typeA = bA->m_type;
+	b2BodyType typeB = bB->m_type;
+	b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
+
+	bool activeA = bA->IsAwake() && typeA != b2_staticBody;
+	bool activeB = bB->IsAwake() && typeB != b2_staticBody;
+
+	// Is at least one body active (awake and dynamic or kinematic)?
+	if (activeA == false && activeB == false)
+	{
+		return;
+	}
+
+	bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
+	bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
+
+	// Are these two non-bullet dynamic bodies?
+	if (collideA == false && collideB == false)
+	{
+		return;
+	}
+
+	// Put the sweeps onto the same time interval.
+	float alpha0 = bA->m_sweep.alpha0;
+
+	if (bA->m_sweep.alpha0 < bB->m_sweep.alpha0)
+	{
+		alpha0 = bB->m_sweep.alpha0;
+		bA->m_sweep.Advance(alpha0);
+	}
+	else if (bB->m_sweep.alpha0 < bA->m_sweep.alpha0)
+	{
+		alpha0 = bA->m_sweep.alpha0;
+		bB->m_sweep.Advance(alpha0);
+	}
+
+	b2Assert(alpha0 < 1.0f);
+
+	b2TOIQuery query;
+	query.contact = c;
+	query.sweepA = bA->m_sweep;
+	query.sweepB = bB->m_sweep;
+	query.alpha = alpha0;
+	batch->queries.Push(query);
+}
+
+void b2World::AddTOIWake(b2Body* body)
+{
+	m_toiBatch->wokenBodies.Push(body);
+}
+
+// Queue the contacts of a body to be gathered again. The island flag keeps a contact
+// from being queued twice.
+void b2World::MarkTOIContacts(b2TOIBatch* batch, b2Body* body)
+{
+	for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+	{
+		b2Contact* contact = ce->contact;
+		if ((contact->m_flags & b2Contact::e_islandFlag) == 0)
+		{
+			contact->m_flags |= b2Contact::e_islandFlag;
+
+			b2TOIRegather regather;
+			regather.contact = contact;
+			regather.index = contact->m_toiIndex;
+			batch->regathers.Push(regather);
+		}
+	}
+}
+
+// Gather the queued contacts and those of the woken bodies again, in contact list order
+// like a scan of the whole list. A contact between bodies on different time intervals
+// advances one of the sweeps, so the order matters.
+void b2World::RegatherTOIs(b2TOIBatch* batch)
+{
+	while (batch->wokenBodies.GetCount() > 0)
+	{
+		MarkTOIContacts(batch, batch->wokenBodies.Pop());
+	}
+
+	int32 count = batch->regathers.GetCount();
+	if (count == 0)
+	{
+		return;
+	}
+
+	qsort(&batch->regathers[0], count, sizeof(b2TOIRegather), b2CompareRegathers);
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Contact* contact = batch->regathers[i].contact;
+		contact->m_flags &= ~b2Contact::e_islandFlag;
+		GatherTOI(batch, contact);
+	}
+
+	while (batch->regathers.GetCount() > 0)
+	{
+		batch->regathers.Pop();
+	}
+}
+
+// Compute the gathered TOIs, in parallel when there is a thread pool.
+void b2World::ComputeTOIs(b2TOIBatch* batch)
+{
+	int32 count = batch->queries.GetCount();
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (m_threadPool)
+	{
+		m_threadPool->ParallelFor(count, 16, b2ComputeTOIRange, &batch->queries[0]);
+	}
+	else
+	{
+		b2ComputeTOIRange(0, count, 0, &batch->queries[0]);
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2TOIQuery* query = &batch->queries[i];
+		b2Contact* c = query->contact;
+		c->m_toi = query->alpha;
+		c->m_flags |= b2Contact::e_toiFlag;
+
+		if (query->alpha < 1.0f && (c->m_flags & b2Contact::e_toiEventFlag) == 0)
+		{
+			c->m_flags |= b2Contact::e_toiEventFlag;
+			batch->events.Push(c);
+		}
+	}
+
+	batch->queryCount += count;
+	while (batch->queries.GetCount() > 0)
+	{
+		batch->queries.Pop();
+	}
+}
+
+// Compute the gathered TOIs, find the first one and drop the events that were invalidated.
+b2Contact* b2World::FindMinTOI(b2TOIBatch* batch, float* minAlphaOut)
+{
+	ComputeTOIs(batch);
+
+	b2Contact* minContact = nullptr;
+	float minAlpha = 1.0f;
+
+	int32 keepCount = 0;
+	for (int32 i = 0; i < batch->events.GetCount(); ++i)
+	{
+		b2Contact* c = batch->events[i];
+		if ((c->m_flags & b2Contact::e_toiFlag) == 0 || c->m_toi >= 1.0f ||
+			c->IsEnabled() == false || c->m_toiCount > b2_maxSubSteps)
+		{
+			c->m_flags &= ~b2Contact::e_toiEventFlag;
+			continue;
+		}
+
+		batch->events[keepCount++] = c;
+
+		float alpha = c->m_toi;
+		if (alpha < minAlpha || (alpha == minAlpha && c->m_toiIndex < minContact->m_toiIndex))
+		{
+			// This is the minimum TOI found so far.
+			minContact = c;
+			minAlpha = alpha;
+		}
+	}
+
+	while (batch->events.GetCount() > keepCount)
+	{
+		batch->events.Pop();
+	}
+
+	*minAlphaOut = minAlpha;
+	return minContact;
+}
+
+// Find the first TOI by scanning all contacts, computing the TOIs that aren't cached.
+// This is what SolveTOI did before the batches, it is kept as their reference.
+b2Contact* b2World::ScanMinTOI(float* minAlphaOut)
+{
+	b2Contact* minContact = nullptr;
+	float minAlpha = 1.0f;
+
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		// Is this contact disabled?
+		if (c->IsEnabled() == false)
+		{
+			continue;
+		}
+
+		// Prevent excessive sub-stepping.
+		if (c->m_toiCount > b2_maxSubSteps)
+		{
+			continue;
+		}
+
+		float alpha = 1.0f;
+		if (c->m_flags & b2Contact::e_toiFlag)
+		{
+			// This contact has a valid cached TOI.
+			alpha = c->m_toi;
+		}
+		else
+		{
+			b2Fixture* fA = c->GetFixtureA();
+			b2Fixture* fB = c->GetFixtureB();
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
+			// Is there a sensor?
+			if (fA->IsSensor() || fB->IsSensor())
+			{
+				continue;
 			}
 
-			// Search all joints connect to this body.
-			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
-			{
-				if (je->joint->m_islandFlag == true)
-				{
-					continue;
-				}
+			b2Body* bA = fA->GetBody();
+			b2Body* bB = fB->GetBody();
 
-				b2Body* other = je->other;
+			b2BodyType typeA = bA->m_type;
+			b2BodyType typeB = bB->m_type;
+			b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
 
-				// Don't simulate joints connected to disabled bodies.
-				if (other->IsEnabled() == false)
-				{
-					continue;
-				}
+			bool activeA = bA->IsAwake() && typeA != b2_staticBody;
+			bool activeB = bB->IsAwake() && typeB != b2_staticBody;
 
-				island.Add(je->joint);
-				je->joint->m_islandFlag = true;
+			// Is at least one body active (awake and dynamic or kinematic)?
+			if (activeA == false && activeB == false)
+			{
+				continue;
+			}
 
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+			bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
+			bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
+			// Are these two non-bullet dynamic bodies?
+			if (collideA == false && collideB == false)
+			{
+				continue;
 			}
-		}
 
-		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
-		m_profile.solveInit += profile.solveInit;
-		m_profile.solveVelocity += profile.solveVelocity;
-		m_profile.solvePosition += profile.solvePosition;
+			// Compute the TOI for this contact.
+			// Put the sweeps onto the same time interval.
+			float alpha0 = bA->m_sweep.alpha0;
 
-		// Post solve cleanup.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
-		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = island.m_bodies[i];
-			if (b->GetType() == b2_staticBody)
+			if (bA->m_sweep.alpha0 < bB->m_sweep.alpha0)
 			{
-				b->m_flags &= ~b2Body::e_islandFlag;
+				alpha0 = bB->m_sweep.alpha0;
+				bA->m_sweep.Advance(alpha0);
+			}
+			else if (bB->m_sweep.alpha0 < bA->m_sweep.alpha0)
+			{
+				alpha0 = bA->m_sweep.alpha0;
+				bB->m_sweep.Advance(alpha0);
 			}
-		}
-	}
 
-	m_stackAllocator.Free(stack);
+			b2Assert(alpha0 < 1.0f);
 
-	{
-		b2Timer timer;
-		// Synchronize fixtures, check for out of range bodies.
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
-		{
-			// If a body was not in an island then it did not move.
-			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			int32 indexA = c->GetChildIndexA();
+			int32 indexB = c->GetChildIndexB();
+
+			// Compute the time of impact in interval [0, minTOI]
+			b2TOIInput input;
+			input.proxyA.Set(fA->GetShape(), indexA);
+			input.proxyB.Set(fB->GetShape(), indexB);
+			input.sweepA = bA->m_sweep;
+			input.sweepB = bB->m_sweep;
+			input.tMax = 1.0f;
+
+			b2TOIOutput output;
+			b2TimeOfImpact(&output, &input);
+
+			// Beta is the fraction of the remaining portion of the .
+			float beta = output.t;
+			if (output.state == b2TOIOutput::e_touching)
 			{
-				continue;
+				alpha = b2Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
 			}
-
-			if (b->GetType() == b2_staticBody)
+			else
 			{
-				continue;
+				alpha = 1.0f;
 			}
 
-			// Update fixtures (for broad-phase).
-			b->SynchronizeFixtures();
+			c->m_toi = alpha;
+			c->m_flags |= b2Contact::e_toiFlag;
 		}
 
-		// Look for new contacts.
-		m_contactManager.FindNewContacts();
-		m_profile.broadphase = timer.GetMilliseconds();
+		if (alpha < minAlpha)
+		{
+			// This is the minimum TOI found so far.
+			minContact = c;
+			minAlpha = alpha;
+		}
 	}
+
+	*minAlphaOut = minAlpha;
+	return minContact;
 }
 
 // Find TOI contacts and solve them.
+//
+// Gives the same events in the same order as scanning all contacts for the earliest TOI
+// before every event. The first scan computes the TOI of every candidate contact in one
+// batch. An event only changes the contacts of the bodies in its island and of the bodies
+// it woke, so after it just those are gathered again. Equal TOIs go to the contact first
+// in the contact list.
 void b2World::SolveTOI(const b2TimeStep& step)
 {
 	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener);
@@ -603,122 +1597,28 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		}
 	}
 
-	// Find TOI events and solve them.
-	for (;;)
-	{
-		// Find the first TOI.
-		b2Contact* minContact = nullptr;
-		float minAlpha = 1.0f;
+	b2TOIBatch batch(m_allocator);
 
+	// Number the contacts and gather all of them.
+	int32 firstIndex = 0;
+	if (m_batchTOI)
+	{
+		int32 index = 0;
 		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
 		{
-			// Is this contact disabled?
-			if (c->IsEnabled() == false)
-			{
-				continue;
-			}
-
-			// Prevent excessive sub-stepping.
-			if (c->m_toiCount > b2_maxSubSteps)
-			{
-				continue;
-			}
-
-			float alpha = 1.0f;
-			if (c->m_flags & b2Contact::e_toiFlag)
-			{
-				// This contact has a valid cached TOI.
-				alpha = c->m_toi;
-			}
-			else
-			{
-				b2Fixture* fA = c->GetFixtureA();
-				b2Fixture* fB = c->GetFixtureB();
-
-				// Is there a sensor?
-				if (fA->IsSensor() || fB->IsSensor())
-				{
-					continue;
-				}
-
-				b2Body* bA = fA->GetBody();
-				b2Body* bB = fB->GetBody();
-
-				b2BodyType typeA = bA->m_type;
-				b2BodyType typeB = bB->m_type;
-				b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
-
-				bool activeA = bA->IsAwake() && typeA != b2_staticBody;
-				bool activeB = bB->IsAwake() && typeB != b2_staticBody;
-
-				// Is at least one body active (awake and dynamic or kinematic)?
-				if (activeA == false && activeB == false)
-				{
-					continue;
-				}
-
-				bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
-				bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
-
-				// Are these two non-bullet dynamic bodies?
-				if (collideA == false && collideB == false)
-				{
-					continue;
-				}
-
-				// Compute the TOI for this contact.
-				// Put the sweeps onto the same time interval.
-				float alpha0 = bA->m_sweep.alpha0;
-
-				if (bA->m_sweep.alpha0 < bB->m_sweep.alpha0)
-				{
-					alpha0 = bB->m_sweep.alpha0;
-					bA->m_sweep.Advance(alpha0);
-				}
-				else if (bB->m_sweep.alpha0 < bA->m_sweep.alpha0)
-				{
-					alpha0 = bA->m_sweep.alpha0;
-					bB->m_sweep.Advance(alpha0);
-				}
-
-				b2Assert(alpha0 < 1.0f);
-
-				int32 indexA = c->GetChildIndexA();
-				int32 indexB = c->GetChildIndexB();
-
-				// Compute the time of impact in interval [0, minTOI]
-				b2TOIInput input;
-				input.proxyA.Set(fA->GetShape(), indexA);
-				input.proxyB.Set(fB->GetShape(), indexB);
-				input.sweepA = bA->m_sweep;
-				input.sweepB = bB->m_sweep;
-				input.tMax = 1.0f;
-
-				b2TOIOutput output;
-				b2TimeOfImpact(&output, &input);
-
-				// Beta is the fraction of the remaining portion of the .
-				float beta = output.t;
-				if (output.state == b2TOIOutput::e_touching)
-				{
-					alpha = b2Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
-				}
-				else
-				{
-					alpha = 1.0f;
-				}
+			c->m_toiIndex = index++;
+			GatherTOI(&batch, c);
+		}
 
-				c->m_toi = alpha;
-				c->m_flags |= b2Contact::e_toiFlag;
-			}
+		m_toiBatch = &batch;
+	}
 
-			if (alpha < minAlpha)
-			{
-				// This is the minimum TOI found so far.
-				minContact = c;
-				minAlpha = alpha;
-			}
-		}
+	// Find TOI events and solve them.
+	int32 eventCount = 0;
+	for (;;)
+	{
+		float minAlpha = 1.0f;
+		b2Contact* minContact = m_batchTOI ? FindMinTOI(&batch, &minAlpha) : ScanMinTOI(&minAlpha);
 
 		if (minContact == nullptr || 1.0f - 10.0f * b2_epsilon < minAlpha)
 		{
@@ -727,6 +1627,9 @@ void b2World::SolveTOI(const b2TimeStep& step)
 			break;
 		}
 
+		B2_TRACE_SCOPE("TOI Sub-step");
+		++eventCount;
+
 		// Advance the bodies to the TOI.
 		b2Fixture* fA = minContact->GetFixtureA();
 		b2Fixture* fB = minContact->GetFixtureB();
@@ -753,6 +1656,12 @@ void b2World::SolveTOI(const b2TimeStep& step)
 			bB->m_sweep = backup2;
 			bA->SynchronizeTransform();
 			bB->SynchronizeTransform();
+
+			// Update may have woken the bodies.
+			if (m_batchTOI)
+			{
+				RegatherTOIs(&batch);
+			}
 			continue;
 		}
 
@@ -868,6 +1777,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		subStep.positionIterations = 20;
 		subStep.velocityIterations = step.velocityIterations;
 		subStep.warmStarting = false;
+		subStep.contactSolverWidth = 1;
 		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
 
 		// Reset island flags and synchronize broad-phase proxies.
@@ -892,18 +1802,63 @@ void b2World::SolveTOI(const b2TimeStep& step)
 
 		// Commit fixture proxy movements to the broad-phase so that new contacts are created.
 		// Also, some contacts can be destroyed.
+		b2Contact* oldHead = m_contactManager.m_contactList;
 		m_contactManager.FindNewContacts();
 
+		// New contacts are put in front of the contact list.
+		int32 newCount = 0;
+		for (b2Contact* c = m_contactManager.m_contactList; c != oldHead; c = c->m_next)
+		{
+			++newCount;
+		}
+
+		firstIndex -= newCount;
+		{
+			int32 index = firstIndex;
+			for (b2Contact* c = m_contactManager.m_contactList; c != oldHead; c = c->m_next)
+			{
+				c->m_toiIndex = index++;
+			}
+		}
+
 		if (m_subStepping)
 		{
 			m_stepComplete = false;
 			break;
 		}
+
+		if (m_batchTOI == false)
+		{
+			continue;
+		}
+
+		// Gather the contacts of the moved bodies again, new contacts included.
+		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		{
+			b2Body* body = island.m_bodies[i];
+			if (body->m_type != b2_staticBody)
+			{
+				MarkTOIContacts(&batch, body);
+			}
+		}
+
+		RegatherTOIs(&batch);
+	}
+
+	m_toiBatch = nullptr;
+
+	for (int32 i = 0; i < batch.events.GetCount(); ++i)
+	{
+		batch.events[i]->m_flags &= ~b2Contact::e_toiEventFlag;
 	}
+
+	B2_TRACE_COUNTER("TOI events", eventCount);
+	B2_TRACE_COUNTER("TOI queries", batch.queryCount);
 }
 
 void b2World::Step(float dt, int32 velocityIterations, int32 positionIterations)
 {
+	B2_TRACE_SCOPE("Step");
 	b2Timer stepTimer;
 
 	// If new fixtures were added, we need to find the new contacts.
@@ -931,17 +1886,21 @@ void b2World::Step(float dt, int32 velocityIterations, int32 positionIterations)
 	step.dtRatio = m_inv_dt0 * dt;
 
 	step.warmStarting = m_warmStarting;
+	step.contactSolverWidth = m_contactSolverWidth;
 	
 	// Update contacts. This is where some contacts are destroyed.
 	{
+		B2_TRACE_SCOPE("Collide");
 		b2Timer timer;
 		m_contactManager.Collide();
 		m_profile.collide = timer.GetMilliseconds();
 	}
 
 	// Integrate velocities, solve velocity constraints, and integrate positions.
+	m_islandCount = 0;
 	if (m_stepComplete && step.dt > 0.0f)
 	{
+		B2_TRACE_SCOPE("Solve");
 		b2Timer timer;
 		Solve(step);
 		m_profile.solve = timer.GetMilliseconds();
@@ -950,6 +1909,7 @@ void b2World::Step(float dt, int32 velocityIterations, int32 positionIterations)
 	// Handle TOI events.
 	if (m_continuousPhysics && step.dt > 0.0f)
 	{
+		B2_TRACE_SCOPE("SolveTOI");
 		b2Timer timer;
 		SolveTOI(step);
 		m_profile.solveTOI = timer.GetMilliseconds();
@@ -967,6 +1927,11 @@ void b2World::Step(float dt, int32 velocityIterations, int32 positionIterations)
 
 	m_locked = false;
 
+	B2_TRACE_COUNTER("Bodies", m_bodyCount);
+	B2_TRACE_COUNTER("Contacts", m_contactManager.m_contactCount);
+	B2_TRACE_COUNTER("Proxies", m_contactManager.m_broadPhase.GetProxyCount());
+	B2_TRACE_COUNTER("Tree height", m_contactManager.m_broadPhase.GetTreeHeight());
+
 	m_profile.step = stepTimer.GetMilliseconds();
 }
 
@@ -1104,6 +2069,44 @@ void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color
 	}
 }
 
+// The draw transform hook is opt-in, see b2Draw::e_bodyTransformBit.
+static b2Transform b2GetDrawTransform(const b2Draw* draw, const b2Body* b)
+{
+	if (draw->GetFlags() & b2Draw::e_bodyTransformBit)
+	{
+		return draw->GetBodyTransform(b);
+	}
+
+	return b->GetTransform();
+}
+
+static b2Color b2GetShapeColor(const b2Body* b)
+{
+	if (b->GetType() == b2_dynamicBody && b->GetMass() == 0.0f)
+	{
+		// Bad body
+		return b2Color(1.0f, 0.0f, 0.0f);
+	}
+	else if (b->IsEnabled() == false)
+	{
+		return b2Color(0.5f, 0.5f, 0.3f);
+	}
+	else if (b->GetType() == b2_staticBody)
+	{
+		return b2Color(0.5f, 0.9f, 0.5f);
+	}
+	else if (b->GetType() == b2_kinematicBody)
+	{
+		return b2Color(0.5f, 0.5f, 0.9f);
+	}
+	else if (b->IsAwake() == false)
+	{
+		return b2Color(0.6f, 0.6f, 0.6f);
+	}
+
+	return b2Color(0.9f, 0.7f, 0.7f);
+}
+
 void b2World::DebugDraw()
 {
 	if (m_debugDraw == nullptr)
@@ -1117,34 +2120,11 @@ void b2World::DebugDraw()
 	{
 		for (b2Body* b = m_bodyList; b; b = b->GetNext())
 		{
-			const b2Transform& xf = b->GetTransform();
+			b2Transform xf = b2GetDrawTransform(m_debugDraw, b);
+			b2Color color = b2GetShapeColor(b);
 			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
 			{
-				if (b->GetType() == b2_dynamicBody && b->m_mass == 0.0f)
-				{
-					// Bad body
-					DrawShape(f, xf, b2Color(1.0f, 0.0f, 0.0f));
-				}
-				else if (b->IsEnabled() == false)
-				{
-					DrawShape(f, xf, b2Color(0.5f, 0.5f, 0.3f));
-				}
-				else if (b->GetType() == b2_staticBody)
-				{
-					DrawShape(f, xf, b2Color(0.5f, 0.9f, 0.5f));
-				}
-				else if (b->GetType() == b2_kinematicBody)
-				{
-					DrawShape(f, xf, b2Color(0.5f, 0.5f, 0.9f));
-				}
-				else if (b->IsAwake() == false)
-				{
-					DrawShape(f, xf, b2Color(0.6f, 0.6f, 0.6f));
-				}
-				else
-				{
-					DrawShape(f, xf, b2Color(0.9f, 0.7f, 0.7f));
-				}
+				DrawShape(f, xf, color);
 			}
 		}
 	}
@@ -1207,13 +2187,153 @@ void b2World::DebugDraw()
 	{
 		for (b2Body* b = m_bodyList; b; b = b->GetNext())
 		{
-			b2Transform xf = b->GetTransform();
-			xf.p = b->GetWorldCenter();
+			b2Transform xf = b2GetDrawTransform(m_debugDraw, b);
+			xf.p = b2Mul(xf, b->GetLocalCenter());
 			m_debugDraw->DrawTransform(xf);
 		}
 	}
 }
 
+struct b2WorldDebugDrawWrapper
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		b2Fixture* fixture = proxy->fixture;
+		b2Body* body = fixture->GetBody();
+
+		if (flags & b2Draw::e_shapeBit)
+		{
+			b2Transform xf = b2GetDrawTransform(draw, body);
+			b2Color color = b2GetShapeColor(body);
+
+			if (fixture->GetType() == b2Shape::e_chain)
+			{
+				// Only the edges of a chain that are in view.
+				b2ChainShape* chain = (b2ChainShape*)fixture->GetShape();
+				b2EdgeShape edge;
+				chain->GetChildEdge(&edge, proxy->childIndex);
+				draw->DrawSegment(b2Mul(xf, edge.m_vertex1), b2Mul(xf, edge.m_vertex2), color);
+			}
+			else
+			{
+				world->DrawShape(fixture, xf, color);
+			}
+		}
+
+		if (flags & b2Draw::e_aabbBit)
+		{
+			b2Color color(0.9f, 0.3f, 0.9f);
+			b2AABB aabb = broadPhase->GetFatAABB(proxyId);
+			b2Vec2 vs[4];
+			vs[0].Set(aabb.lowerBound.x, aabb.lowerBound.y);
+			vs[1].Set(aabb.upperBound.x, aabb.lowerBound.y);
+			vs[2].Set(aabb.upperBound.x, aabb.upperBound.y);
+			vs[3].Set(aabb.lowerBound.x, aabb.upperBound.y);
+
+			draw->DrawPolygon(vs, 4, color);
+		}
+
+		// Draw the body frame once, from the first of its proxies in view.
+		if ((flags & b2Draw::e_centerOfMassBit) && body->m_drawStamp != stamp)
+		{
+			body->m_drawStamp = stamp;
+			b2Transform xf = b2GetDrawTransform(draw, body);
+			xf.p = b2Mul(xf, body->GetLocalCenter());
+			draw->DrawTransform(xf);
+		}
+
+		return true;
+	}
+
+	b2World* world;
+	b2Draw* draw;
+	const b2BroadPhase* broadPhase;
+	uint32 flags;
+	uint32 stamp;
+};
+
+void b2World::DebugDraw(const b2AABB& viewAABB)
+{
+	if (m_debugDraw == nullptr)
+	{
+		return;
+	}
+
+	uint32 flags = m_debugDraw->GetFlags();
+
+	// Disabled bodies have no proxies, so they are drawn by walking the body list.
+	// There are usually few of them.
+	if (flags & b2Draw::e_shapeBit)
+	{
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			if (b->IsEnabled())
+			{
+				continue;
+			}
+
+			b2Transform xf = b2GetDrawTransform(m_debugDraw, b);
+			b2Color color = b2GetShapeColor(b);
+			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+			{
+				DrawShape(f, xf, color);
+			}
+		}
+	}
+
+	if (flags & (b2Draw::e_shapeBit | b2Draw::e_aabbBit | b2Draw::e_centerOfMassBit))
+	{
+		b2WorldDebugDrawWrapper wrapper;
+		wrapper.world = this;
+		wrapper.draw = m_debugDraw;
+		wrapper.broadPhase = &m_contactManager.m_broadPhase;
+		wrapper.flags = flags;
+		wrapper.stamp = ++m_drawStamp;
+		m_contactManager.m_broadPhase.Query(&wrapper, viewAABB);
+	}
+
+	if (flags & b2Draw::e_jointBit)
+	{
+		for (b2Joint* j = m_jointList; j; j = j->GetNext())
+		{
+			b2Vec2 pA = j->GetAnchorA();
+			b2Vec2 pB = j->GetAnchorB();
+			b2AABB aabb;
+			aabb.lowerBound = b2Min(pA, pB);
+			aabb.upperBound = b2Max(pA, pB);
+
+			if (b2TestOverlap(aabb, viewAABB))
+			{
+				j->Draw(m_debugDraw);
+			}
+		}
+	}
+
+	if (flags & b2Draw::e_pairBit)
+	{
+		b2Color color(0.3f, 0.9f, 0.9f);
+		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->GetNext())
+		{
+			b2Fixture* fixtureA = c->GetFixtureA();
+			b2Fixture* fixtureB = c->GetFixtureB();
+			int32 indexA = c->GetChildIndexA();
+			int32 indexB = c->GetChildIndexB();
+			b2Vec2 cA = fixtureA->GetAABB(indexA).GetCenter();
+			b2Vec2 cB = fixtureB->GetAABB(indexB).GetCenter();
+
+			b2AABB aabb;
+			aabb.lowerBound = b2Min(cA, cB);
+			aabb.upperBound = b2Max(cA, cB);
+
+			if (b2TestOverlap(aabb, viewAABB))
+			{
+				m_debugDraw->DrawSegment(cA, cB, color);
+			}
+		}
+	}
+}
+
 int32 b2World::GetProxyCount() const
 {
 	return m_contactManager.m_broadPhase.GetProxyCount();
@@ -1234,6 +2354,27 @@ float b2World::GetTreeQuality() const
 	return m_contactManager.m_broadPhase.GetTreeQuality();
 }
 
+void b2World::RebuildBroadPhase()
+{
+	b2Assert(m_locked == false);
+	if (m_locked)
+	{
+		return;
+	}
+
+	m_contactManager.m_broadPhase.RebuildTree();
+}
+
+void b2World::SetBroadPhaseRefitting(bool flag)
+{
+	m_contactManager.m_broadPhase.SetRefitProxies(flag);
+}
+
+bool b2World::GetBroadPhaseRefitting() const
+{
+	return m_contactManager.m_broadPhase.GetRefitProxies();
+}
+
 void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	b2Assert(m_locked == false);
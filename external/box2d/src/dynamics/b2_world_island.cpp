@@ -0,0 +1,515 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "b2_island.h"
+#include "common/b2_snapshot.h"
+
+#include "box2d/b2_body.h"
+#include "box2d/b2_contact.h"
+#include "box2d/b2_joint.h"
+#include "box2d/b2_trace.h"
+#include "box2d/b2_world.h"
+
+#include <string.h>
+
+// The islands are kept from step to step instead of being searched for in the whole
+// constraint graph by each step. A touching contact or a joint between two islands merges
+// them, the smaller one is moved into the larger one. Removing a contact, joint or body
+// only counts the removal, because finding out whether the island came apart takes a
+// search of the island. An island with removals is kept awake until it is split, and
+// each step splits the island whose bodies want to sleep the most. The step only visits
+// the awake islands, so sleeping and static bodies cost nothing.
+
+int32 b2World::CreateIsland()
+{
+	if (m_freeIsland == b2_nullIsland)
+	{
+		// The awake islands grow with the islands, there can't be more of them.
+		int32 capacity = m_islandCapacity > 0 ? 2 * m_islandCapacity : 16;
+		b2PersistentIsland* islands = (b2PersistentIsland*)b2Allocate(m_allocator, capacity * sizeof(b2PersistentIsland));
+		int32* awakeIslands = (int32*)b2Allocate(m_allocator, capacity * sizeof(int32));
+
+		if (m_islands)
+		{
+			memcpy(islands, m_islands, m_islandCapacity * sizeof(b2PersistentIsland));
+			memcpy(awakeIslands, m_awakeIslands, m_awakeIslandCount * sizeof(int32));
+			b2Deallocate(m_allocator, m_islands, m_islandCapacity * sizeof(b2PersistentIsland));
+			b2Deallocate(m_allocator, m_awakeIslands, m_islandCapacity * sizeof(int32));
+		}
+
+		// Build a linked list for the free list, the lower ids are used first.
+		for (int32 i = m_islandCapacity; i < capacity - 1; ++i)
+		{
+			islands[i].next = i + 1;
+		}
+		islands[capacity - 1].next = b2_nullIsland;
+
+		m_freeIsland = m_islandCapacity;
+		m_islands = islands;
+		m_awakeIslands = awakeIslands;
+		m_islandCapacity = capacity;
+	}
+
+	int32 islandId = m_freeIsland;
+	b2PersistentIsland* island = m_islands + islandId;
+	m_freeIsland = island->next;
+
+	island->bodyList = nullptr;
+	island->bodyCount = 0;
+	island->constraintRemoveCount = 0;
+	island->awakeIndex = b2_nullIsland;
+	island->next = b2_nullIsland;
+	return islandId;
+}
+
+void b2World::DestroyIsland(int32 islandId)
+{
+	b2Assert(0 <= islandId && islandId < m_islandCapacity);
+	SleepIsland(islandId);
+
+	b2PersistentIsland* island = m_islands + islandId;
+	island->bodyList = nullptr;
+	island->bodyCount = 0;
+	island->next = m_freeIsland;
+	m_freeIsland = islandId;
+}
+
+// Give a new or enabled body its own island and merge it with the islands of the bodies
+// it has joints with. Its contacts are linked as they start touching.
+void b2World::AddToIsland(b2Body* body)
+{
+	if (body->m_type == b2_staticBody || body->IsEnabled() == false)
+	{
+		return;
+	}
+
+	b2Assert(body->m_islandId == b2_nullIsland);
+
+	int32 islandId = CreateIsland();
+	b2PersistentIsland* island = m_islands + islandId;
+	island->bodyList = body;
+	island->bodyCount = 1;
+
+	body->m_islandId = islandId;
+	body->m_islandPrev = nullptr;
+	body->m_islandNext = nullptr;
+
+	if (body->IsAwake())
+	{
+		WakeIsland(islandId);
+	}
+
+	for (b2JointEdge* je = body->m_jointList; je; je = je->next)
+	{
+		LinkBodies(body, je->other);
+	}
+}
+
+void b2World::RemoveFromIsland(b2Body* body)
+{
+	int32 islandId = body->m_islandId;
+	if (islandId == b2_nullIsland)
+	{
+		return;
+	}
+
+	b2PersistentIsland* island = m_islands + islandId;
+
+	if (body->m_islandPrev)
+	{
+		body->m_islandPrev->m_islandNext = body->m_islandNext;
+	}
+	else
+	{
+		island->bodyList = body->m_islandNext;
+	}
+
+	if (body->m_islandNext)
+	{
+		body->m_islandNext->m_islandPrev = body->m_islandPrev;
+	}
+
+	body->m_islandId = b2_nullIsland;
+	body->m_islandPrev = nullptr;
+	body->m_islandNext = nullptr;
+
+	--island->bodyCount;
+	if (island->bodyCount == 0)
+	{
+		DestroyIsland(islandId);
+	}
+	else
+	{
+		++island->constraintRemoveCount;
+	}
+}
+
+// A contact started touching or a joint was added between two bodies. Static and disabled
+// bodies have no island and don't connect islands.
+void b2World::LinkBodies(b2Body* bodyA, b2Body* bodyB)
+{
+	int32 idA = bodyA->m_islandId;
+	int32 idB = bodyB->m_islandId;
+	if (idA == b2_nullIsland || idB == b2_nullIsland || idA == idB)
+	{
+		return;
+	}
+
+	// Move the bodies of the smaller island to the front of the larger one.
+	if (m_islands[idA].bodyCount < m_islands[idB].bodyCount)
+	{
+		b2Swap(idA, idB);
+	}
+
+	b2PersistentIsland* big = m_islands + idA;
+	b2PersistentIsland* small = m_islands + idB;
+
+	b2Body* tail = nullptr;
+	for (b2Body* b = small->bodyList; b; b = b->m_islandNext)
+	{
+		b->m_islandId = idA;
+		tail = b;
+	}
+
+	tail->m_islandNext = big->bodyList;
+	big->bodyList->m_islandPrev = tail;
+	big->bodyList = small->bodyList;
+	big->bodyCount += small->bodyCount;
+	big->constraintRemoveCount += small->constraintRemoveCount;
+
+	// The island is awake if either part was.
+	bool awake = small->awakeIndex != b2_nullIsland;
+	DestroyIsland(idB);
+
+	if (awake)
+	{
+		WakeIsland(idA);
+	}
+}
+
+// A touching contact or a joint between two bodies was removed.
+void b2World::UnlinkBodies(b2Body* bodyA, b2Body* bodyB)
+{
+	int32 islandId = bodyA->m_islandId;
+	if (islandId != b2_nullIsland && islandId == bodyB->m_islandId)
+	{
+		++m_islands[islandId].constraintRemoveCount;
+	}
+}
+
+void b2World::WakeIsland(int32 islandId)
+{
+	b2PersistentIsland* island = m_islands + islandId;
+	if (island->awakeIndex == b2_nullIsland)
+	{
+		b2Assert(m_awakeIslandCount < m_islandCapacity);
+		island->awakeIndex = m_awakeIslandCount;
+		m_awakeIslands[m_awakeIslandCount++] = islandId;
+	}
+}
+
+void b2World::SleepIsland(int32 islandId)
+{
+	b2PersistentIsland* island = m_islands + islandId;
+	if (island->awakeIndex != b2_nullIsland)
+	{
+		int32 lastId = m_awakeIslands[--m_awakeIslandCount];
+		m_awakeIslands[island->awakeIndex] = lastId;
+		m_islands[lastId].awakeIndex = island->awakeIndex;
+		island->awakeIndex = b2_nullIsland;
+	}
+}
+
+// Search the island for its connected parts and give each part its own island. The first
+// part keeps the island id.
+void b2World::SplitIsland(int32 islandId)
+{
+	b2PersistentIsland* island = m_islands + islandId;
+	int32 bodyCount = island->bodyCount;
+	bool awake = island->awakeIndex != b2_nullIsland;
+
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(bodyCount * sizeof(b2Body*));
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(bodyCount * sizeof(b2Body*));
+
+	int32 count = 0;
+	for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+	{
+		b->m_flags &= ~b2Body::e_islandFlag;
+		bodies[count++] = b;
+	}
+	b2Assert(count == bodyCount);
+
+	DestroyIsland(islandId);
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		b2Body* seed = bodies[i];
+		if (seed->m_flags & b2Body::e_islandFlag)
+		{
+			continue;
+		}
+
+		int32 partId = CreateIsland();
+		b2Body* tail = nullptr;
+		int32 partCount = 0;
+
+		int32 stackCount = 0;
+		stack[stackCount++] = seed;
+		seed->m_flags |= b2Body::e_islandFlag;
+
+		// Perform a depth first search (DFS) on the constraint graph of the island.
+		while (stackCount > 0)
+		{
+			b2Body* b = stack[--stackCount];
+
+			b->m_islandId = partId;
+			b->m_islandPrev = tail;
+			b->m_islandNext = nullptr;
+			if (tail)
+			{
+				tail->m_islandNext = b;
+			}
+			else
+			{
+				m_islands[partId].bodyList = b;
+			}
+			tail = b;
+			++partCount;
+
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			{
+				if ((ce->contact->m_flags & b2Contact::e_linkedFlag) == 0)
+				{
+					continue;
+				}
+
+				// Static bodies don't connect the parts.
+				b2Body* other = ce->other;
+				if (other->m_islandId == b2_nullIsland || (other->m_flags & b2Body::e_islandFlag))
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
+
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				b2Body* other = je->other;
+				if (other->m_islandId == b2_nullIsland || (other->m_flags & b2Body::e_islandFlag))
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
+		}
+
+		m_islands[partId].bodyCount = partCount;
+		if (awake)
+		{
+			WakeIsland(partId);
+		}
+	}
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		bodies[i]->m_flags &= ~b2Body::e_islandFlag;
+	}
+
+	m_stackAllocator.Free(stack);
+	m_stackAllocator.Free(bodies);
+}
+
+// Split the island the step picked, the one whose bodies want to sleep the most. Without
+// sleeping no body ever wants to, the largest awake island with removals is split then so
+// the islands don't only grow.
+void b2World::SplitCandidateIsland(int32 islandId)
+{
+	if (islandId == b2_nullIsland && m_allowSleep == false)
+	{
+		int32 maxBodyCount = 0;
+		for (int32 i = 0; i < m_awakeIslandCount; ++i)
+		{
+			const b2PersistentIsland* island = m_islands + m_awakeIslands[i];
+			if (island->constraintRemoveCount > 0 && island->bodyCount > maxBodyCount)
+			{
+				islandId = m_awakeIslands[i];
+				maxBodyCount = island->bodyCount;
+			}
+		}
+	}
+
+	if (islandId != b2_nullIsland)
+	{
+		B2_TRACE_SCOPE("SplitIsland");
+		SplitIsland(islandId);
+	}
+}
+
+void b2World::ClearIslands()
+{
+	if (m_islands)
+	{
+		b2Deallocate(m_allocator, m_islands, m_islandCapacity * sizeof(b2PersistentIsland));
+		b2Deallocate(m_allocator, m_awakeIslands, m_islandCapacity * sizeof(int32));
+	}
+
+	m_islands = nullptr;
+	m_islandCapacity = 0;
+	m_freeIsland = b2_nullIsland;
+	m_awakeIslands = nullptr;
+	m_awakeIslandCount = 0;
+}
+
+// Islands are stored as the snapshot indices of their bodies in list order. The awake
+// islands come first, in the order the next step solves them, then the sleeping islands
+// in the order of their first body in the world list.
+void b2World::SnapshotIslands(b2Snapshot* snapshot, b2Body** bodies)
+{
+	const bool loading = snapshot->IsLoading();
+
+	int32 islandCount = m_awakeIslandCount;
+	int32 awakeCount = m_awakeIslandCount;
+	if (loading == false)
+	{
+		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		{
+			int32 islandId = b->m_islandId;
+			if (islandId != b2_nullIsland && m_islands[islandId].bodyList == b &&
+				m_islands[islandId].awakeIndex == b2_nullIsland)
+			{
+				++islandCount;
+			}
+		}
+	}
+
+	snapshot->Count(islandCount, 3 * sizeof(int32));
+	snapshot->Value(awakeCount);
+
+	if (loading && (awakeCount < 0 || awakeCount > islandCount))
+	{
+		snapshot->SetInvalid();
+		return;
+	}
+
+	b2Body* sleepingBody = m_bodyList;
+	for (int32 i = 0; i < islandCount && snapshot->IsValid(); ++i)
+	{
+		int32 islandId;
+		if (loading)
+		{
+			islandId = CreateIsland();
+		}
+		else if (i < awakeCount)
+		{
+			islandId = m_awakeIslands[i];
+		}
+		else
+		{
+			// Find the first body of the next sleeping island.
+			while (sleepingBody->m_islandId == b2_nullIsland ||
+				m_islands[sleepingBody->m_islandId].bodyList != sleepingBody ||
+				m_islands[sleepingBody->m_islandId].awakeIndex != b2_nullIsland)
+			{
+				sleepingBody = sleepingBody->m_next;
+			}
+
+			islandId = sleepingBody->m_islandId;
+			sleepingBody = sleepingBody->m_next;
+		}
+
+		b2PersistentIsland* island = m_islands + islandId;
+		int32 bodyCount = island->bodyCount;
+		snapshot->Count(bodyCount, sizeof(int32));
+		snapshot->Value(island->constraintRemoveCount);
+
+		if (loading && bodyCount == 0)
+		{
+			snapshot->SetInvalid();
+			break;
+		}
+
+		b2Body* body = island->bodyList;
+		b2Body* tail = nullptr;
+		for (int32 k = 0; k < bodyCount && snapshot->IsValid(); ++k)
+		{
+			int32 index = loading ? 0 : body->m_islandIndex;
+			snapshot->Value(index);
+
+			if (loading == false)
+			{
+				body = body->m_islandNext;
+				continue;
+			}
+
+			if (index < 0 || index >= m_bodyCount)
+			{
+				snapshot->SetInvalid();
+				break;
+			}
+
+			body = bodies[index];
+			if (body->m_islandId != b2_nullIsland || body->m_type == b2_staticBody || body->IsEnabled() == false)
+			{
+				snapshot->SetInvalid();
+				break;
+			}
+
+			body->m_islandId = islandId;
+			body->m_islandPrev = tail;
+			body->m_islandNext = nullptr;
+			if (tail)
+			{
+				tail->m_islandNext = body;
+			}
+			else
+			{
+				island->bodyList = body;
+			}
+			tail = body;
+			++island->bodyCount;
+		}
+
+		if (loading && i < awakeCount)
+		{
+			WakeIsland(islandId);
+		}
+	}
+
+	if (loading && snapshot->IsValid())
+	{
+		// Every body that is simulated must be in an island.
+		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		{
+			if (b->m_islandId == b2_nullIsland && b->m_type != b2_staticBody && b->IsEnabled())
+			{
+				snapshot->SetInvalid();
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,389 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "common/b2_thread_pool.h"
+
+#include "box2d/b2_broad_phase.h"
+#include "box2d/b2_fixture.h"
+#include "box2d/b2_world.h"
+
+#include <string.h>
+
+// Batched queries sort their rays and boxes along a Morton curve, so neighbors in the
+// batch touch the same part of the tree, then hand them to the tree in packets.
+
+// Rays cast together by one tree traversal. More rays share more of the traversal
+// but each node is then tested against rays that mostly miss it.
+#define b2_rayPacketSize 8
+
+// Spread the low 16 bits of x to the even bits.
+static uint32 b2SpreadBits(uint32 x)
+{
+	x &= 0x0000FFFF;
+	x = (x | (x << 8)) & 0x00FF00FF;
+	x = (x | (x << 4)) & 0x0F0F0F0F;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+static b2Vec2 b2GetSortPoint(const b2RayCastInput& ray)
+{
+	return ray.p1;
+}
+
+static b2Vec2 b2GetSortPoint(const b2AABB& aabb)
+{
+	return aabb.GetCenter();
+}
+
+// Fill order with the indices of the items sorted by the Morton code of their position.
+template <typename T>
+static void b2SortByPosition(b2Allocator* allocator, const T* items, int32 count, int32* order)
+{
+	b2Vec2 lower = b2GetSortPoint(items[0]);
+	b2Vec2 upper = lower;
+	for (int32 i = 1; i < count; ++i)
+	{
+		b2Vec2 p = b2GetSortPoint(items[i]);
+		lower = b2Min(lower, p);
+		upper = b2Max(upper, p);
+	}
+
+	b2Vec2 extent = upper - lower;
+	float scaleX = extent.x > 0.0f ? 65535.0f / extent.x : 0.0f;
+	float scaleY = extent.y > 0.0f ? 65535.0f / extent.y : 0.0f;
+
+	uint32* keys = (uint32*)b2Allocate(allocator, 2 * count * sizeof(uint32));
+	uint32* tempKeys = keys + count;
+	int32* tempOrder = (int32*)b2Allocate(allocator, count * sizeof(int32));
+	int32* sortOrder = order;
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Vec2 p = b2GetSortPoint(items[i]) - lower;
+		uint32 x = (uint32)(scaleX * p.x);
+		uint32 y = (uint32)(scaleY * p.y);
+		keys[i] = b2SpreadBits(x) | (b2SpreadBits(y) << 1);
+		order[i] = i;
+	}
+
+	// Stable radix sort, 8 bits per pass. Equal keys keep the batch order.
+	for (int32 shift = 0; shift < 32; shift += 8)
+	{
+		int32 offsets[256];
+		memset(offsets, 0, sizeof(offsets));
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			++offsets[(keys[i] >> shift) & 0xFF];
+		}
+
+		int32 sum = 0;
+		for (int32 i = 0; i < 256; ++i)
+		{
+			int32 n = offsets[i];
+			offsets[i] = sum;
+			sum += n;
+		}
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			int32 j = offsets[(keys[i] >> shift) & 0xFF]++;
+			tempKeys[j] = keys[i];
+			tempOrder[j] = sortOrder[i];
+		}
+
+		b2Swap(keys, tempKeys);
+		b2Swap(sortOrder, tempOrder);
+	}
+
+	// After an even number of passes the result is back in order.
+	b2Assert(sortOrder == order);
+	b2Deallocate(allocator, keys, 2 * count * sizeof(uint32));
+	b2Deallocate(allocator, tempOrder, count * sizeof(int32));
+}
+
+struct b2RayBatch
+{
+	const b2BroadPhase* broadPhase;
+	const b2RayCastInput* rays;
+	const int32* order;
+	int32 count;
+
+	// Zero keeps only the closest hit of each ray.
+	int32 maxHits;
+	b2RayCastHit* hits;
+	int32* hitCounts;
+	uint16 maskBits;
+};
+
+struct b2RayPacketWrapper
+{
+	float RayCastCallback(const b2RayCastInput& input, int32 proxyId, int32 rayIndex)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)batch->broadPhase->GetUserData(proxyId);
+		b2Fixture* fixture = proxy->fixture;
+		if ((fixture->GetFilterData().categoryBits & batch->maskBits) == 0)
+		{
+			return -1.0f;
+		}
+
+		b2RayCastOutput output;
+		bool hit = fixture->RayCast(&output, input, proxy->childIndex);
+		if (hit == false)
+		{
+			return input.maxFraction;
+		}
+
+		float fraction = output.fraction;
+
+		b2RayCastHit result;
+		result.fixture = fixture;
+		result.point = (1.0f - fraction) * input.p1 + fraction * input.p2;
+		result.normal = output.normal;
+		result.fraction = fraction;
+
+		int32 index = rayIndices[rayIndex];
+		if (batch->maxHits == 0)
+		{
+			batch->hits[index] = result;
+			return fraction;
+		}
+
+		// Insert into the hits sorted by fraction, dropping the farthest once full.
+		b2RayCastHit* hits = batch->hits + index * batch->maxHits;
+		int32 count = batch->hitCounts[index];
+		if (count == batch->maxHits)
+		{
+			if (fraction >= hits[count - 1].fraction)
+			{
+				return input.maxFraction;
+			}
+
+			--count;
+		}
+
+		int32 i = count;
+		while (i > 0 && hits[i - 1].fraction > fraction)
+		{
+			hits[i] = hits[i - 1];
+			--i;
+		}
+		hits[i] = result;
+		++count;
+
+		batch->hitCounts[index] = count;
+
+		// A full list clips the ray to its farthest hit.
+		return count == batch->maxHits ? hits[count - 1].fraction : input.maxFraction;
+	}
+
+	const b2RayBatch* batch;
+	int32 rayIndices[b2_rayPacketSize];
+};
+
+static void b2RayCastPackets(int32 begin, int32 end, int32 workerIndex, void* context)
+{
+	B2_NOT_USED(workerIndex);
+
+	const b2RayBatch* batch = (const b2RayBatch*)context;
+
+	b2RayPacketWrapper wrapper;
+	wrapper.batch = batch;
+
+	b2RayCastInput inputs[b2_rayPacketSize];
+
+	for (int32 packet = begin; packet < end; ++packet)
+	{
+		int32 first = packet * b2_rayPacketSize;
+		int32 count = b2Min(b2_rayPacketSize, batch->count - first);
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			int32 index = batch->order[first + i];
+			const b2RayCastInput& ray = batch->rays[index];
+			wrapper.rayIndices[i] = index;
+			inputs[i] = ray;
+
+			if (batch->maxHits == 0)
+			{
+				// Without a hit the point is the end of the ray.
+				b2RayCastHit* hit = batch->hits + index;
+				hit->fixture = nullptr;
+				hit->point = ray.p1 + ray.maxFraction * (ray.p2 - ray.p1);
+				hit->normal.SetZero();
+				hit->fraction = ray.maxFraction;
+			}
+			else
+			{
+				batch->hitCounts[index] = 0;
+			}
+		}
+
+		batch->broadPhase->RayCastPacket(&wrapper, inputs, count);
+	}
+}
+
+static void b2RayCastBatch(b2Allocator* allocator, b2ThreadPool* threadPool, b2RayBatch* batch)
+{
+	int32* order = (int32*)b2Allocate(allocator, batch->count * sizeof(int32));
+	b2SortByPosition(allocator, batch->rays, batch->count, order);
+	batch->order = order;
+
+	int32 packetCount = (batch->count + b2_rayPacketSize - 1) / b2_rayPacketSize;
+	if (threadPool && packetCount > 1)
+	{
+		threadPool->ParallelFor(packetCount, 8, b2RayCastPackets, batch);
+	}
+	else
+	{
+		b2RayCastPackets(0, packetCount, 0, batch);
+	}
+
+	b2Deallocate(allocator, order, batch->count * sizeof(int32));
+}
+
+void b2World::RayCastClosest(const b2RayCastInput* rays, int32 count, b2RayCastHit* hits, uint16 maskBits) const
+{
+	b2Assert(IsLocked() == false);
+	if (count <= 0)
+	{
+		return;
+	}
+
+	b2RayBatch batch;
+	batch.broadPhase = &m_contactManager.m_broadPhase;
+	batch.rays = rays;
+	batch.order = nullptr;
+	batch.count = count;
+	batch.maxHits = 0;
+	batch.hits = hits;
+	batch.hitCounts = nullptr;
+	batch.maskBits = maskBits;
+	b2RayCastBatch(m_allocator, m_threadPool, &batch);
+}
+
+void b2World::RayCastAll(const b2RayCastInput* rays, int32 count, int32 maxHits,
+						 b2RayCastHit* hits, int32* hitCounts, uint16 maskBits) const
+{
+	b2Assert(IsLocked() == false);
+	b2Assert(maxHits > 0);
+	if (count <= 0 || maxHits <= 0)
+	{
+		return;
+	}
+
+	b2RayBatch batch;
+	batch.broadPhase = &m_contactManager.m_broadPhase;
+	batch.rays = rays;
+	batch.order = nullptr;
+	batch.count = count;
+	batch.maxHits = maxHits;
+	batch.hits = hits;
+	batch.hitCounts = hitCounts;
+	batch.maskBits = maskBits;
+	b2RayCastBatch(m_allocator, m_threadPool, &batch);
+}
+
+struct b2QueryBatch
+{
+	const b2BroadPhase* broadPhase;
+	const b2AABB* aabbs;
+	const int32* order;
+	int32 maxFixtures;
+	b2Fixture** fixtures;
+	int32* fixtureCounts;
+	uint16 maskBits;
+};
+
+struct b2QueryBatchWrapper
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)batch->broadPhase->GetUserData(proxyId);
+		if ((proxy->fixture->GetFilterData().categoryBits & batch->maskBits) == 0)
+		{
+			return true;
+		}
+
+		fixtures[count++] = proxy->fixture;
+		return count < batch->maxFixtures;
+	}
+
+	const b2QueryBatch* batch;
+	b2Fixture** fixtures;
+	int32 count;
+};
+
+static void b2QueryAABBRange(int32 begin, int32 end, int32 workerIndex, void* context)
+{
+	B2_NOT_USED(workerIndex);
+
+	const b2QueryBatch* batch = (const b2QueryBatch*)context;
+
+	b2QueryBatchWrapper wrapper;
+	wrapper.batch = batch;
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		int32 index = batch->order[i];
+		wrapper.fixtures = batch->fixtures + index * batch->maxFixtures;
+		wrapper.count = 0;
+		batch->broadPhase->Query(&wrapper, batch->aabbs[index]);
+		batch->fixtureCounts[index] = wrapper.count;
+	}
+}
+
+void b2World::QueryAABBs(const b2AABB* aabbs, int32 count, int32 maxFixtures,
+						 b2Fixture** fixtures, int32* fixtureCounts, uint16 maskBits) const
+{
+	b2Assert(IsLocked() == false);
+	b2Assert(maxFixtures > 0);
+	if (count <= 0 || maxFixtures <= 0)
+	{
+		return;
+	}
+
+	int32* order = (int32*)b2Allocate(m_allocator, count * sizeof(int32));
+	b2SortByPosition(m_allocator, aabbs, count, order);
+
+	b2QueryBatch batch;
+	batch.broadPhase = &m_contactManager.m_broadPhase;
+	batch.aabbs = aabbs;
+	batch.order = order;
+	batch.maxFixtures = maxFixtures;
+	batch.fixtures = fixtures;
+	batch.fixtureCounts = fixtureCounts;
+	batch.maskBits = maskBits;
+
+	if (m_threadPool && count > 64)
+	{
+		m_threadPool->ParallelFor(count, 64, b2QueryAABBRange, &batch);
+	}
+	else
+	{
+		b2QueryAABBRange(0, count, 0, &batch);
+	}
+
+	b2Deallocate(m_allocator, order, count * sizeof(int32));
+}
@@ -0,0 +1,600 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "common/b2_snapshot.h"
+
+#include "box2d/b2_body.h"
+#include "box2d/b2_broad_phase.h"
+#include "box2d/b2_contact.h"
+#include "box2d/b2_distance_joint.h"
+#include "box2d/b2_fixture.h"
+#include "box2d/b2_friction_joint.h"
+#include "box2d/b2_gear_joint.h"
+#include "box2d/b2_motor_joint.h"
+#include "box2d/b2_mouse_joint.h"
+#include "box2d/b2_prismatic_joint.h"
+#include "box2d/b2_pulley_joint.h"
+#include "box2d/b2_revolute_joint.h"
+#include "box2d/b2_weld_joint.h"
+#include "box2d/b2_wheel_joint.h"
+#include "box2d/b2_world.h"
+
+#include <new>
+
+// A snapshot is a flat sequence of values in the native layout:
+//
+// header
+// world settings and step state
+// bodies in list order, each followed by its fixtures in list order
+// broad-phase move buffer and tree node pool
+// joints in creation order, so gear joints come after their joints
+// contacts in list order
+// persistent islands
+//
+// Bodies and joints are referred to by their position in the snapshot, fixtures by the body
+// and their position in its fixture list. The contact and joint lists of each body are not
+// stored. Contacts and joints are added to both bodies when they are added to the world, so
+// the body lists keep the order of the world lists and can be rebuilt from them.
+
+#define b2_snapshotMagic 0x6e733262 // "b2sn"
+#define b2_snapshotVersion 2
+
+// The sizes catch snapshots from a build with other settings or user data types.
+struct b2SnapshotHeader
+{
+	int32 magic;
+	int32 version;
+	int32 treeNodeSize;
+	int32 manifoldSize;
+	int32 bodyUserDataSize;
+	int32 fixtureUserDataSize;
+	int32 jointUserDataSize;
+};
+
+static b2SnapshotHeader b2MakeSnapshotHeader()
+{
+	b2SnapshotHeader header;
+	header.magic = b2_snapshotMagic;
+	header.version = b2_snapshotVersion;
+	header.treeNodeSize = sizeof(b2TreeNode);
+	header.manifoldSize = sizeof(b2Manifold);
+	header.bodyUserDataSize = sizeof(b2BodyUserData);
+	header.fixtureUserDataSize = sizeof(b2FixtureUserData);
+	header.jointUserDataSize = sizeof(b2JointUserData);
+	return header;
+}
+
+static int32 b2GetFixtureIndex(const b2Fixture* fixture)
+{
+	int32 index = 0;
+	for (const b2Fixture* f = fixture->GetBody()->GetFixtureList(); f != fixture; f = f->GetNext())
+	{
+		++index;
+	}
+	return index;
+}
+
+static b2Fixture* b2GetFixture(b2Body* body, int32 index)
+{
+	b2Fixture* f = body->GetFixtureList();
+	for (int32 i = 0; i < index && f; ++i)
+	{
+		f = f->GetNext();
+	}
+	return f;
+}
+
+int32 b2World::SaveSnapshot(void* buffer, int32 capacity)
+{
+	b2Assert(m_locked == false);
+	if (m_locked)
+	{
+		return 0;
+	}
+
+	b2Snapshot snapshot(buffer, capacity);
+
+	b2SnapshotHeader header = b2MakeSnapshotHeader();
+	snapshot.Value(header);
+
+	Snapshot(&snapshot);
+
+	return snapshot.GetSize();
+}
+
+bool b2World::LoadSnapshot(const void* data, int32 size)
+{
+	b2Assert(m_locked == false);
+	if (m_locked)
+	{
+		return false;
+	}
+
+	b2Snapshot snapshot(data, size);
+
+	b2SnapshotHeader header;
+	snapshot.Value(header);
+
+	b2SnapshotHeader expected = b2MakeSnapshotHeader();
+	if (snapshot.IsValid() == false || memcmp(&header, &expected, sizeof(b2SnapshotHeader)) != 0)
+	{
+		return false;
+	}
+
+	Clear();
+	Snapshot(&snapshot);
+
+	if (snapshot.IsValid() == false)
+	{
+		Clear();
+		return false;
+	}
+
+	return true;
+}
+
+void b2World::Clear()
+{
+	b2Contact* c = m_contactManager.m_contactList;
+	while (c)
+	{
+		b2Contact* c0 = c;
+		c = c->m_next;
+		b2Contact::Destroy(c0, &m_blockAllocator);
+	}
+	m_contactManager.m_contactList = nullptr;
+	m_contactManager.m_contactCount = 0;
+
+	b2Joint* j = m_jointList;
+	while (j)
+	{
+		b2Joint* j0 = j;
+		j = j->m_next;
+		b2Joint::Destroy(j0, &m_blockAllocator);
+	}
+	m_jointList = nullptr;
+	m_jointCount = 0;
+
+	b2Body* b = m_bodyList;
+	while (b)
+	{
+		b2Body* b0 = b;
+		b = b->m_next;
+
+		b2Fixture* f = b0->m_fixtureList;
+		while (f)
+		{
+			b2Fixture* f0 = f;
+			f = f->m_next;
+
+			// The whole broad-phase is reset below.
+			f0->m_proxyCount = 0;
+			f0->Destroy(&m_blockAllocator);
+			f0->~b2Fixture();
+			m_blockAllocator.Free(f0, sizeof(b2Fixture));
+		}
+
+		b0->~b2Body();
+		m_blockAllocator.Free(b0, sizeof(b2Body));
+	}
+	m_bodyList = nullptr;
+	m_bodyCount = 0;
+	m_bodyCreationCount = 0;
+
+	ClearIslands();
+
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	broadPhase->~b2BroadPhase();
+	new (broadPhase) b2BroadPhase(m_allocator);
+	broadPhase->SetThreadPool(m_threadPool);
+}
+
+void b2World::Snapshot(b2Snapshot* snapshot)
+{
+	const bool loading = snapshot->IsLoading();
+
+	snapshot->Value(m_gravity);
+	snapshot->Value(m_allowSleep);
+	snapshot->Value(m_warmStarting);
+	snapshot->Value(m_continuousPhysics);
+	snapshot->Value(m_subStepping);
+	snapshot->Value(m_clearForces);
+	snapshot->Value(m_newContacts);
+	snapshot->Value(m_stepComplete);
+	snapshot->Value(m_inv_dt0);
+
+	// Bodies and fixtures
+	int32 bodyCount = m_bodyCount;
+	snapshot->Count(bodyCount, sizeof(b2Transform));
+
+	b2Body** bodies = nullptr;
+	if (loading)
+	{
+		bodies = (b2Body**)b2Alloc(b2Max(bodyCount, 1) * sizeof(b2Body*));
+	}
+
+	b2Body* body = m_bodyList;
+	for (int32 i = 0; i < bodyCount && snapshot->IsValid(); ++i)
+	{
+		if (loading)
+		{
+			b2BodyDef bodyDef;
+			void* mem = m_blockAllocator.Allocate(sizeof(b2Body));
+			b2Body* b = new (mem) b2Body(&bodyDef, this);
+
+			// Append to keep the saved order.
+			b->m_prev = body;
+			if (body)
+			{
+				body->m_next = b;
+			}
+			else
+			{
+				m_bodyList = b;
+			}
+			++m_bodyCount;
+
+			body = b;
+			bodies[i] = b;
+		}
+
+		body->m_islandIndex = i;
+		body->Snapshot(snapshot);
+
+		int32 fixtureCount = body->m_fixtureCount;
+		snapshot->Count(fixtureCount, sizeof(b2Filter));
+
+		b2Fixture* fixture = loading ? nullptr : body->m_fixtureList;
+		for (int32 k = 0; k < fixtureCount && snapshot->IsValid(); ++k)
+		{
+			if (loading)
+			{
+				void* mem = m_blockAllocator.Allocate(sizeof(b2Fixture));
+				b2Fixture* f = new (mem) b2Fixture;
+				f->m_body = body;
+				f->Snapshot(snapshot, &m_blockAllocator);
+
+				if (f->m_shape == nullptr)
+				{
+					f->~b2Fixture();
+					m_blockAllocator.Free(f, sizeof(b2Fixture));
+					break;
+				}
+
+				if (fixture)
+				{
+					fixture->m_next = f;
+				}
+				else
+				{
+					body->m_fixtureList = f;
+				}
+				++body->m_fixtureCount;
+
+				fixture = f;
+			}
+			else
+			{
+				fixture->Snapshot(snapshot, &m_blockAllocator);
+				fixture = fixture->m_next;
+			}
+		}
+
+		if (loading == false)
+		{
+			body = body->m_next;
+		}
+	}
+
+	if (loading)
+	{
+		// The body list is newest first, the creation order only has to be kept relative.
+		int32 index = m_bodyCount;
+		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		{
+			b->m_creationIndex = --index;
+		}
+	}
+
+	// The tree is restored node for node, so no fixture has to be inserted again.
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	broadPhase->Snapshot(snapshot);
+
+	if (loading && snapshot->IsValid())
+	{
+		int32 proxyCount = 0;
+		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		{
+			for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+			{
+				for (int32 i = 0; i < f->m_proxyCount; ++i)
+				{
+					b2FixtureProxy* proxy = f->m_proxies + i;
+					if (broadPhase->RestoreUserData(proxy->proxyId, proxy) == false)
+					{
+						snapshot->SetInvalid();
+					}
+				}
+
+				proxyCount += f->m_proxyCount;
+			}
+		}
+
+		if (proxyCount != broadPhase->GetProxyCount())
+		{
+			snapshot->SetInvalid();
+		}
+	}
+
+	// Joints
+	int32 jointCount = m_jointCount;
+	snapshot->Count(jointCount, 3 * sizeof(int32));
+
+	b2Joint** joints = nullptr;
+	if (loading)
+	{
+		joints = (b2Joint**)b2Alloc(b2Max(jointCount, 1) * sizeof(b2Joint*));
+	}
+
+	// The list is newest first, save from the tail.
+	b2Joint* joint = m_jointList;
+	while (joint && joint->m_next)
+	{
+		joint = joint->m_next;
+	}
+
+	b2DistanceJointDef distanceDef;
+	b2FrictionJointDef frictionDef;
+	b2GearJointDef gearDef;
+	b2MotorJointDef motorDef;
+	b2MouseJointDef mouseDef;
+	b2PrismaticJointDef prismaticDef;
+	b2PulleyJointDef pulleyDef;
+	b2RevoluteJointDef revoluteDef;
+	b2WeldJointDef weldDef;
+	b2WheelJointDef wheelDef;
+
+	for (int32 i = 0; i < jointCount && snapshot->IsValid(); ++i)
+	{
+		b2JointType type = e_unknownJoint;
+		int32 indexA = 0;
+		int32 indexB = 0;
+		int32 index1 = 0;
+		int32 index2 = 0;
+
+		if (loading == false)
+		{
+			type = joint->m_type;
+			indexA = joint->m_bodyA->m_islandIndex;
+			indexB = joint->m_bodyB->m_islandIndex;
+		}
+
+		snapshot->Value(type);
+		snapshot->Value(indexA);
+		snapshot->Value(indexB);
+
+		if (type == e_gearJoint)
+		{
+			if (loading == false)
+			{
+				b2GearJoint* gear = (b2GearJoint*)joint;
+				index1 = gear->GetJoint1()->m_index;
+				index2 = gear->GetJoint2()->m_index;
+			}
+
+			snapshot->Value(index1);
+			snapshot->Value(index2);
+		}
+
+		if (loading)
+		{
+			if (indexA < 0 || indexA >= bodyCount || indexB < 0 || indexB >= bodyCount || indexA == indexB)
+			{
+				snapshot->SetInvalid();
+				break;
+			}
+
+			// Joints are created with default parameters, which Snapshot then overwrites.
+			b2JointDef* def = nullptr;
+			switch (type)
+			{
+			case e_distanceJoint: def = &distanceDef; break;
+			case e_frictionJoint: def = &frictionDef; break;
+			case e_motorJoint: def = &motorDef; break;
+			case e_mouseJoint: def = &mouseDef; break;
+			case e_prismaticJoint: def = &prismaticDef; break;
+			case e_pulleyJoint: def = &pulleyDef; break;
+			case e_revoluteJoint: def = &revoluteDef; break;
+			case e_weldJoint: def = &weldDef; break;
+			case e_wheelJoint: def = &wheelDef; break;
+
+			case e_gearJoint:
+				if (0 <= index1 && index1 < i && 0 <= index2 && index2 < i)
+				{
+					gearDef.joint1 = joints[index1];
+					gearDef.joint2 = joints[index2];
+
+					b2JointType type1 = gearDef.joint1->m_type;
+					b2JointType type2 = gearDef.joint2->m_type;
+					if ((type1 == e_revoluteJoint || type1 == e_prismaticJoint) &&
+						(type2 == e_revoluteJoint || type2 == e_prismaticJoint))
+					{
+						def = &gearDef;
+					}
+				}
+				break;
+
+			default:
+				break;
+			}
+
+			if (def == nullptr)
+			{
+				snapshot->SetInvalid();
+				break;
+			}
+
+			def->bodyA = bodies[indexA];
+			def->bodyB = bodies[indexB];
+
+			joint = CreateJoint(def);
+			joints[i] = joint;
+		}
+
+		joint->m_index = i;
+		snapshot->Value(joint->m_collideConnected);
+		snapshot->Value(joint->m_userData);
+		joint->Snapshot(snapshot);
+
+		if (loading == false)
+		{
+			joint = joint->m_prev;
+		}
+	}
+
+	// Contacts
+	int32 contactCount = m_contactManager.m_contactCount;
+	snapshot->Count(contactCount, sizeof(b2Manifold));
+
+	b2Contact** contacts = nullptr;
+	if (loading)
+	{
+		contacts = (b2Contact**)b2Alloc(b2Max(contactCount, 1) * sizeof(b2Contact*));
+	}
+
+	b2Contact* contact = m_contactManager.m_contactList;
+	int32 loadedCount = 0;
+	for (int32 i = 0; i < contactCount && snapshot->IsValid(); ++i)
+	{
+		int32 indexA = 0, fixtureIndexA = 0, childIndexA = 0;
+		int32 indexB = 0, fixtureIndexB = 0, childIndexB = 0;
+
+		if (loading == false)
+		{
+			indexA = contact->m_fixtureA->m_body->m_islandIndex;
+			fixtureIndexA = b2GetFixtureIndex(contact->m_fixtureA);
+			childIndexA = contact->m_indexA;
+			indexB = contact->m_fixtureB->m_body->m_islandIndex;
+			fixtureIndexB = b2GetFixtureIndex(contact->m_fixtureB);
+			childIndexB = contact->m_indexB;
+		}
+
+		snapshot->Value(indexA);
+		snapshot->Value(fixtureIndexA);
+		snapshot->Value(childIndexA);
+		snapshot->Value(indexB);
+		snapshot->Value(fixtureIndexB);
+		snapshot->Value(childIndexB);
+
+		if (loading)
+		{
+			if (indexA < 0 || indexA >= bodyCount || indexB < 0 || indexB >= bodyCount || indexA == indexB)
+			{
+				snapshot->SetInvalid();
+				break;
+			}
+
+			b2Fixture* fixtureA = b2GetFixture(bodies[indexA], fixtureIndexA);
+			b2Fixture* fixtureB = b2GetFixture(bodies[indexB], fixtureIndexB);
+			if (fixtureA == nullptr || fixtureB == nullptr ||
+				childIndexA < 0 || childIndexA >= fixtureA->m_shape->GetChildCount() ||
+				childIndexB < 0 || childIndexB >= fixtureB->m_shape->GetChildCount())
+			{
+				snapshot->SetInvalid();
+				break;
+			}
+
+			// The fixtures were saved in the order the factory puts them, so they are not swapped.
+			contact = b2Contact::Create(fixtureA, childIndexA, fixtureB, childIndexB, &m_blockAllocator);
+			if (contact == nullptr)
+			{
+				snapshot->SetInvalid();
+				break;
+			}
+
+			contacts[loadedCount++] = contact;
+
+			if (contact->m_fixtureA != fixtureA)
+			{
+				snapshot->SetInvalid();
+				break;
+			}
+		}
+
+		contact->Snapshot(snapshot);
+
+		if (loading == false)
+		{
+			contact = contact->m_next;
+		}
+	}
+
+	if (loading)
+	{
+		// Link the contacts like b2ContactManager::AddPair, oldest first.
+		for (int32 i = loadedCount - 1; i >= 0; --i)
+		{
+			b2Contact* c = contacts[i];
+			b2Body* bodyA = c->m_fixtureA->m_body;
+			b2Body* bodyB = c->m_fixtureB->m_body;
+
+			c->m_prev = nullptr;
+			c->m_next = m_contactManager.m_contactList;
+			if (m_contactManager.m_contactList != nullptr)
+			{
+				m_contactManager.m_contactList->m_prev = c;
+			}
+			m_contactManager.m_contactList = c;
+
+			c->m_nodeA.contact = c;
+			c->m_nodeA.other = bodyB;
+			c->m_nodeA.prev = nullptr;
+			c->m_nodeA.next = bodyA->m_contactList;
+			if (bodyA->m_contactList != nullptr)
+			{
+				bodyA->m_contactList->prev = &c->m_nodeA;
+			}
+			bodyA->m_contactList = &c->m_nodeA;
+
+			c->m_nodeB.contact = c;
+			c->m_nodeB.other = bodyA;
+			c->m_nodeB.prev = nullptr;
+			c->m_nodeB.next = bodyB->m_contactList;
+			if (bodyB->m_contactList != nullptr)
+			{
+				bodyB->m_contactList->prev = &c->m_nodeB;
+			}
+			bodyB->m_contactList = &c->m_nodeB;
+
+			++m_contactManager.m_contactCount;
+		}
+	}
+
+	SnapshotIslands(snapshot, bodies);
+
+	if (loading)
+	{
+		b2Free(contacts);
+		b2Free(joints);
+		b2Free(bodies);
+	}
+}
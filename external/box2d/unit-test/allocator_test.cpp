@@ -0,0 +1,165 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/box2d.h"
+#include "doctest.h"
+
+// A pyramid of boxes, circles and a chain of links hanging from the ground.
+static void CreateAllocatorScene(b2World* world)
+{
+	b2BodyDef groundDef;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	for (int32 row = 0; row < 10; ++row)
+	{
+		for (int32 i = 0; i < 10 - row; ++i)
+		{
+			bodyDef.position.Set(-10.0f + 1.0f * i + 0.5f * row, 0.5f + 1.0f * row);
+			world->CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+		}
+	}
+
+	for (int32 i = 0; i < 20; ++i)
+	{
+		bodyDef.position.Set(5.0f + 0.3f * (i % 4), 1.0f + 1.1f * i);
+		world->CreateBody(&bodyDef)->CreateFixture(&circle, 1.0f);
+	}
+
+	b2PolygonShape link;
+	link.SetAsBox(0.5f, 0.1f);
+
+	b2Body* previous = ground;
+	for (int32 i = 0; i < 10; ++i)
+	{
+		bodyDef.position.Set(-20.0f + 1.0f * i + 0.5f, 15.0f);
+		b2Body* body = world->CreateBody(&bodyDef);
+		body->CreateFixture(&link, 1.0f);
+
+		b2RevoluteJointDef jointDef;
+		jointDef.Initialize(previous, body, b2Vec2(-20.0f + 1.0f * i, 15.0f));
+		world->CreateJoint(&jointDef);
+		previous = body;
+	}
+}
+
+DOCTEST_TEST_CASE("allocator backends")
+{
+	b2World reference({ 0.0f, -10.0f });
+	CreateAllocatorScene(&reference);
+
+	b2ArenaAllocator arena(16 * 1024 * 1024);
+	b2World world({ 0.0f, -10.0f }, &arena);
+	world.SetThreadCount(2);
+	world.SetStackSize(1024);
+	CreateAllocatorScene(&world);
+
+	for (int32 i = 0; i < 30; ++i)
+	{
+		reference.Step(1.0f / 60.0f, 8, 3);
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	// The memory comes from the arena and the results don't change.
+	bool same = true;
+	for (b2Body *a = world.GetBodyList(), *b = reference.GetBodyList(); a && b; a = a->GetNext(), b = b->GetNext())
+	{
+		same = same && a->GetPosition() == b->GetPosition() && a->GetAngle() == b->GetAngle();
+	}
+	CHECK(same);
+	CHECK(arena.GetUsed() > 0);
+	CHECK(arena.GetOverflowCount() == 0);
+
+	b2AllocatorStats stats = world.GetAllocatorStats();
+	CHECK(stats.chunkCount > 0);
+	CHECK(stats.chunkBytes >= stats.blockBytes);
+	CHECK(stats.peakBlockBytes >= stats.blockBytes);
+	CHECK(stats.blockBytes > 0);
+	CHECK(stats.fragmentation >= 0.0f);
+	CHECK(stats.fragmentation < 1.0f);
+	CHECK(stats.stackSize == 1024);
+	CHECK(stats.peakStackBytes > 1024);
+	CHECK(stats.stackOverflowCount > 0);
+	CHECK(stats.bufferBytes > 0);
+
+	// The chunks and the kept buffers all come from the arena.
+	CHECK(arena.GetUsed() - arena.GetFreeBytes() >= stats.chunkBytes + stats.bufferBytes);
+
+	// Stacks of the peak size don't overflow.
+	world.SetStackSize(2 * stats.peakStackBytes);
+	for (int32 i = 0; i < 30; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	b2AllocatorStats resized = world.GetAllocatorStats();
+	CHECK(resized.stackSize == 2 * stats.peakStackBytes);
+	CHECK(resized.stackOverflowCount == stats.stackOverflowCount);
+}
+
+DOCTEST_TEST_CASE("arena free lists")
+{
+	b2ArenaAllocator arena(4096);
+
+	void* a = arena.Allocate(100);
+	void* b = arena.Allocate(1000);
+	void* c = arena.Allocate(64);
+	int32 used = arena.GetUsed();
+
+	// Memory freed out of order is reused, a larger block is split.
+	arena.Free(a, 100);
+	arena.Free(b, 1000);
+	CHECK(arena.GetFreeBytes() == 112 + 1008);
+
+	CHECK(arena.Allocate(90) == a);
+	void* d = arena.Allocate(500);
+	CHECK(d == b);
+	void* e = arena.Allocate(400);
+	CHECK((char*)e == (char*)b + 512);
+	CHECK(arena.GetUsed() == used);
+	CHECK(arena.GetFreeBytes() == 16 + 96);
+
+	// Freeing the most recent allocation gives the memory back to the arena.
+	arena.Free(c, 64);
+	CHECK(arena.GetUsed() == used - 64);
+
+	// A full arena overflows to b2Alloc.
+	void* big = arena.Allocate(8192);
+	CHECK(arena.GetOverflowCount() == 1);
+	arena.Free(big, 8192);
+
+	arena.Free(e, 400);
+	arena.Free(d, 500);
+	arena.Free(a, 90);
+}
@@ -22,7 +22,9 @@
 
 #include "box2d/box2d.h"
 #include "doctest.h"
+#include <algorithm>
 #include <stdio.h>
+#include <vector>
 
 // Unit tests for collision algorithms
 DOCTEST_TEST_CASE("collision test")
@@ -79,3 +81,144 @@ DOCTEST_TEST_CASE("collision test")
 		CHECK(b2Abs(massData2.I - inertia) < 40.0f * (absTol + relTol * inertia));
 	}
 }
+
+// Collects the proxies overlapping an AABB.
+class TreeQueryCallback
+{
+public:
+	bool QueryCallback(int32 proxyId)
+	{
+		proxyIds.push_back(proxyId);
+		return true;
+	}
+
+	std::vector<int32> proxyIds;
+};
+
+// True if the tree finds exactly the proxies whose fat AABB overlaps each query box.
+static bool CheckTreeQueries(const b2DynamicTree& tree, const int32* proxyIds, int32 count)
+{
+	for (int32 q = 0; q < 50; ++q)
+	{
+		b2AABB box;
+		box.lowerBound.Set(-50.0f + 2.0f * q, -10.0f + 0.4f * q);
+		box.upperBound = box.lowerBound + b2Vec2(6.0f, 6.0f);
+
+		TreeQueryCallback callback;
+		tree.Query(&callback, box);
+		std::sort(callback.proxyIds.begin(), callback.proxyIds.end());
+
+		std::vector<int32> expected;
+		for (int32 i = 0; i < count; ++i)
+		{
+			if (b2TestOverlap(tree.GetFatAABB(proxyIds[i]), box))
+			{
+				expected.push_back(proxyIds[i]);
+			}
+		}
+		std::sort(expected.begin(), expected.end());
+
+		if (callback.proxyIds != expected)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+DOCTEST_TEST_CASE("dynamic tree build")
+{
+	const int32 count = 2000;
+	b2AABB aabbs[count];
+	void* userData[count];
+
+	// Scattered boxes of different sizes from a fixed sequence.
+	uint32 seed = 12345;
+	for (int32 i = 0; i < count; ++i)
+	{
+		seed = 1664525u * seed + 1013904223u;
+		float x = -50.0f + 100.0f * float(seed >> 8) / float(1 << 24);
+		seed = 1664525u * seed + 1013904223u;
+		float y = -50.0f + 100.0f * float(seed >> 8) / float(1 << 24);
+		float h = 0.25f + 0.25f * (i % 4);
+
+		aabbs[i].lowerBound.Set(x - h, y - h);
+		aabbs[i].upperBound.Set(x + h, y + h);
+		userData[i] = (void*)(uintptr_t)(i + 1);
+	}
+
+	SUBCASE("rebuild top down")
+	{
+		b2DynamicTree tree;
+		int32 proxyIds[count];
+		for (int32 i = 0; i < count; ++i)
+		{
+			proxyIds[i] = tree.CreateProxy(aabbs[i], userData[i]);
+		}
+
+		float insertedRatio = tree.GetAreaRatio();
+		tree.RebuildTopDown();
+
+		CHECK(tree.GetAreaRatio() < insertedRatio);
+		CHECK(tree.GetHeight() < 30);
+		CHECK(CheckTreeQueries(tree, proxyIds, count));
+
+		bool sameUserData = true;
+		for (int32 i = 0; i < count; ++i)
+		{
+			sameUserData = sameUserData && tree.GetUserData(proxyIds[i]) == userData[i];
+		}
+		CHECK(sameUserData);
+	}
+
+	SUBCASE("bulk create")
+	{
+		b2DynamicTree tree;
+		int32 proxyIds[count];
+		tree.CreateProxies(aabbs, userData, count / 2, proxyIds);
+		tree.CreateProxies(aabbs + count / 2, userData + count / 2, count - count / 2, proxyIds + count / 2);
+
+		CHECK(CheckTreeQueries(tree, proxyIds, count));
+		CHECK(tree.GetUserData(proxyIds[count - 1]) == userData[count - 1]);
+
+		// Removing and adding single proxies still works on a bulk built tree.
+		for (int32 i = 0; i < count; i += 2)
+		{
+			tree.DestroyProxy(proxyIds[i]);
+			proxyIds[i] = tree.CreateProxy(aabbs[i], userData[i]);
+		}
+
+		CHECK(CheckTreeQueries(tree, proxyIds, count));
+	}
+
+	SUBCASE("refit")
+	{
+		b2DynamicTree tree;
+		int32 proxyIds[count];
+		tree.CreateProxies(aabbs, userData, count, proxyIds);
+
+		// Move every other proxy far enough to leave its fat AABB.
+		int32 refitCount = 0;
+		for (int32 i = 0; i < count; i += 2)
+		{
+			b2Vec2 d(0.5f, -0.25f);
+			b2AABB moved;
+			moved.lowerBound = aabbs[i].lowerBound + d;
+			moved.upperBound = aabbs[i].upperBound + d;
+
+			if (tree.RefitProxy(proxyIds[i], moved, d))
+			{
+				++refitCount;
+			}
+		}
+
+		CHECK(refitCount == count / 2);
+		CHECK(CheckTreeQueries(tree, proxyIds, count));
+
+		float refitRatio = tree.GetAreaRatio();
+		tree.RebuildTopDown();
+		CHECK(tree.GetAreaRatio() < refitRatio);
+		CHECK(CheckTreeQueries(tree, proxyIds, count));
+	}
+}
@@ -0,0 +1,119 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/box2d.h"
+#include "doctest.h"
+#include <stdio.h>
+#include <string>
+
+// Writes the recorded trace and reads it back.
+static std::string WriteTrace()
+{
+	const char* fileName = "trace_test.json";
+	CHECK(b2WriteTrace(fileName));
+
+	std::string text;
+	FILE* file = fopen(fileName, "r");
+	REQUIRE(file != nullptr);
+	char buffer[256];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		text.append(buffer, n);
+	}
+	fclose(file);
+	remove(fileName);
+
+	return text;
+}
+
+DOCTEST_TEST_CASE("trace export")
+{
+	// The ring keeps the most recent events.
+	b2StartTrace(3);
+	CHECK(b2IsTracing());
+	{
+		b2TraceScope scope("first");
+	}
+	b2TraceCounter("second", 1.0f);
+	b2SetTraceThreadName("test thread");
+	{
+		b2TraceScope outer("third");
+		b2TraceScope inner("fourth");
+	}
+	b2TraceCounter("fifth", 2.5f);
+	b2StopTrace();
+
+	// Nothing is recorded once stopped.
+	b2TraceCounter("sixth", 3.0f);
+
+	std::string text = WriteTrace();
+	CHECK(text.find("\"traceEvents\"") != std::string::npos);
+	CHECK(text.find("\"test thread\"") != std::string::npos);
+	CHECK(text.find("\"first\"") == std::string::npos);
+	CHECK(text.find("\"second\"") == std::string::npos);
+	CHECK(text.find("\"third\"") != std::string::npos);
+	CHECK(text.find("\"fourth\"") != std::string::npos);
+	CHECK(text.find("\"fifth\", \"ph\": \"C\"") != std::string::npos);
+	CHECK(text.find("\"sixth\"") == std::string::npos);
+	CHECK(text.find(",\n]") == std::string::npos);
+}
+
+#ifdef B2_ENABLE_TRACE
+
+DOCTEST_TEST_CASE("trace step events")
+{
+	b2World world({ 0.0f, -10.0f });
+
+	b2BodyDef groundDef;
+	b2Body* ground = world.CreateBody(&groundDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-20.0f, 0.0f), b2Vec2(20.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < 10; ++i)
+	{
+		bodyDef.position.Set(0.0f, 0.5f + 1.0f * i);
+		world.CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+	}
+
+	b2StartTrace(4096);
+	for (int32 i = 0; i < 10; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+	b2StopTrace();
+
+	std::string text = WriteTrace();
+	CHECK(text.find("\"Step\"") != std::string::npos);
+	CHECK(text.find("\"Collide\"") != std::string::npos);
+	CHECK(text.find("\"Island\"") != std::string::npos);
+	CHECK(text.find("\"Bodies\", \"ph\": \"C\"") != std::string::npos);
+}
+
+#endif
@@ -22,7 +22,10 @@
 
 #include "box2d/box2d.h"
 #include "doctest.h"
+#include <algorithm>
+#include <functional>
 #include <stdio.h>
+#include <vector>
 
 static bool begin_contact = false;
 
@@ -71,3 +74,1132 @@ DOCTEST_TEST_CASE("begin contact")
 	CHECK(world.GetContactList() != nullptr);
 	CHECK(begin_contact == true);
 }
+
+class CountingDraw : public b2Draw
+{
+public:
+	void DrawPolygon(const b2Vec2*, int32, const b2Color&) override { ++polygonCount; }
+	void DrawSolidPolygon(const b2Vec2*, int32, const b2Color&) override { ++solidPolygonCount; }
+	void DrawCircle(const b2Vec2&, float, const b2Color&) override {}
+	void DrawSolidCircle(const b2Vec2&, float, const b2Vec2&, const b2Color&) override { ++solidCircleCount; }
+	void DrawSegment(const b2Vec2&, const b2Vec2&, const b2Color&) override { ++segmentCount; }
+	void DrawTransform(const b2Transform&) override { ++transformCount; }
+	void DrawPoint(const b2Vec2&, float, const b2Color&) override {}
+
+	int32 polygonCount = 0;
+	int32 solidPolygonCount = 0;
+	int32 solidCircleCount = 0;
+	int32 segmentCount = 0;
+	int32 transformCount = 0;
+};
+
+DOCTEST_TEST_CASE("debug draw culling")
+{
+	b2World world({ 0.0f, -10.0f });
+
+	CountingDraw draw;
+	draw.SetFlags(b2Draw::e_shapeBit);
+	world.SetDebugDraw(&draw);
+
+	// A row of 100 boxes and 100 circles spaced 10 meters apart.
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	for (int32 i = 0; i < 100; ++i)
+	{
+		bodyDef.position.Set(10.0f * i, 0.0f);
+		world.CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+
+		bodyDef.position.Set(10.0f * i, 10.0f);
+		world.CreateBody(&bodyDef)->CreateFixture(&circle, 1.0f);
+	}
+
+	// A static chain with 100 edges one meter long.
+	b2Vec2 vertices[101];
+	for (int32 i = 0; i < 101; ++i)
+	{
+		vertices[i].Set(1.0f * i, -20.0f);
+	}
+
+	b2ChainShape chain;
+	chain.CreateChain(vertices, 101, b2Vec2(-1.0f, -20.0f), b2Vec2(101.0f, -20.0f));
+
+	b2BodyDef groundDef;
+	world.CreateBody(&groundDef)->CreateFixture(&chain, 0.0f);
+
+	world.DebugDraw();
+	CHECK(draw.solidPolygonCount == 100);
+	CHECK(draw.solidCircleCount == 100);
+	CHECK(draw.segmentCount == 100);
+
+	// A view around the first three columns and the start of the chain.
+	draw = CountingDraw();
+	draw.SetFlags(b2Draw::e_shapeBit);
+
+	b2AABB view;
+	view.lowerBound.Set(-5.0f, -25.0f);
+	view.upperBound.Set(25.0f, 15.0f);
+	world.DebugDraw(view);
+
+	CHECK(draw.solidPolygonCount == 3);
+	CHECK(draw.solidCircleCount == 3);
+	CHECK(draw.segmentCount > 20);
+	CHECK(draw.segmentCount < 30);
+
+	// Nothing in view.
+	draw = CountingDraw();
+	draw.SetFlags(b2Draw::e_shapeBit);
+
+	view.lowerBound.Set(2000.0f, 2000.0f);
+	view.upperBound.Set(2100.0f, 2100.0f);
+	world.DebugDraw(view);
+
+	CHECK(draw.solidPolygonCount == 0);
+	CHECK(draw.solidCircleCount == 0);
+	CHECK(draw.segmentCount == 0);
+}
+
+DOCTEST_TEST_CASE("debug draw center of mass")
+{
+	b2World world({ 0.0f, -10.0f });
+
+	CountingDraw draw;
+	draw.SetFlags(b2Draw::e_centerOfMassBit);
+	world.SetDebugDraw(&draw);
+
+	// Two boxes 20 meters apart on one body, the first fixture is the one created last.
+	b2BodyDef bodyDef;
+	b2Body* body = world.CreateBody(&bodyDef);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f, b2Vec2(20.0f, 0.0f), 0.0f);
+	body->CreateFixture(&box, 1.0f);
+	box.SetAsBox(0.5f, 0.5f, b2Vec2(0.0f, 0.0f), 0.0f);
+	body->CreateFixture(&box, 1.0f);
+
+	// Only the second fixture in view.
+	b2AABB view;
+	view.lowerBound.Set(15.0f, -5.0f);
+	view.upperBound.Set(25.0f, 5.0f);
+	world.DebugDraw(view);
+	CHECK(draw.transformCount == 1);
+
+	// Both in view, the frame is still drawn once.
+	draw.transformCount = 0;
+	view.lowerBound.Set(-5.0f, -5.0f);
+	world.DebugDraw(view);
+	CHECK(draw.transformCount == 1);
+
+	draw.transformCount = 0;
+	view.lowerBound.Set(100.0f, -5.0f);
+	view.upperBound.Set(110.0f, 5.0f);
+	world.DebugDraw(view);
+	CHECK(draw.transformCount == 0);
+}
+
+class ShiftedDraw : public CountingDraw
+{
+public:
+	b2Transform GetBodyTransform(const b2Body* body) const override
+	{
+		++hookCount;
+		b2Transform xf = body->GetTransform();
+		xf.p.x += 1000.0f;
+		return xf;
+	}
+
+	mutable int32 hookCount = 0;
+};
+
+DOCTEST_TEST_CASE("debug draw transform hook")
+{
+	b2World world({ 0.0f, -10.0f });
+
+	ShiftedDraw draw;
+	draw.SetFlags(b2Draw::e_shapeBit);
+	world.SetDebugDraw(&draw);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	world.CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+
+	// Without the flag the hook is never called.
+	world.DebugDraw();
+	CHECK(draw.hookCount == 0);
+	CHECK(draw.solidPolygonCount == 1);
+
+	draw.SetFlags(b2Draw::e_shapeBit | b2Draw::e_bodyTransformBit);
+	world.DebugDraw();
+	CHECK(draw.hookCount == 1);
+	CHECK(draw.solidPolygonCount == 2);
+}
+
+class PostSolveCounter : public b2ContactListener
+{
+public:
+	void PostSolve(b2Contact*, const b2ContactImpulse* impulse) override
+	{
+		++count;
+		if (impulse->count > 0)
+		{
+			normalImpulse += impulse->normalImpulses[0];
+		}
+	}
+
+	int32 count = 0;
+	float normalImpulse = 0.0f;
+};
+
+// The state of a scene after it was stepped, compared bit for bit across settings.
+struct SceneResult
+{
+	// Body list order, the last body created comes first.
+	std::vector<b2Vec2> positions;
+	std::vector<float> angles;
+	std::vector<b2Vec2> velocities;
+
+	// The user data of the bodies of every contact in list order, after each step.
+	std::vector<int32> contactOrder;
+};
+
+static bool operator==(const SceneResult& a, const SceneResult& b)
+{
+	return a.positions == b.positions && a.angles == b.angles && a.velocities == b.velocities &&
+		a.contactOrder == b.contactOrder;
+}
+
+// Steps the scene made by build in a world with the given thread count. build also sets
+// listeners and world options, beforeStep runs before each step when given.
+static void StepScene(int32 threadCount, const std::function<void(b2World*)>& build, int32 stepCount, SceneResult* out,
+	const std::function<void(b2World*, int32)>& beforeStep = nullptr)
+{
+	b2World world({ 0.0f, -10.0f });
+	world.SetThreadCount(threadCount);
+	build(&world);
+
+	for (int32 i = 0; i < stepCount; ++i)
+	{
+		if (beforeStep)
+		{
+			beforeStep(&world, i);
+		}
+
+		world.Step(1.0f / 60.0f, 8, 3);
+
+		for (b2Contact* c = world.GetContactList(); c; c = c->GetNext())
+		{
+			out->contactOrder.push_back((int32)c->GetFixtureA()->GetBody()->GetUserData().pointer);
+			out->contactOrder.push_back((int32)c->GetFixtureB()->GetBody()->GetUserData().pointer);
+		}
+	}
+
+	for (b2Body* b = world.GetBodyList(); b; b = b->GetNext())
+	{
+		out->positions.push_back(b->GetPosition());
+		out->angles.push_back(b->GetAngle());
+		out->velocities.push_back(b->GetLinearVelocity());
+	}
+}
+
+// Pyramids and pendulums sharing one static ground.
+static void BuildPyramids(b2World* world)
+{
+	b2BodyDef groundDef;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-100.0f, 0.0f), b2Vec2(200.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	for (int32 p = 0; p < 8; ++p)
+	{
+		for (int32 row = 0; row < 6; ++row)
+		{
+			for (int32 i = 0; i < 6 - row; ++i)
+			{
+				bodyDef.position.Set(15.0f * p + 1.1f * i + 0.55f * row, 0.5f + 1.05f * row);
+				world->CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+			}
+		}
+
+		bodyDef.position.Set(15.0f * p + 3.0f, 20.0f);
+		b2Body* bob = world->CreateBody(&bodyDef);
+		bob->CreateFixture(&box, 1.0f);
+
+		b2RevoluteJointDef jointDef;
+		jointDef.Initialize(ground, bob, b2Vec2(15.0f * p, 20.0f));
+		world->CreateJoint(&jointDef);
+	}
+}
+
+DOCTEST_TEST_CASE("parallel island solve")
+{
+	SceneResult result;
+	PostSolveCounter listener;
+	StepScene(1, [&listener](b2World* world) { world->SetContactListener(&listener); BuildPyramids(world); }, 120, &result);
+	CHECK(result.positions.size() == size_t(8 * (21 + 1) + 1));
+
+	int32 threadCounts[] = { 2, 4 };
+	for (int32 threadCount : threadCounts)
+	{
+		SceneResult parallelResult;
+		PostSolveCounter parallelListener;
+		StepScene(threadCount, [&parallelListener](b2World* world) { world->SetContactListener(&parallelListener); BuildPyramids(world); }, 120, &parallelResult);
+
+		CHECK(result == parallelResult);
+		CHECK(listener.count == parallelListener.count);
+		CHECK(listener.normalImpulse == parallelListener.normalImpulse);
+	}
+}
+
+// A pyramid of boxes and a pile of circles on a static ground.
+static void BuildStack(b2World* world)
+{
+	b2BodyDef groundDef;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	for (int32 row = 0; row < 20; ++row)
+	{
+		for (int32 i = 0; i < 20 - row; ++i)
+		{
+			bodyDef.position.Set(-20.0f + 1.0f * i + 0.5f * row, 0.5f + 1.0f * row);
+			world->CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+		}
+	}
+
+	for (int32 row = 0; row < 10; ++row)
+	{
+		for (int32 i = 0; i < 10; ++i)
+		{
+			bodyDef.position.Set(10.0f + 1.0f * i + 0.1f * row, 0.5f + 1.0f * row);
+			world->CreateBody(&bodyDef)->CreateFixture(&circle, 1.0f);
+		}
+	}
+}
+
+static void StepStack(int32 solverWidth, SceneResult* result)
+{
+	StepScene(1, [solverWidth](b2World* world) { world->SetContactSolverWidth(solverWidth); BuildStack(world); }, 120, result);
+}
+
+DOCTEST_TEST_CASE("wide contact solver")
+{
+	b2World world({ 0.0f, -10.0f });
+	world.SetContactSolverWidth(0);
+	int32 maxWidth = world.GetContactSolverWidth();
+	CHECK((maxWidth == 1 || maxWidth == 4 || maxWidth == 8));
+
+	world.SetContactSolverWidth(1);
+	CHECK(world.GetContactSolverWidth() == 1);
+
+	const int32 circleCount = 100;
+	const int32 boxCount = 210;
+
+	SceneResult result;
+	StepStack(1, &result);
+	CHECK(result.positions.size() == size_t(circleCount + boxCount + 1));
+	const std::vector<b2Vec2>& positions = result.positions;
+	const std::vector<float>& angles = result.angles;
+
+	// Contacts within a color are independent, so the width doesn't matter for the pyramid.
+	// Small islands, like some in the circle pile, only use the 4 wide solver.
+	SceneResult result4;
+	if (maxWidth == 8)
+	{
+		StepStack(4, &result4);
+	}
+
+	int32 widths[] = { 4, 8 };
+	for (int32 width : widths)
+	{
+		if (width > maxWidth)
+		{
+			continue;
+		}
+
+		SceneResult wideResult;
+		StepStack(width, &wideResult);
+		const std::vector<b2Vec2>& widePositions = wideResult.positions;
+		const std::vector<float>& wideAngles = wideResult.angles;
+
+		// The contacts are solved in another order. The pyramid comes to rest at the
+		// same place, the circle pile falls apart differently but must not sink.
+		float maxDistance = 0.0f;
+		float maxAngle = 0.0f;
+		for (int32 i = circleCount; i < circleCount + boxCount; ++i)
+		{
+			maxDistance = b2Max(maxDistance, b2Distance(positions[i], widePositions[i]));
+			maxAngle = b2Max(maxAngle, b2Abs(angles[i] - wideAngles[i]));
+		}
+
+		float minCircleY = b2_maxFloat;
+		for (int32 i = 0; i < circleCount; ++i)
+		{
+			minCircleY = b2Min(minCircleY, widePositions[i].y);
+		}
+
+		CHECK(maxDistance < 0.02f);
+		CHECK(maxAngle < 0.01f);
+		CHECK(minCircleY > 0.5f - 2.0f * b2_linearSlop);
+
+		if (width == 8)
+		{
+			bool same = true;
+			for (int32 i = circleCount; i < circleCount + boxCount; ++i)
+			{
+				same = same && result4.positions[i] == widePositions[i] && result4.angles[i] == wideAngles[i];
+			}
+
+			CHECK(same);
+		}
+	}
+}
+
+// Records the order of the contact callbacks, bodies are identified by their user data.
+class ContactEventRecorder : public b2ContactListener
+{
+public:
+	void BeginContact(b2Contact* contact) override
+	{
+		Record(1, contact);
+	}
+
+	void EndContact(b2Contact* contact) override
+	{
+		Record(2, contact);
+	}
+
+	void PreSolve(b2Contact* contact, const b2Manifold* oldManifold) override
+	{
+		Record(3 + oldManifold->pointCount, contact);
+	}
+
+	void Record(int32 type, b2Contact* contact)
+	{
+		events.push_back(type);
+		events.push_back((int32)contact->GetFixtureA()->GetBody()->GetUserData().pointer);
+		events.push_back((int32)contact->GetFixtureB()->GetBody()->GetUserData().pointer);
+	}
+
+	std::vector<int32> events;
+};
+
+// Bouncing boxes and circles, some of them starting asleep on the ground.
+static void BuildBouncing(b2World* world)
+{
+	b2BodyDef groundDef;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+
+	b2FixtureDef fixtureDef;
+	fixtureDef.density = 1.0f;
+	fixtureDef.restitution = 0.5f;
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	for (int32 i = 0; i < 400; ++i)
+	{
+		int32 column = i % 40;
+		int32 row = i / 40;
+
+		bodyDef.position.Set(-20.0f + 1.0f * column + 0.1f * row, 0.5f + 1.5f * row);
+		bodyDef.awake = row > 0;
+		bodyDef.userData.pointer = (uintptr_t)(i + 1);
+		fixtureDef.shape = (i % 3 == 0) ? (b2Shape*)&circle : (b2Shape*)&box;
+		world->CreateBody(&bodyDef)->CreateFixture(&fixtureDef);
+	}
+}
+
+// Steps the bouncing scene with 1 thread and then 2 and 4, the results and the
+// listener callbacks must be the same.
+template <typename Listener>
+static void CheckBouncing()
+{
+	SceneResult result;
+	Listener listener;
+	StepScene(1, [&listener](b2World* world) { world->SetContactListener(&listener); BuildBouncing(world); }, 90, &result);
+	CHECK(listener.events.size() > 0);
+
+	int32 threadCounts[] = { 2, 4 };
+	for (int32 threadCount : threadCounts)
+	{
+		SceneResult parallelResult;
+		Listener parallelListener;
+		StepScene(threadCount, [&parallelListener](b2World* world) { world->SetContactListener(&parallelListener); BuildBouncing(world); }, 90, &parallelResult);
+
+		CHECK(result == parallelResult);
+		CHECK(listener.events == parallelListener.events);
+	}
+}
+
+DOCTEST_TEST_CASE("parallel narrow phase")
+{
+	CheckBouncing<ContactEventRecorder>();
+}
+
+// Changes the bodies of the contacts it reports. Contacts later in the list are then
+// refiltered or evaluated as sensors in the same step.
+class RefilterListener : public ContactEventRecorder
+{
+public:
+	void BeginContact(b2Contact* contact) override
+	{
+		ContactEventRecorder::BeginContact(contact);
+		Change(contact->GetFixtureA());
+		Change(contact->GetFixtureB());
+	}
+
+	void Change(b2Fixture* fixture)
+	{
+		int32 id = (int32)fixture->GetBody()->GetUserData().pointer;
+		if (id % 7 == 0 && fixture->GetFilterData().maskBits != 0)
+		{
+			b2Filter filter;
+			filter.maskBits = 0;
+			fixture->SetFilterData(filter);
+		}
+		else if (id % 11 == 0)
+		{
+			fixture->SetSensor(true);
+		}
+	}
+};
+
+DOCTEST_TEST_CASE("parallel narrow phase with listener changes")
+{
+	CheckBouncing<RefilterListener>();
+}
+
+// A grid of boxes, Explode blows it apart from its center. New contacts are added in
+// the order of the pairs.
+static void BuildExplosion(b2World* world)
+{
+	b2BodyDef groundDef;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-60.0f, 0.0f), b2Vec2(60.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.4f, 0.4f);
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	for (int32 i = 0; i < 900; ++i)
+	{
+		bodyDef.position.Set(-15.0f + 1.0f * (i % 30), 0.4f + 1.0f * (i / 30));
+		bodyDef.userData.pointer = (uintptr_t)(i + 1);
+		world->CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+	}
+}
+
+static void Explode(b2World* world, int32 stepIndex)
+{
+	if (stepIndex == 20)
+	{
+		b2Vec2 center(0.0f, 15.0f);
+		for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+		{
+			b->SetLinearVelocity(2.0f * (b->GetPosition() - center));
+		}
+	}
+}
+
+DOCTEST_TEST_CASE("parallel pair finding")
+{
+	SceneResult result;
+	StepScene(1, BuildExplosion, 60, &result, Explode);
+	CHECK(result.contactOrder.size() > 0);
+
+	int32 threadCounts[] = { 2, 4 };
+	for (int32 threadCount : threadCounts)
+	{
+		SceneResult parallelResult;
+		StepScene(threadCount, BuildExplosion, 60, &parallelResult, Explode);
+
+		CHECK(result == parallelResult);
+	}
+}
+
+// Shapes of every type, joints of every type and resting contacts.
+static void CreateSnapshotScene(b2World* world)
+{
+	b2BodyDef groundDef;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2Vec2 points[4] = { b2Vec2(-30.0f, 4.0f), b2Vec2(-25.0f, 0.5f), b2Vec2(-20.0f, 0.5f), b2Vec2(-15.0f, 2.0f) };
+	b2ChainShape chain;
+	chain.CreateChain(points, 4, b2Vec2(-35.0f, 4.0f), b2Vec2(-10.0f, 2.0f));
+	ground->CreateFixture(&chain, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	b2Body* bodies[60];
+	for (int32 i = 0; i < 60; ++i)
+	{
+		bodyDef.position.Set(-28.0f + 1.1f * (i % 20), 6.0f + 1.2f * (i / 20));
+		bodyDef.userData.pointer = (uintptr_t)(i + 1);
+		bodies[i] = world->CreateBody(&bodyDef);
+		bodies[i]->CreateFixture(i % 2 ? (b2Shape*)&circle : (b2Shape*)&box, 1.0f);
+	}
+
+	// A body with two fixtures.
+	b2CircleShape offsetCircle;
+	offsetCircle.m_radius = 0.3f;
+	offsetCircle.m_p.Set(0.0f, 0.7f);
+	bodies[59]->CreateFixture(&offsetCircle, 1.0f);
+
+	b2RevoluteJointDef revoluteDef;
+	revoluteDef.Initialize(ground, bodies[0], b2Vec2(-28.0f, 10.0f));
+	revoluteDef.enableMotor = true;
+	revoluteDef.maxMotorTorque = 50.0f;
+	b2Joint* revolute = world->CreateJoint(&revoluteDef);
+
+	b2PrismaticJointDef prismaticDef;
+	prismaticDef.Initialize(ground, bodies[1], bodies[1]->GetPosition(), b2Vec2(1.0f, 0.0f));
+	prismaticDef.enableLimit = true;
+	prismaticDef.lowerTranslation = -2.0f;
+	prismaticDef.upperTranslation = 2.0f;
+	b2Joint* prismatic = world->CreateJoint(&prismaticDef);
+
+	b2GearJointDef gearDef;
+	gearDef.bodyA = bodies[0];
+	gearDef.bodyB = bodies[1];
+	gearDef.joint1 = revolute;
+	gearDef.joint2 = prismatic;
+	gearDef.ratio = 2.0f;
+	world->CreateJoint(&gearDef);
+
+	b2DistanceJointDef distanceDef;
+	distanceDef.Initialize(bodies[2], bodies[3], bodies[2]->GetPosition(), bodies[3]->GetPosition());
+	distanceDef.collideConnected = true;
+	world->CreateJoint(&distanceDef);
+
+	b2WeldJointDef weldDef;
+	weldDef.Initialize(bodies[4], bodies[5], bodies[4]->GetPosition());
+	world->CreateJoint(&weldDef);
+
+	b2WheelJointDef wheelDef;
+	wheelDef.Initialize(bodies[6], bodies[7], bodies[7]->GetPosition(), b2Vec2(0.0f, 1.0f));
+	wheelDef.stiffness = 20.0f;
+	wheelDef.damping = 1.0f;
+	world->CreateJoint(&wheelDef);
+
+	b2MotorJointDef motorDef;
+	motorDef.Initialize(bodies[8], bodies[9]);
+	world->CreateJoint(&motorDef);
+
+	b2FrictionJointDef frictionDef;
+	frictionDef.Initialize(ground, bodies[10], bodies[10]->GetPosition());
+	frictionDef.maxForce = 5.0f;
+	world->CreateJoint(&frictionDef);
+
+	b2PulleyJointDef pulleyDef;
+	pulleyDef.Initialize(bodies[11], bodies[12], b2Vec2(-16.0f, 12.0f), b2Vec2(-14.0f, 12.0f),
+		bodies[11]->GetPosition(), bodies[12]->GetPosition(), 1.0f);
+	world->CreateJoint(&pulleyDef);
+
+	b2MouseJointDef mouseDef;
+	mouseDef.bodyA = ground;
+	mouseDef.bodyB = bodies[13];
+	mouseDef.target = bodies[13]->GetPosition() + b2Vec2(1.0f, 2.0f);
+	mouseDef.maxForce = 100.0f;
+	world->CreateJoint(&mouseDef);
+}
+
+static std::vector<char> SaveSnapshot(b2World* world)
+{
+	std::vector<char> data(world->SaveSnapshot(nullptr, 0));
+	int32 size = world->SaveSnapshot(data.data(), (int32)data.size());
+	CHECK(size == (int32)data.size());
+	return data;
+}
+
+DOCTEST_TEST_CASE("world snapshot")
+{
+	b2World world({ 0.0f, -10.0f });
+	CreateSnapshotScene(&world);
+
+	for (int32 i = 0; i < 40; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	std::vector<char> data = SaveSnapshot(&world);
+
+	// Loading replaces what the world had.
+	b2World copy({ 0.0f, 0.0f });
+	CreateSnapshotScene(&copy);
+	CHECK(copy.LoadSnapshot(data.data(), (int32)data.size()));
+
+	CHECK(copy.GetBodyCount() == world.GetBodyCount());
+	CHECK(copy.GetJointCount() == world.GetJointCount());
+	CHECK(copy.GetContactCount() == world.GetContactCount());
+	CHECK(copy.GetProxyCount() == world.GetProxyCount());
+	CHECK(copy.GetContactCount() > 0);
+	CHECK(SaveSnapshot(&copy) == data);
+
+	// Both worlds keep stepping bit-exactly.
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+		copy.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	CHECK(SaveSnapshot(&copy) == SaveSnapshot(&world));
+
+	bool same = true;
+	const b2Body* b = world.GetBodyList();
+	for (const b2Body* c = copy.GetBodyList(); c; c = c->GetNext(), b = b->GetNext())
+	{
+		same = same && b->GetPosition().x == c->GetPosition().x && b->GetPosition().y == c->GetPosition().y;
+		same = same && b->GetAngle() == c->GetAngle();
+	}
+	CHECK(same);
+
+	// A truncated snapshot leaves the world empty.
+	CHECK(copy.LoadSnapshot(data.data(), (int32)data.size() / 2) == false);
+	CHECK(copy.GetBodyCount() == 0);
+	CHECK(copy.GetProxyCount() == 0);
+
+	// Data that is not a snapshot is ignored.
+	CHECK(copy.LoadSnapshot(data.data(), (int32)data.size()));
+	data[0] = 0;
+	CHECK(copy.LoadSnapshot(data.data(), (int32)data.size()) == false);
+	CHECK(copy.GetBodyCount() == world.GetBodyCount());
+}
+
+class ClosestRayCallback : public b2RayCastCallback
+{
+public:
+	float ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction) override
+	{
+		if ((fixture->GetFilterData().categoryBits & maskBits) == 0 || fraction > maxFraction)
+		{
+			return -1.0f;
+		}
+
+		hit.fixture = fixture;
+		hit.point = point;
+		hit.normal = normal;
+		hit.fraction = fraction;
+		return fraction;
+	}
+
+	b2RayCastHit hit = {};
+	uint16 maskBits = 0xFFFF;
+	float maxFraction = 1.0f;
+};
+
+class AllRayCallback : public b2RayCastCallback
+{
+public:
+	float ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction) override
+	{
+		B2_NOT_USED(fixture);
+		B2_NOT_USED(point);
+		B2_NOT_USED(normal);
+		if (fraction <= maxFraction)
+		{
+			fractions.push_back(fraction);
+		}
+		return 1.0f;
+	}
+
+	std::vector<float> fractions;
+	float maxFraction = 1.0f;
+};
+
+class QueryRecorder : public b2QueryCallback
+{
+public:
+	bool ReportFixture(b2Fixture* fixture) override
+	{
+		fixtures.push_back(fixture);
+		return true;
+	}
+
+	std::vector<b2Fixture*> fixtures;
+};
+
+DOCTEST_TEST_CASE("batched queries")
+{
+	b2World world({ 0.0f, -10.0f });
+
+	b2BodyDef bodyDef;
+	b2PolygonShape box;
+	box.SetAsBox(0.4f, 0.3f);
+	b2CircleShape circle;
+	circle.m_radius = 0.35f;
+
+	uint32 seed = 7;
+	auto random = [&seed](float lo, float hi)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return lo + (hi - lo) * (float)(seed >> 8) / (float)(1 << 24);
+	};
+
+	for (int32 i = 0; i < 500; ++i)
+	{
+		bodyDef.position.Set(random(-30.0f, 30.0f), random(-30.0f, 30.0f));
+		bodyDef.angle = random(0.0f, b2_pi);
+		b2FixtureDef fixtureDef;
+		fixtureDef.shape = i % 3 == 0 ? (b2Shape*)&circle : (b2Shape*)&box;
+		fixtureDef.filter.categoryBits = i % 4 == 0 ? 0x0002 : 0x0001;
+		world.CreateBody(&bodyDef)->CreateFixture(&fixtureDef);
+	}
+
+	const int32 rayCount = 1000;
+	std::vector<b2RayCastInput> rays(rayCount);
+	std::vector<b2AABB> aabbs(rayCount);
+	for (int32 i = 0; i < rayCount; ++i)
+	{
+		rays[i].p1.Set(random(-35.0f, 35.0f), random(-35.0f, 35.0f));
+		rays[i].p2 = rays[i].p1 + b2Vec2(random(-20.0f, 20.0f), random(-20.0f, 20.0f));
+		rays[i].maxFraction = i % 5 == 0 ? 0.5f : 1.0f;
+		aabbs[i].lowerBound = rays[i].p1;
+		aabbs[i].upperBound = rays[i].p1 + b2Vec2(random(0.1f, 4.0f), random(0.1f, 4.0f));
+	}
+
+	const int32 maxHits = 3;
+	const int32 maxFixtures = 8;
+
+	int32 threadCounts[] = { 1, 4 };
+	for (int32 threadCount : threadCounts)
+	{
+		world.SetThreadCount(threadCount);
+
+		std::vector<b2RayCastHit> closest(rayCount);
+		world.RayCastClosest(rays.data(), rayCount, closest.data(), 0x0001);
+
+		std::vector<b2RayCastHit> hits(rayCount * maxHits);
+		std::vector<int32> hitCounts(rayCount);
+		world.RayCastAll(rays.data(), rayCount, maxHits, hits.data(), hitCounts.data(), 0xFFFF);
+
+		std::vector<b2Fixture*> fixtures(rayCount * maxFixtures);
+		std::vector<int32> fixtureCounts(rayCount);
+		world.QueryAABBs(aabbs.data(), rayCount, maxFixtures, fixtures.data(), fixtureCounts.data(), 0xFFFF);
+
+		bool sameClosest = true;
+		bool sameAll = true;
+		bool sameQuery = true;
+		int32 closestCount = 0;
+		for (int32 i = 0; i < rayCount; ++i)
+		{
+			// The callbacks skip hits past maxFraction instead of clipping the ray.
+			ClosestRayCallback closestCallback;
+			closestCallback.maskBits = 0x0001;
+			closestCallback.maxFraction = rays[i].maxFraction;
+			world.RayCast(&closestCallback, rays[i].p1, rays[i].p2);
+
+			const b2RayCastHit& hit = closest[i];
+			sameClosest = sameClosest && hit.fixture == closestCallback.hit.fixture;
+			if (hit.fixture)
+			{
+				sameClosest = sameClosest && hit.point == closestCallback.hit.point;
+				sameClosest = sameClosest && hit.fraction == closestCallback.hit.fraction;
+				closestCount += 1;
+			}
+
+			AllRayCallback allCallback;
+			allCallback.maxFraction = rays[i].maxFraction;
+			world.RayCast(&allCallback, rays[i].p1, rays[i].p2);
+			std::sort(allCallback.fractions.begin(), allCallback.fractions.end());
+
+			int32 expectedCount = b2Min((int32)allCallback.fractions.size(), maxHits);
+			sameAll = sameAll && hitCounts[i] == expectedCount;
+			for (int32 k = 0; k < hitCounts[i] && k < expectedCount; ++k)
+			{
+				sameAll = sameAll && hits[i * maxHits + k].fraction == allCallback.fractions[k];
+			}
+
+			QueryRecorder recorder;
+			world.QueryAABB(&recorder, aabbs[i]);
+			if (recorder.fixtures.size() > (size_t)maxFixtures)
+			{
+				recorder.fixtures.resize(maxFixtures);
+			}
+
+			std::vector<b2Fixture*> found(fixtures.begin() + i * maxFixtures,
+				fixtures.begin() + i * maxFixtures + fixtureCounts[i]);
+			sameQuery = sameQuery && found == recorder.fixtures;
+		}
+
+		CHECK(closestCount > 100);
+		CHECK(sameClosest);
+		CHECK(sameAll);
+		CHECK(sameQuery);
+	}
+}
+
+DOCTEST_TEST_CASE("persistent islands")
+{
+	b2World world(b2Vec2(0.0f, 0.0f));
+
+	b2CircleShape shape;
+	shape.m_radius = 0.5f;
+
+	b2BodyDef bd;
+	bd.type = b2_dynamicBody;
+	bd.position.Set(0.0f, 0.0f);
+	b2Body* moving = world.CreateBody(&bd);
+	moving->CreateFixture(&shape, 1.0f);
+	moving->SetLinearVelocity(b2Vec2(1.0f, 0.0f));
+
+	bd.position.Set(-3.0f, 0.0f);
+	b2Body* resting = world.CreateBody(&bd);
+	resting->CreateFixture(&shape, 1.0f);
+
+	b2DistanceJointDef jd;
+	jd.Initialize(moving, resting, moving->GetPosition(), resting->GetPosition());
+	b2Joint* joint = world.CreateJoint(&jd);
+
+	const float timeStep = 1.0f / 60.0f;
+	world.Step(timeStep, 8, 3);
+	CHECK(world.GetIslandCount() == 1);
+
+	// The island is split lazily, but the bodies don't wait for each other to sleep.
+	world.DestroyJoint(joint);
+	resting->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
+	for (int32 i = 0; i < 3; ++i)
+	{
+		world.Step(timeStep, 8, 3);
+	}
+	CHECK(world.GetIslandCount() == 2);
+
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(timeStep, 8, 3);
+	}
+	CHECK(moving->IsAwake() == true);
+	CHECK(resting->IsAwake() == false);
+	CHECK(world.GetIslandCount() == 1);
+
+	// A loaded world keeps the sleeping island apart.
+	int32 size = world.SaveSnapshot(nullptr, 0);
+	std::vector<char> data(size);
+	CHECK(world.SaveSnapshot(data.data(), size) == size);
+
+	b2World copy(b2Vec2(0.0f, 0.0f));
+	CHECK(copy.LoadSnapshot(data.data(), size));
+	copy.Step(timeStep, 8, 3);
+	CHECK(copy.GetIslandCount() == 1);
+
+	int32 awakeCount = 0;
+	for (b2Body* b = copy.GetBodyList(); b; b = b->GetNext())
+	{
+		awakeCount += b->IsAwake() ? 1 : 0;
+	}
+	CHECK(awakeCount == 1);
+
+	// Joining a sleeping island to an awake one wakes it.
+	jd.Initialize(moving, resting, moving->GetPosition(), resting->GetPosition());
+	world.CreateJoint(&jd);
+	world.Step(timeStep, 8, 3);
+	CHECK(resting->IsAwake() == true);
+	CHECK(world.GetIslandCount() == 1);
+}
+
+// Wakes a sleeping body whenever a contact begins, like a game reacting to hits.
+class WakeListener : public b2ContactListener
+{
+public:
+	void BeginContact(b2Contact* contact) override
+	{
+		B2_NOT_USED(contact);
+
+		if (next < int32(sleepers.size()))
+		{
+			sleepers[next++]->SetAwake(true);
+		}
+	}
+
+	std::vector<b2Body*> sleepers;
+	int32 next = 0;
+};
+
+// Bullets fired through a row of boxes at a thin wall, most of them hit something within
+// a step so there are many TOI events per step. Hits wake bullets sleeping half sunk in
+// the ground, their contacts with it then have TOI events.
+static void BuildBullets(b2World* world, WakeListener* listener)
+{
+	world->SetContactListener(listener);
+
+	b2BodyDef groundDef;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-20.0f, 0.0f), b2Vec2(20.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+	edge.SetTwoSided(b2Vec2(10.0f, 0.0f), b2Vec2(10.0f, 20.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	b2PolygonShape box;
+	box.SetAsBox(0.1f, 0.5f);
+
+	for (int32 i = 0; i < 20; ++i)
+	{
+		bodyDef.position.Set(5.0f, 0.5f + 1.0f * i);
+		world->CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+	}
+
+	b2CircleShape circle;
+	circle.m_radius = 0.05f;
+
+	bodyDef.bullet = true;
+	for (int32 i = 0; i < 100; ++i)
+	{
+		bodyDef.position.Set(-5.0f + 0.05f * (i % 7), 0.5f + 0.19f * i);
+		bodyDef.linearVelocity.Set(300.0f + 10.0f * (i % 5), -20.0f + 0.4f * i);
+		world->CreateBody(&bodyDef)->CreateFixture(&circle, 1.0f);
+	}
+
+	bodyDef.awake = false;
+	bodyDef.linearVelocity.SetZero();
+	for (int32 i = 0; i < 40; ++i)
+	{
+		bodyDef.position.Set(-15.0f + 0.5f * i, 0.5f * circle.m_radius);
+		b2Body* body = world->CreateBody(&bodyDef);
+		body->CreateFixture(&circle, 1.0f);
+		listener->sleepers.push_back(body);
+	}
+}
+
+static void StepBullets(bool batching, int32 threadCount, SceneResult* result)
+{
+	WakeListener listener;
+	StepScene(threadCount, [batching, &listener](b2World* world) { world->SetTOIBatching(batching); BuildBullets(world, &listener); }, 60, result);
+	CHECK(listener.next > 0);
+}
+
+DOCTEST_TEST_CASE("parallel continuous collision")
+{
+	// The reference scans all contacts for every TOI event.
+	SceneResult result;
+	StepBullets(false, 1, &result);
+
+	// Nothing went through the wall.
+	bool contained = true;
+	for (const b2Vec2& p : result.positions)
+	{
+		contained = contained && p.x < 10.0f;
+	}
+	CHECK(contained);
+
+	int32 threadCounts[] = { 1, 2, 4 };
+	for (int32 threadCount : threadCounts)
+	{
+		SceneResult batchedResult;
+		StepBullets(true, threadCount, &batchedResult);
+
+		CHECK(result == batchedResult);
+	}
+}
+
+// Circles dropped on a ground box. Each circle is an island of its own, so the positions
+// don't depend on the order the broad-phase reports the pairs in.
+static void DropCircles(b2World* world, std::vector<b2Body*>* circles)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	b2PolygonShape box;
+	box.SetAsBox(50.0f, 0.5f);
+	ground->CreateFixture(&box, 0.0f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+
+	bd.type = b2_dynamicBody;
+	for (int32 i = 0; i < 20; ++i)
+	{
+		bd.position.Set(-40.0f + 4.0f * i, 2.0f + 0.5f * i);
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(&circle, 1.0f);
+		circles->push_back(body);
+	}
+}
+
+DOCTEST_TEST_CASE("broad-phase refitting")
+{
+	b2World reference(b2Vec2(0.0f, -10.0f));
+	std::vector<b2Body*> referenceCircles;
+	DropCircles(&reference, &referenceCircles);
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetBroadPhaseRefitting(true);
+	CHECK(world.GetBroadPhaseRefitting());
+	std::vector<b2Body*> circles;
+	DropCircles(&world, &circles);
+
+	for (int32 i = 0; i < 120; ++i)
+	{
+		reference.Step(1.0f / 60.0f, 8, 3);
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	CHECK(world.GetContactCount() == reference.GetContactCount());
+	for (size_t i = 0; i < circles.size(); ++i)
+	{
+		CHECK(circles[i]->GetPosition() == referenceCircles[i]->GetPosition());
+	}
+
+	// A rebuild repairs the refitted tree.
+	float refitQuality = world.GetTreeQuality();
+	world.RebuildBroadPhase();
+	CHECK(world.GetTreeQuality() <= refitQuality);
+}
@@ -1,6 +1,13 @@
 #include <box2d/box2d.h>
+#include <Scenes.h>
+#include <WorldSnapshot.h>
+#include <PerformanceHud.h>
+#include <InputLog.h>
 #include <SDL2/SDL.h>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
 #include <math.h>
 
 class Base
@@ -13,19 +20,63 @@ public:
 	char keyPresses[SDL_NUM_SCANCODES]{};
 	std::vector<SDL_Scancode> pressedKeys;
 
+	// time since the previous frame, drives the camera controls
 	float deltaTime = 0.0f;
-	uint32 renderFlags = 0x1F; // initially render everything
+
+	// the world is always stepped with timeStep, however fast frames are rendered
+	float timeStep = 1.0f / 60.0f;
+	int velocityIterations = 8;
+	int positionIterations = 3;
+	// most steps taken in one frame, time beyond that is dropped so slow frames can't snowball
+	int maxStepsPerFrame = 8;
+	float accumulator = 0.0f;
+
+	// transforms of the moving bodies before the last step, bodies are drawn
+	// between these and their current transform by interpolationAlpha
+	PreviousTransforms previousTransforms;
+	float interpolationAlpha = 1.0f;
+
+	// the world is stepped on physicsThread and only read through snapshots by the main thread
+	bool threaded = false;
+	std::thread physicsThread;
+	std::atomic<bool> physicsRunning{ false };
+	SnapshotBuffer snapshots;
+	uint32 renderFlags = 0x1F | b2Draw::e_bodyTransformBit; // initially render everything, interpolated
+
+	// toggled with H, shows stats of the last step and the milliseconds stepping took each frame
+	PerformanceHud hud;
+	WorldStats stats;
+	float frameStepTime = 0.0f;
 
 	int width = 1280;
 	int height = 720;
 	int halfWidth = width / 2;
 	int halfHeight = height / 2;
 
+	// mouse grabs, drags, spawns and removals queued by handleEvents, applied before the next step
+	InputController inputs;
+	std::mutex inputMutex;
+	std::vector<InputEvent> pendingInputs;
+	uint32_t stepIndex = 0;
+
+	// --record keeps every applied input, the log is saved at exit
+	bool recording = false;
+	InputLog inputLog;
+
 	bool shouldQuit = false;
 
-	Base();
+	// no window or renderer, the world is stepped by runHeadless
+	bool headless = false;
+
+	Base(bool headless = false, SceneType scene = SceneType::testBodies, int sceneBodyCount = 0);
 	~Base();
 
 	void handleEvents();
+	void queueInput(InputType type, int x, int y);
+	void stepWorld();
+	void stepFixed(float frameTime);
+	void physicsLoop();
+	void render();
 	void loop();
+	void runHeadless(int stepCount);
 };
\ No newline at end of file
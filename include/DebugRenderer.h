@@ -1,3 +1,4 @@
+#include <WorldSnapshot.h>
 #include <box2d/box2d.h>
 #include <vector>
 #include <SDL2/SDL.h>
@@ -5,12 +6,34 @@
 class DebugRenderer : public b2Draw
 {
 private:
+	// circles use CIRCLE_EDGES segments at most, fewer when they are small on screen
 	const int CIRCLE_EDGES = 64;
+	const int MIN_CIRCLE_EDGES = 4;
+	// largest distance in pixels between a circle and its polygon approximation
+	const float CIRCLE_TOLERANCE = 0.25f;
+	const float LINE_WIDTH = 1.0f;
+
+	// unit circle vertices for every level of detail, circleTables[i] has MIN_CIRCLE_EDGES << i vertices
+	std::vector<std::vector<b2Vec2>> circleTables;
+	// largest on screen radius each table stays within CIRCLE_TOLERANCE for
+	std::vector<float> circleMaxRadius;
+
+	// every fill and outline of a frame, submitted with a single SDL_RenderGeometry call in flush()
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+
+	// screen space points of the shape being added
+	std::vector<b2Vec2> screenPoints;
+
+	void addTriangleFan(const b2Vec2* points, int count, SDL_Color color);
+	void addLine(b2Vec2 p0, b2Vec2 p1, SDL_Color color);
+	void addOutline(const b2Vec2* points, int count, SDL_Color color);
+	void addRect(float x, float y, float w, float h, SDL_Color color);
+
+	void precalculateCircleTables();
+	// fills screenPoints with the circle outline and returns the vertex count
+	int transformCircle(const b2Vec2& center, float radius);
 
-	// pre-allocated vertices
-	std::vector<SDL_Vertex> allocatedVertices;
-	// precalculated indices to render polygons
-	std::vector<std::vector<int>> indices;
 public:
 	class Base* base;
 
@@ -19,10 +42,26 @@ public:
 	const float maxScale = 500.0f;
 	const float minScale = 2.5f;
 
+	// statistics of the last flushed frame
+	int drawCallCount = 0;
+	int vertexCount = 0;
+	int indexCount = 0;
+
 	DebugRenderer(Base* base);
 
-	void precalculateIndices();
 	b2Vec2 translateToScreenCoords(b2Vec2 vec) const;
+	b2Vec2 translateToWorldCoords(int x, int y) const;
+
+	// world space bounds of the window, used to cull b2World::DebugDraw
+	b2AABB getViewAABB() const;
+
+	// submits everything drawn since the last flush, call once after b2World::DebugDraw
+	void flush();
+
+	// draws a snapshot published by the physics thread, moving bodies are drawn
+	// alpha of the way from their previous to their current transform
+	void drawSnapshot(const WorldSnapshot& snapshot, float alpha);
+	void drawShape(const WorldSnapshot& snapshot, const WorldSnapshot::Shape& shape, const b2Transform& xf, const b2Color& color, const b2AABB& viewAABB);
 
 	virtual ~DebugRenderer() {}
 
@@ -47,4 +86,7 @@ public:
 
 	/// Draw a point.
 	void DrawPoint(const b2Vec2& p, float size, const b2Color& color) override;
+
+	/// Interpolates between the transform before the last step and the current one.
+	b2Transform GetBodyTransform(const b2Body* body) const override;
 };
\ No newline at end of file
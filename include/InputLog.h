@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Scenes.h>
+#include <box2d/box2d.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// what the viewer's mouse does to the world, applied between steps. Events only carry
+// a world point, so the same events on the same world touch the same bodies
+enum class InputType : uint8_t
+{
+	grab,		// mouse joint on the dynamic body under point
+	drag,		// moves the mouse joint target to point
+	release,	// destroys the mouse joint
+	spawn,		// box at point
+	remove,		// destroys the dynamic body under point
+	count
+};
+
+struct InputEvent
+{
+	uint32_t step; // applied before this step, counted from 0
+	InputType type;
+	b2Vec2 point;
+};
+
+// applies input events to a world, the viewer and the replay share it so both do the same
+class InputController
+{
+private:
+	b2Body* groundBody = nullptr;
+	b2MouseJoint* mouseJoint = nullptr;
+
+	b2Body* findBody(b2World* world, const b2Vec2& point) const;
+
+public:
+	void apply(b2World* world, const InputEvent& e);
+
+	const b2MouseJoint* getMouseJoint() const { return mouseJoint; }
+};
+
+// the inputs of a viewer session and the world they were applied to
+struct InputLog
+{
+	// scene and bodyCount are used when worldPath is empty
+	SceneType scene = SceneType::testBodies;
+	int bodyCount = 0;
+	std::string worldPath;
+
+	float timeStep = 1.0f / 60.0f;
+	int velocityIterations = 8;
+	int positionIterations = 3;
+	int solverWidth = 1;
+
+	uint32_t stepCount = 0;
+
+	// sorted by step, at most one drag per step
+	std::vector<InputEvent> events;
+
+	// keeps the last drag of a step only, earlier ones would be overwritten before the step
+	void record(const InputEvent& e);
+
+	bool save(const char* path) const;
+
+	// false if the file is missing, damaged or not an input log
+	bool load(const char* path);
+};
+
+// FNV-1a over the transforms and velocities of all bodies, equal hashes mean bit-exact states
+uint64_t hashWorldState(const b2World* world);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <WorldSnapshot.h>
+#include <SDL2/SDL.h>
+#include <vector>
+
+// overlay with rolling frame and step time graphs, the b2Profile breakdown of the last
+// step, the world counts and the renderer totals of the last frame. Everything is drawn
+// in screen space with one SDL_RenderGeometry call, and the text is only rebuilt a few
+// times per second, so it can stay on while a large scene runs.
+class PerformanceHud
+{
+private:
+	static const int HISTORY = 240;
+	// seconds between text updates, the numbers are averaged over it
+	const float TEXT_INTERVAL = 0.25f;
+	// screen pixels per font pixel
+	const float PIXEL = 2.0f;
+	const float GRAPH_HEIGHT = 48.0f;
+
+	// milliseconds, the newest at historyIndex - 1
+	float frameTimes[HISTORY] = {};
+	float stepTimes[HISTORY] = {};
+	int historyIndex = 0;
+
+	// sums of the current text interval
+	float intervalTime = 0.0f;
+	int intervalFrames = 0;
+	float frameSum = 0.0f;
+	float frameMax = 0.0f;
+	float stepSum = 0.0f;
+	float stepMax = 0.0f;
+	bool textDirty = true;
+
+	// shown until the next text update
+	float shownFrameTime = 0.0f;
+	float shownFrameMax = 0.0f;
+	float shownStepTime = 0.0f;
+	float shownStepMax = 0.0f;
+	float stepScale = 1.0f;
+
+	// 3x5 font, row by row from the top left, bit 14 first
+	uint16_t glyphs[128] = {};
+
+	std::vector<SDL_Vertex> textVertices;
+	std::vector<int> textIndices;
+	float textHeight = 0.0f;
+
+	// text and graphs of this frame
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+
+	static void addRect(std::vector<SDL_Vertex>& vertices, std::vector<int>& indices,
+		float x, float y, float w, float h, SDL_Color color);
+	// returns the y of the next line
+	float addText(float x, float y, const char* text, SDL_Color color);
+	void addGraph(float x, float y, const float* values, float scale, float markValue, SDL_Color color);
+	void rebuildText(const WorldStats& stats, int drawCalls, int vertexCount, int indexCount);
+
+public:
+	bool visible = false;
+
+	PerformanceHud();
+
+	// call every frame, visible or not, so the graphs are full when the HUD is shown
+	// frameTime in seconds, stepTime the milliseconds spent in b2World::Step this frame
+	void addFrame(float frameTime, float stepTime);
+
+	// drawCalls, vertexCount and indexCount of the world drawn this frame
+	void draw(SDL_Renderer* renderer, const WorldStats& stats, int drawCalls, int vertexCount, int indexCount);
+};
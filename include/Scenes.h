@@ -0,0 +1,25 @@
+#pragma once
+
+#include <box2d/box2d.h>
+
+// scenes that can be generated at any size, shared by the viewer and the benchmark
+enum class SceneType
+{
+	testBodies,	// the five hand placed bodies the viewer always started with
+	pyramids,	// box pyramids side by side, dense stacking
+	circlePile,	// circles poured into a container
+	chains,		// revolute joint chains hanging from static anchors
+	ragdolls,	// jointed six body figures dropped on the ground
+	terrain,	// boxes and circles over a large static chain terrain
+	sleeping,	// small stacks that start asleep, with a few awake bodies
+	count
+};
+
+const char* getSceneName(SceneType type);
+
+// returns false if the name matches no scene
+bool findScene(const char* name, SceneType* type);
+
+// creates roughly bodyCount dynamic bodies plus the static geometry the scene needs
+// bodyCount is ignored by SceneType::testBodies
+void createScene(b2World* world, SceneType type, int bodyCount);
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <box2d/box2d.h>
+
+// binary world files written with b2World::SaveSnapshot, they are only
+// read back by the same build on the same platform
+bool saveWorldFile(b2World* world, const char* path);
+
+// the file is memory mapped and loaded in place, on failure the world is left empty
+// or, if the file is not a snapshot at all, unchanged
+bool loadWorldFile(b2World* world, const char* path);
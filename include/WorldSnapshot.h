@@ -0,0 +1,90 @@
+#pragma once
+
+#include <box2d/box2d.h>
+#include <vector>
+#include <mutex>
+
+// numbers about the last step, shown by the performance HUD
+struct WorldStats
+{
+	b2Profile profile = {};
+	int bodyCount = 0;
+	int contactCount = 0;
+	int proxyCount = 0;
+	int treeHeight = 0;
+	int islandCount = 0;
+
+	void capture(const b2World* world);
+};
+
+// transforms of the moving bodies before the last step, in a flat array indexed by a
+// slot kept in each body's user data pointer (slot + 1, 0 for bodies that didn't move)
+struct PreviousTransforms
+{
+	std::vector<b2Transform> transforms;
+
+	// call before each step, clear keeps the capacity
+	void capture(b2World* world);
+
+	// current transform of static, sleeping or new bodies
+	b2Transform get(const b2Body* body) const;
+};
+
+// immutable copy of what the renderer needs from one step, so it can draw
+// while the physics thread is already stepping the world again
+struct WorldSnapshot
+{
+	struct Body
+	{
+		b2Transform previous; // before the step, for interpolation
+		b2Transform current;
+		b2Vec2 localCenter;
+		b2Color color;
+		int firstShape;
+		int shapeCount;
+	};
+
+	// geometry is copied, the physics thread may destroy the fixture while the snapshot is drawn
+	struct Shape
+	{
+		b2Shape::Type type;
+		float radius;
+		bool oneSided; // edges only
+		int firstVertex; // circle center, edge end points, chain or polygon vertices
+		int vertexCount;
+		b2AABB aabb;
+	};
+
+	std::vector<Body> bodies;
+	std::vector<Shape> shapes;
+	std::vector<b2Vec2> vertices;
+	std::vector<b2Vec2> jointAnchors; // pairs of anchor points
+	std::vector<b2Vec2> contactPoints;
+	WorldStats stats;
+
+	// SDL performance counter value when the step finished, 0 before the first step
+	uint64_t time = 0;
+
+	void capture(b2World* world, const PreviousTransforms& previousTransforms);
+};
+
+// triple buffer, the physics thread writes one snapshot while the renderer reads
+// another and the third holds the latest complete step, the lock only guards index swaps
+class SnapshotBuffer
+{
+private:
+	WorldSnapshot snapshots[3];
+	int writeIndex = 0;
+	int readyIndex = 1;
+	int readIndex = 2;
+	bool hasNewSnapshot = false;
+	std::mutex mutex;
+
+public:
+	// snapshot owned by the writer until publish
+	WorldSnapshot& beginWrite();
+	void publish();
+
+	// latest published snapshot, owned by the reader until the next acquire
+	const WorldSnapshot& acquire();
+};
\ No newline at end of file
@@ -1,71 +1,26 @@
 #include <Base.h>
 #include <DebugRenderer.h>
 #include <chrono>
+#include <stdio.h>
 
-void createTestBodies(b2World* world)
+Base::Base(bool headless, SceneType scene, int sceneBodyCount)
 {
-    // box0
-    b2BodyDef boxBodyDef;
-    boxBodyDef.type = b2_dynamicBody;
-    boxBodyDef.position.Set(0.0f, 0.0f);
-    b2Body* boxBody = world->CreateBody(&boxBodyDef);
+    this->headless = headless;
 
-    b2PolygonShape boxShape;
-    boxShape.SetAsBox(1.0f, 1.0f);
-    boxBody->CreateFixture(&boxShape, 1.0f);
-
-    boxBody->SetAngularVelocity(1.0);
-
-    // box1
-    boxBodyDef.position.Set(0.6f, 2.5f);
-    boxBody = world->CreateBody(&boxBodyDef);
-
-    boxShape.SetAsBox(1.0f, 1.0f);
-    boxBody->CreateFixture(&boxShape, 1.0f);
-
-    // second fixture for box1
-    boxShape.SetAsBox(0.5f, 0.5f, b2Vec2(0.0f, 0.8f), b2_pi * 0.25f);
-    boxBody->CreateFixture(&boxShape, 1.0f);
-
-    // static box
-    boxBodyDef.type = b2_staticBody;
-    boxBodyDef.position.Set(0.0f, -10.0f);
-    boxBody = world->CreateBody(&boxBodyDef);
-
-    boxShape.SetAsBox(100.0f, 1.0f);
-    boxBody->CreateFixture(&boxShape, 1.0f);
-
-    // circle
-    b2BodyDef circleBodyDef;
-    circleBodyDef.type = b2_dynamicBody;
-    circleBodyDef.position.Set(5.0f, 0.0f);
-    b2Body* circleBody = world->CreateBody(&circleBodyDef);
-
-    b2CircleShape circleShape;
-    circleShape.m_radius = 1.0f;
-    circleBody->CreateFixture(&circleShape, 1.0f);
-
-    circleBody->SetAngularVelocity(8.0);
-
-    b2MouseJointDef jDef;
-    jDef.bodyA = boxBody;
-    jDef.bodyB = circleBody;
-    jDef.collideConnected = true;
-
-    jDef.target = circleBody->GetPosition() - b2Vec2(1.0, 0.0);
-    jDef.maxForce = circleBody->GetMass() * 20.0f;
-    
-    b2LinearStiffness(jDef.stiffness, jDef.damping, 1.0f, 0.0f, jDef.bodyA, jDef.bodyB);
+    memset(keyPresses, 0, SDL_NUM_SCANCODES);
 
-    b2MouseJoint* mj = (b2MouseJoint*)world->CreateJoint(&jDef);
+    b2Vec2 gravity = b2Vec2(0.0f, -10.0f);
+    world = new b2World(gravity);
 
-    b2Vec2 nextTarget = b2Vec2(0.0, -3.0);
-    mj->SetTarget(nextTarget);
-}
+    createScene(world, scene, sceneBodyCount);
 
-Base::Base()
-{
-    memset(keyPresses, 0, SDL_NUM_SCANCODES);
+    if (headless)
+    {
+        window = nullptr;
+        renderer = nullptr;
+        debugRenderer = nullptr;
+        return;
+    }
 
     SDL_Init(SDL_INIT_VIDEO);
 
@@ -93,16 +48,12 @@ Base::Base()
     {
 		refreshRate = 60;
 	}
+    // first frame estimate, measured every frame after that
     deltaTime = 1.0f / (float)refreshRate;
 
-    b2Vec2 gravity = b2Vec2(0.0f, -10.0f);
-    world = new b2World(gravity);
-
     debugRenderer = new DebugRenderer(this);
     debugRenderer->SetFlags(renderFlags);
     world->SetDebugDraw(debugRenderer);
-
-    createTestBodies(world);
 }
 
 Base::~Base()
@@ -110,6 +61,8 @@ Base::~Base()
     delete world;
     delete debugRenderer;
 
+    if (headless) return;
+
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
@@ -144,6 +97,17 @@ void Base::handleEvents()
         case SDL_KEYUP:
             keyPresses[e.key.keysym.scancode] = 0;
             break;
+        case SDL_MOUSEBUTTONDOWN:
+            if (e.button.button == SDL_BUTTON_LEFT) queueInput(InputType::grab, e.button.x, e.button.y);
+            else if (e.button.button == SDL_BUTTON_RIGHT) queueInput(InputType::spawn, e.button.x, e.button.y);
+            else if (e.button.button == SDL_BUTTON_MIDDLE) queueInput(InputType::remove, e.button.x, e.button.y);
+            break;
+        case SDL_MOUSEBUTTONUP:
+            if (e.button.button == SDL_BUTTON_LEFT) queueInput(InputType::release, e.button.x, e.button.y);
+            break;
+        case SDL_MOUSEMOTION:
+            if (e.motion.state & SDL_BUTTON_LMASK) queueInput(InputType::drag, e.motion.x, e.motion.y);
+            break;
         case SDL_WINDOWEVENT:
             switch (e.window.event)
             {
@@ -183,21 +147,227 @@ void Base::handleEvents()
     }
 
     debugRenderer->SetFlags(renderFlags);
+
+    if (keyPresses[SDL_SCANCODE_H] == 2) hud.visible = !hud.visible;
+}
+
+void Base::queueInput(InputType type, int x, int y)
+{
+    InputEvent e;
+    e.step = 0; // set when it is applied
+    e.type = type;
+    e.point = debugRenderer->translateToWorldCoords(x, y);
+
+    std::lock_guard<std::mutex> lock(inputMutex);
+    pendingInputs.push_back(e);
+}
+
+// called by whichever thread owns the world
+void Base::stepWorld()
+{
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        for (InputEvent& e : pendingInputs)
+        {
+            e.step = stepIndex;
+            inputs.apply(world, e);
+            if (recording) inputLog.record(e);
+        }
+        pendingInputs.clear();
+    }
+
+    world->Step(timeStep, velocityIterations, positionIterations);
+    stepIndex++;
+}
+
+void Base::stepFixed(float frameTime)
+{
+    accumulator += frameTime;
+
+    int stepCount = 0;
+    frameStepTime = 0.0f;
+    while (accumulator >= timeStep && stepCount < maxStepsPerFrame)
+    {
+        previousTransforms.capture(world);
+
+        stepWorld();
+        frameStepTime += world->GetProfile().step;
+
+        accumulator -= timeStep;
+        stepCount++;
+    }
+
+    if (stepCount > 0 && hud.visible) stats.capture(world);
+
+    // spiral of death protection, the simulation falls behind real time instead
+    if (accumulator >= timeStep)
+    {
+        accumulator = fmodf(accumulator, timeStep);
+    }
+
+    interpolationAlpha = accumulator / timeStep;
+}
+
+void Base::physicsLoop()
+{
+    b2SetTraceThreadName("Physics");
+
+    uint64_t frequency = SDL_GetPerformanceFrequency();
+    uint64_t stepTicks = (uint64_t)((double)timeStep * (double)frequency);
+    uint64_t nextStep = SDL_GetPerformanceCounter();
+
+    while (physicsRunning)
+    {
+        previousTransforms.capture(world);
+
+        stepWorld();
+
+        {
+            B2_TRACE_SCOPE("Capture");
+            snapshots.beginWrite().capture(world, previousTransforms);
+            snapshots.publish();
+        }
+
+        // keep the steps on a real time schedule
+        nextStep += stepTicks;
+        uint64_t now = SDL_GetPerformanceCounter();
+
+        if (now < nextStep)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds((nextStep - now) * 1000000 / frequency));
+        }
+        else if (now - nextStep > (uint64_t)maxStepsPerFrame * stepTicks)
+        {
+            // too far behind, drop the time instead of trying to catch up
+            nextStep = now;
+        }
+    }
+}
+
+void Base::render()
+{
+    B2_TRACE_SCOPE("Render");
+
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+
+    if (threaded)
+    {
+        const WorldSnapshot& snapshot = snapshots.acquire();
+
+        // the physics thread owns the world, its stats come with the snapshot
+        stats = snapshot.stats;
+        frameStepTime = snapshot.stats.profile.step;
+
+        if (snapshot.time != 0)
+        {
+            // the latest step is drawn one step late, sliding from its previous to its current state
+            float elapsed = (float)(SDL_GetPerformanceCounter() - snapshot.time) / (float)SDL_GetPerformanceFrequency();
+            float alpha = std::min(elapsed / timeStep, 1.0f);
+
+            debugRenderer->drawSnapshot(snapshot, alpha);
+        }
+    }
+    else
+    {
+        world->DebugDraw(debugRenderer->getViewAABB());
+    }
+
+    {
+        B2_TRACE_SCOPE("Flush");
+        debugRenderer->flush();
+    }
+
+    if (hud.visible)
+    {
+        B2_TRACE_SCOPE("HUD");
+        hud.draw(renderer, stats, debugRenderer->drawCallCount, debugRenderer->vertexCount, debugRenderer->indexCount);
+    }
+
+    {
+        B2_TRACE_SCOPE("Present");
+        SDL_RenderPresent(renderer);
+    }
 }
 
 void Base::loop()
 {
+    uint64_t frequency = SDL_GetPerformanceFrequency();
+    uint64_t lastCounter = SDL_GetPerformanceCounter();
+
+    if (threaded)
+    {
+        physicsRunning = true;
+        physicsThread = std::thread(&Base::physicsLoop, this);
+    }
+
     while (!shouldQuit)
     {
-        handleEvents();
+        B2_TRACE_SCOPE("Frame");
 
-        world->Step(deltaTime, 8, 3);
+        uint64_t counter = SDL_GetPerformanceCounter();
+        float frameTime = (float)(counter - lastCounter) / (float)frequency;
+        lastCounter = counter;
 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
-        SDL_RenderClear(renderer);
+        if (frameTime > 0.0f) deltaTime = frameTime;
 
-        world->DebugDraw();
+        {
+            B2_TRACE_SCOPE("Events");
+            handleEvents();
+        }
 
-        SDL_RenderPresent(renderer);
+        if (!threaded)
+        {
+            B2_TRACE_SCOPE("Physics");
+            stepFixed(frameTime);
+        }
+
+        render();
+        hud.addFrame(frameTime, frameStepTime);
+    }
+
+    if (threaded)
+    {
+        physicsRunning = false;
+        physicsThread.join();
+    }
+}
+
+void Base::runHeadless(int stepCount)
+{
+    b2Profile total;
+    memset(&total, 0, sizeof(b2Profile));
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < stepCount; i++)
+    {
+        stepWorld();
+
+        const b2Profile& p = world->GetProfile();
+        total.step += p.step;
+        total.collide += p.collide;
+        total.solve += p.solve;
+        total.solveInit += p.solveInit;
+        total.solveVelocity += p.solveVelocity;
+        total.solvePosition += p.solvePosition;
+        total.broadphase += p.broadphase;
+        total.solveTOI += p.solveTOI;
     }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("steps: %d, dt: %g, iterations: %d/%d, bodies: %d\n",
+        stepCount, timeStep, velocityIterations, positionIterations, world->GetBodyCount());
+    printf("wall time: %.3f s, %.1f steps/sec\n", seconds, seconds > 0.0 ? stepCount / seconds : 0.0);
+    printf("state hash: %016llx\n", (unsigned long long)hashWorldState(world));
+    printf("profile totals (ms):\n");
+    printf("  step          %10.3f\n", total.step);
+    printf("  collide       %10.3f\n", total.collide);
+    printf("  solve         %10.3f\n", total.solve);
+    printf("  solveInit     %10.3f\n", total.solveInit);
+    printf("  solveVelocity %10.3f\n", total.solveVelocity);
+    printf("  solvePosition %10.3f\n", total.solvePosition);
+    printf("  broadphase    %10.3f\n", total.broadphase);
+    printf("  solveTOI      %10.3f\n", total.solveTOI);
 }
\ No newline at end of file
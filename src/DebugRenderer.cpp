@@ -1,47 +1,88 @@
 #include <DebugRenderer.h>
+#include <WorldSnapshot.h>
 #include <Base.h>
 
+static SDL_Color fillColor(const b2Color& color)
+{
+	return { (uint8_t)(color.r * 128), (uint8_t)(color.g * 128), (uint8_t)(color.b * 128), 128 };
+}
+
+static SDL_Color lineColor(const b2Color& color)
+{
+	return { (uint8_t)(color.r * 255), (uint8_t)(color.g * 255), (uint8_t)(color.b * 255), (uint8_t)(color.a * 255) };
+}
+
+static b2Transform interpolateTransform(const b2Transform& previous, const b2Transform& current, float alpha)
+{
+	b2Transform xf;
+	xf.p = (1.0f - alpha) * previous.p + alpha * current.p;
+
+	// normalized lerp of the rotation, the angle between two steps is small
+	float s = (1.0f - alpha) * previous.q.s + alpha * current.q.s;
+	float c = (1.0f - alpha) * previous.q.c + alpha * current.q.c;
+	float invLength = 1.0f / sqrtf(s * s + c * c);
+	xf.q.s = s * invLength;
+	xf.q.c = c * invLength;
+
+	return xf;
+}
+
 DebugRenderer::DebugRenderer(Base* base)
 {
 	this->base = base;
-	
-	allocatedVertices.resize(std::max(b2_maxPolygonVertices, CIRCLE_EDGES));
 
-	precalculateIndices();
+	screenPoints.resize(std::max(b2_maxPolygonVertices, CIRCLE_EDGES));
+
+	precalculateCircleTables();
 }
 
-void DebugRenderer::precalculateIndices()
+void DebugRenderer::precalculateCircleTables()
 {
-	// indices 0, 1 and 2 are not used
-	indices.resize(b2_maxPolygonVertices + 2);
-
-	for (size_t i = 3; i < b2_maxPolygonVertices; i++)
+	for (int edges = MIN_CIRCLE_EDGES; edges <= CIRCLE_EDGES; edges *= 2)
 	{
-		indices[i].resize(3 * i);
+		std::vector<b2Vec2> table(edges);
 
-		for (size_t j = 0; j < i - 2; j++)
+		for (int i = 0; i < edges; i++)
 		{
-			indices[i][3 * j] = 0;
-			indices[i][3 * j + 1] = (int)j + 1;
-			indices[i][3 * j + 2] = (int)j + 2;
+			float angle = 2.0f * b2_pi * (float)i / (float)edges;
+			table[i].Set(cosf(angle), sinf(angle));
 		}
+
+		circleTables.push_back(table);
+
+		// a chord of angle 2*pi/n deviates from the arc by r * (1 - cos(pi / n))
+		circleMaxRadius.push_back(CIRCLE_TOLERANCE / (1.0f - cosf(b2_pi / (float)edges)));
+	}
+}
+
+int DebugRenderer::transformCircle(const b2Vec2& center, float radius)
+{
+	float screenRadius = radius * scaleFactor;
+
+	// pick the coarsest table that is still accurate at this size
+	size_t level = 0;
+	while (level + 1 < circleTables.size() && screenRadius > circleMaxRadius[level])
+	{
+		level++;
 	}
 
-	indices[b2_maxPolygonVertices + 1].resize(3 * (CIRCLE_EDGES - 2));
+	const std::vector<b2Vec2>& table = circleTables[level];
+	b2Vec2 c = translateToScreenCoords(center);
 
-	for (size_t j = 0; j < (size_t)CIRCLE_EDGES - 2; j++)
+	// screen y is inverted, same as translateToScreenCoords
+	for (size_t i = 0; i < table.size(); i++)
 	{
-		indices[b2_maxPolygonVertices + 1][3 * j] = 0;
-		indices[b2_maxPolygonVertices + 1][3 * j + 1] = (int)j + 1;
-		indices[b2_maxPolygonVertices + 1][3 * j + 2] = (int)j + 2;
+		screenPoints[i].Set(c.x + screenRadius * table[i].x, c.y - screenRadius * table[i].y);
 	}
+
+	return (int)table.size();
 }
 
 b2Vec2 DebugRenderer::translateToScreenCoords(b2Vec2 vec) const
 {
 	// translate point to camera position
 	vec -= camPos;
-	
+
 	// scale point for rendering
 	vec *= scaleFactor;
 
@@ -53,138 +94,154 @@ b2Vec2 DebugRenderer::translateToScreenCoords(b2Vec2 vec) const
 	return vec;
 }
 
-void DebugRenderer::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+b2Vec2 DebugRenderer::translateToWorldCoords(int x, int y) const
 {
-    SDL_SetRenderDrawColor(base->renderer, (uint8_t)(color.r * 255), (uint8_t)(color.g * 255), (uint8_t)(color.b * 255), (uint8_t)(color.a * 255));
+	b2Vec2 vec((float)(x - base->halfWidth), (float)(base->halfHeight - y));
+	vec *= 1.0f / scaleFactor;
+	vec += camPos;
 
-	for (int i = 0; i < vertexCount; i++)
-	{
-		int j = (i + 1) % vertexCount;
-
-		b2Vec2 v0 = translateToScreenCoords(vertices[i]);
-		b2Vec2 v1 = translateToScreenCoords(vertices[j]);
-
-		SDL_RenderDrawLine(base->renderer, (int)v0.x, (int)v0.y, (int)v1.x, (int)v1.y);
-	}	
+	return vec;
 }
 
-void DebugRenderer::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+b2AABB DebugRenderer::getViewAABB() const
 {
-	// render filled polygon
-	for (int i = 0; i < vertexCount; i++)
-	{
-		SDL_FPoint& point = allocatedVertices[i].position;
+	b2Vec2 extents((float)base->halfWidth / scaleFactor, (float)base->halfHeight / scaleFactor);
 
-		b2Vec2 translatedPoint = translateToScreenCoords(vertices[i]);
+	b2AABB aabb;
+	aabb.lowerBound = camPos - extents;
+	aabb.upperBound = camPos + extents;
 
-		point.x = translatedPoint.x;
-		point.y = translatedPoint.y;
+	return aabb;
+}
 
-		allocatedVertices[i].color.r = (uint8_t)(color.r * 128);
-		allocatedVertices[i].color.g = (uint8_t)(color.g * 128);
-		allocatedVertices[i].color.b = (uint8_t)(color.b * 128);
-		allocatedVertices[i].color.a = 128;
-	}
+void DebugRenderer::flush()
+{
+	drawCallCount = 0;
+	vertexCount = (int)vertices.size();
+	indexCount = (int)indices.size();
 
-	SDL_RenderGeometry(base->renderer, nullptr, allocatedVertices.data(), vertexCount,
-		indices[vertexCount].data(), (int)indices[vertexCount].size());
+	if (!indices.empty())
+	{
+		SDL_RenderGeometry(base->renderer, nullptr, vertices.data(), vertexCount, indices.data(), indexCount);
+		drawCallCount++;
+	}
 
-	// render polygon outline
-	SDL_SetRenderDrawColor(base->renderer, (uint8_t)(color.r * 255), (uint8_t)(color.g * 255), (uint8_t)(color.b * 255), (uint8_t)(color.a * 255));
+	// keep the capacity, the next frame is usually about the same size
+	vertices.clear();
+	indices.clear();
+}
 
-	// SDL coordinates start from top left and y is inverted
-	// adding halfWidth and halfHeight to vertices to center the polygon
+void DebugRenderer::addTriangleFan(const b2Vec2* points, int count, SDL_Color color)
+{
+	int first = (int)vertices.size();
 
-	for (size_t i = 0; i < vertexCount; i++)
+	for (int i = 0; i < count; i++)
 	{
-		size_t j = (i + 1) % vertexCount;
-
-		b2Vec2 v0 = translateToScreenCoords(vertices[i]);
-		b2Vec2 v1 = translateToScreenCoords(vertices[j]);
+		vertices.push_back({ { points[i].x, points[i].y }, color, { 0.0f, 0.0f } });
+	}
 
-		SDL_RenderDrawLine(base->renderer, (int)v0.x, (int)v0.y, (int)v1.x, (int)v1.y);
+	for (int i = 1; i < count - 1; i++)
+	{
+		indices.push_back(first);
+		indices.push_back(first + i);
+		indices.push_back(first + i + 1);
 	}
 }
 
-void DebugRenderer::DrawCircle(const b2Vec2& center, float radius, const b2Color& color)
+void DebugRenderer::addLine(b2Vec2 p0, b2Vec2 p1, SDL_Color color)
 {
-	// render polygon outline
-	SDL_SetRenderDrawColor(base->renderer, (uint8_t)(color.r * 255), (uint8_t)(color.g * 255), (uint8_t)(color.b * 255), (uint8_t)(color.a * 255));
-
-	// SDL coordinates start from top left and y is inverted
-	// adding halfWidth and halfHeight to vertices to center the polygon
+	// lines are thin quads so they go out in the same batch as the fills
+	b2Vec2 d = p1 - p0;
+	float length = d.Normalize();
 
-	for (int i = 0; i < CIRCLE_EDGES; i++)
+	if (length < b2_epsilon)
 	{
-		float angle = 2.0f * b2_pi * (float)i / (float)CIRCLE_EDGES;
-		float nextAngle = 2.0f * b2_pi * (float)(i + 1) / (float)CIRCLE_EDGES;
+		d.Set(1.0f, 0.0f);
+	}
 
-		b2Vec2 v0 = b2Vec2(center.x + radius * cosf(angle), center.y + radius * sinf(angle));
-		b2Vec2 v1 = b2Vec2(center.x + radius * cosf(nextAngle), center.y + radius * sinf(nextAngle));
+	b2Vec2 n = (0.5f * LINE_WIDTH) * b2Vec2(-d.y, d.x);
 
-		v0 = translateToScreenCoords(v0);
-		v1 = translateToScreenCoords(v1);
+	int first = (int)vertices.size();
 
-		SDL_RenderDrawLine(base->renderer, (int)v0.x, (int)v0.y, (int)v1.x, (int)v1.y);
-	}
+	vertices.push_back({ { p0.x + n.x, p0.y + n.y }, color, { 0.0f, 0.0f } });
+	vertices.push_back({ { p1.x + n.x, p1.y + n.y }, color, { 0.0f, 0.0f } });
+	vertices.push_back({ { p1.x - n.x, p1.y - n.y }, color, { 0.0f, 0.0f } });
+	vertices.push_back({ { p0.x - n.x, p0.y - n.y }, color, { 0.0f, 0.0f } });
+
+	indices.push_back(first);
+	indices.push_back(first + 1);
+	indices.push_back(first + 2);
+	indices.push_back(first);
+	indices.push_back(first + 2);
+	indices.push_back(first + 3);
 }
 
-void DebugRenderer::DrawSolidCircle(const b2Vec2& center, float radius, const b2Vec2& axis, const b2Color& color)
+void DebugRenderer::addOutline(const b2Vec2* points, int count, SDL_Color color)
 {
-	// render filled circle
-	for (int i = 0; i < CIRCLE_EDGES; i++)
+	for (int i = 0; i < count; i++)
 	{
-		float angle = 2.0f * b2_pi * (float)i / (float)CIRCLE_EDGES;
+		int j = (i + 1) % count;
 
-		SDL_FPoint& point = allocatedVertices[i].position;
+		addLine(points[i], points[j], color);
+	}
+}
 
-		b2Vec2 translatedPoint = translateToScreenCoords(b2Vec2(center.x + radius * cosf(angle), center.y + radius * sinf(angle)));
+void DebugRenderer::addRect(float x, float y, float w, float h, SDL_Color color)
+{
+	b2Vec2 corners[4] = { b2Vec2(x, y), b2Vec2(x + w, y), b2Vec2(x + w, y + h), b2Vec2(x, y + h) };
 
-		point.x = translatedPoint.x;
-		point.y = translatedPoint.y;
+	addTriangleFan(corners, 4, color);
+}
 
-		allocatedVertices[i].color.r = (uint8_t)(color.r * 128);
-		allocatedVertices[i].color.g = (uint8_t)(color.g * 128);
-		allocatedVertices[i].color.b = (uint8_t)(color.b * 128);
-		allocatedVertices[i].color.a = 128;
+void DebugRenderer::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+{
+	for (int i = 0; i < vertexCount; i++)
+	{
+		screenPoints[i] = translateToScreenCoords(vertices[i]);
 	}
 
-	SDL_RenderGeometry(base->renderer, nullptr, allocatedVertices.data(), CIRCLE_EDGES, indices[b2_maxPolygonVertices + 1].data(), (int)indices[b2_maxPolygonVertices + 1].size());
+	addOutline(screenPoints.data(), vertexCount, lineColor(color));
+}
 
-	// render polygon outline
-	SDL_SetRenderDrawColor(base->renderer, (uint8_t)(color.r * 255), (uint8_t)(color.g * 255), (uint8_t)(color.b * 255), (uint8_t)(color.a * 255));
+void DebugRenderer::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+{
+	for (int i = 0; i < vertexCount; i++)
+	{
+		screenPoints[i] = translateToScreenCoords(vertices[i]);
+	}
 
-	// SDL coordinates start from top left and y is inverted
-	// adding halfWidth and halfHeight to vertices to center the polygon
+	// render filled polygon
+	addTriangleFan(screenPoints.data(), vertexCount, fillColor(color));
 
-	for (int i = 0; i < CIRCLE_EDGES; i++)
-	{
-		float angle = 2.0f * b2_pi * (float)i / (float)CIRCLE_EDGES;
-		float nextAngle = 2.0f * b2_pi * (float)(i + 1) / (float)CIRCLE_EDGES;
+	// render polygon outline
+	addOutline(screenPoints.data(), vertexCount, lineColor(color));
+}
+
+void DebugRenderer::DrawCircle(const b2Vec2& center, float radius, const b2Color& color)
+{
+	int edges = transformCircle(center, radius);
 
-		b2Vec2 v0 = b2Vec2(center.x + radius * cosf(angle), center.y + radius * sinf(angle));
-		b2Vec2 v1 = b2Vec2(center.x + radius * cosf(nextAngle), center.y + radius * sinf(nextAngle));
+	addOutline(screenPoints.data(), edges, lineColor(color));
+}
 
-		v0 = translateToScreenCoords(v0);
-		v1 = translateToScreenCoords(v1);
+void DebugRenderer::DrawSolidCircle(const b2Vec2& center, float radius, const b2Vec2& axis, const b2Color& color)
+{
+	// the same ring feeds the fill and the outline
+	int edges = transformCircle(center, radius);
 
-		SDL_RenderDrawLine(base->renderer, (int)v0.x, (int)v0.y, (int)v1.x, (int)v1.y);
-	}
+	// render filled circle
+	addTriangleFan(screenPoints.data(), edges, fillColor(color));
 
-	b2Vec2 c0 = translateToScreenCoords(center);
-	b2Vec2 c1 = translateToScreenCoords(center + axis);
+	// render circle outline
+	SDL_Color outline = lineColor(color);
+	addOutline(screenPoints.data(), edges, outline);
 
-	SDL_RenderDrawLine(base->renderer, (int)c0.x, (int)c0.y, (int)c1.x, (int)c1.y);
+	addLine(translateToScreenCoords(center), translateToScreenCoords(center + axis), outline);
 }
 
 void DebugRenderer::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color)
 {
-	SDL_SetRenderDrawColor(base->renderer, (uint8_t)(color.r * 255), (uint8_t)(color.g * 255), (uint8_t)(color.b * 255), (uint8_t)(color.a * 255));
-
-	b2Vec2 newp1 = translateToScreenCoords(p1);
-	b2Vec2 newp2 = translateToScreenCoords(p2);
-
-	SDL_RenderDrawLine(base->renderer, (int)newp1.x, (int)newp1.y, (int)newp2.x, (int)newp2.y);
+	addLine(translateToScreenCoords(p1), translateToScreenCoords(p2), lineColor(color));
 }
 
 void DebugRenderer::DrawTransform(const b2Transform& xf)
@@ -204,8 +261,127 @@ void DebugRenderer::DrawPoint(const b2Vec2& p, float size, const b2Color& color)
 {
 	b2Vec2 translatedPos = translateToScreenCoords(p);
 
-	SDL_SetRenderDrawColor(base->renderer, (uint8_t)(color.r * 255), (uint8_t)(color.g * 255), (uint8_t)(color.b * 255), (uint8_t)(color.a * 255));
+	addRect(translatedPos.x - size * 0.5f, translatedPos.y - size * 0.5f, size, size, lineColor(color));
+}
+
+b2Transform DebugRenderer::GetBodyTransform(const b2Body* body) const
+{
+	return interpolateTransform(base->previousTransforms.get(body), body->GetTransform(), base->interpolationAlpha);
+}
+
+void DebugRenderer::drawShape(const WorldSnapshot& snapshot, const WorldSnapshot::Shape& shape, const b2Transform& xf, const b2Color& color, const b2AABB& viewAABB)
+{
+	// same drawing as b2World::DrawShape
+	const b2Vec2* points = snapshot.vertices.data() + shape.firstVertex;
 
-	SDL_Rect rect = { (int)(translatedPos.x - size * 0.5f), (int)(translatedPos.y - size * 0.5f), (int)size, (int)size };
-	SDL_RenderFillRect(base->renderer, &rect);
+	switch (shape.type)
+	{
+	case b2Shape::e_circle:
+		DrawSolidCircle(b2Mul(xf, points[0]), shape.radius, xf.q.GetXAxis(), color);
+		break;
+	case b2Shape::e_edge:
+	{
+		b2Vec2 v1 = b2Mul(xf, points[0]);
+		b2Vec2 v2 = b2Mul(xf, points[1]);
+		DrawSegment(v1, v2, color);
+
+		if (!shape.oneSided)
+		{
+			DrawPoint(v1, 4.0f, color);
+			DrawPoint(v2, 4.0f, color);
+		}
+		break;
+	}
+	case b2Shape::e_chain:
+	{
+		// long terrains are mostly off screen, only draw the edges in view
+		b2Vec2 v1 = b2Mul(xf, points[0]);
+		for (int i = 1; i < shape.vertexCount; i++)
+		{
+			b2Vec2 v2 = b2Mul(xf, points[i]);
+
+			b2AABB aabb;
+			aabb.lowerBound = b2Min(v1, v2);
+			aabb.upperBound = b2Max(v1, v2);
+			if (b2TestOverlap(aabb, viewAABB)) DrawSegment(v1, v2, color);
+
+			v1 = v2;
+		}
+		break;
+	}
+	case b2Shape::e_polygon:
+	{
+		b2Vec2 vertices[b2_maxPolygonVertices];
+
+		for (int i = 0; i < shape.vertexCount; i++)
+		{
+			vertices[i] = b2Mul(xf, points[i]);
+		}
+
+		DrawSolidPolygon(vertices, shape.vertexCount, color);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void DebugRenderer::drawSnapshot(const WorldSnapshot& snapshot, float alpha)
+{
+	b2AABB viewAABB = getViewAABB();
+	uint32 flags = GetFlags();
+
+	for (const WorldSnapshot::Body& body : snapshot.bodies)
+	{
+		b2Transform xf;
+		bool transformed = false;
+
+		for (int i = body.firstShape; i < body.firstShape + body.shapeCount; i++)
+		{
+			const WorldSnapshot::Shape& shape = snapshot.shapes[i];
+			if (!b2TestOverlap(shape.aabb, viewAABB)) continue;
+
+			if (!transformed)
+			{
+				xf = interpolateTransform(body.previous, body.current, alpha);
+				transformed = true;
+			}
+
+			if (flags & e_shapeBit) drawShape(snapshot, shape, xf, body.color, viewAABB);
+
+			if (flags & e_aabbBit)
+			{
+				b2Vec2 vs[4] =
+				{
+					shape.aabb.lowerBound, b2Vec2(shape.aabb.upperBound.x, shape.aabb.lowerBound.y),
+					shape.aabb.upperBound, b2Vec2(shape.aabb.lowerBound.x, shape.aabb.upperBound.y)
+				};
+				DrawPolygon(vs, 4, b2Color(0.9f, 0.3f, 0.9f));
+			}
+		}
+
+		if (transformed && (flags & e_centerOfMassBit))
+		{
+			xf.p = b2Mul(xf, body.localCenter);
+			DrawTransform(xf);
+		}
+	}
+
+	if (flags & e_jointBit)
+	{
+		for (size_t i = 0; i + 1 < snapshot.jointAnchors.size(); i += 2)
+		{
+			DrawSegment(snapshot.jointAnchors[i], snapshot.jointAnchors[i + 1], b2Color(0.5f, 0.8f, 0.8f));
+		}
+	}
+
+	// contact points take the place of broad-phase pairs
+	if (flags & e_pairBit)
+	{
+		for (const b2Vec2& p : snapshot.contactPoints)
+		{
+			b2AABB point = { p, p };
+			if (viewAABB.Contains(point)) DrawPoint(p, 4.0f, b2Color(0.3f, 0.9f, 0.9f));
+		}
+	}
 }
\ No newline at end of file
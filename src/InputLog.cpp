@@ -0,0 +1,233 @@
+#include <InputLog.h>
+#include <stdio.h>
+#include <string.h>
+
+// "B2IN" and the layout version, values are stored in native byte order
+static const uint32_t LOG_MAGIC = 0x4E493242;
+static const uint32_t LOG_VERSION = 1;
+
+// the dynamic body with a fixture under the point, the first one the tree reports
+class PointQuery : public b2QueryCallback
+{
+public:
+	b2Vec2 point;
+	b2Body* body = nullptr;
+
+	bool ReportFixture(b2Fixture* fixture) override
+	{
+		b2Body* b = fixture->GetBody();
+		if (b->GetType() != b2_dynamicBody || !fixture->TestPoint(point)) return true;
+
+		body = b;
+		return false;
+	}
+};
+
+b2Body* InputController::findBody(b2World* world, const b2Vec2& point) const
+{
+	PointQuery query;
+	query.point = point;
+
+	b2AABB aabb;
+	aabb.lowerBound = point - b2Vec2(0.001f, 0.001f);
+	aabb.upperBound = point + b2Vec2(0.001f, 0.001f);
+	world->QueryAABB(&query, aabb);
+
+	return query.body;
+}
+
+void InputController::apply(b2World* world, const InputEvent& e)
+{
+	switch (e.type)
+	{
+	case InputType::grab:
+	{
+		if (mouseJoint) break;
+
+		b2Body* body = findBody(world, e.point);
+		if (body == nullptr) break;
+
+		// the mouse joint ignores its first body, it only has to be another one
+		if (groundBody == nullptr)
+		{
+			b2BodyDef bd;
+			groundBody = world->CreateBody(&bd);
+		}
+
+		b2MouseJointDef md;
+		md.bodyA = groundBody;
+		md.bodyB = body;
+		md.target = e.point;
+		md.maxForce = 1000.0f * body->GetMass();
+		b2LinearStiffness(md.stiffness, md.damping, 5.0f, 0.7f, groundBody, body);
+
+		mouseJoint = (b2MouseJoint*)world->CreateJoint(&md);
+		body->SetAwake(true);
+		break;
+	}
+	case InputType::drag:
+		if (mouseJoint) mouseJoint->SetTarget(e.point);
+		break;
+	case InputType::release:
+		if (mouseJoint)
+		{
+			world->DestroyJoint(mouseJoint);
+			mouseJoint = nullptr;
+		}
+		break;
+	case InputType::spawn:
+	{
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position = e.point;
+		b2Body* body = world->CreateBody(&bd);
+
+		b2PolygonShape shape;
+		shape.SetAsBox(0.5f, 0.5f);
+		b2FixtureDef fd;
+		fd.shape = &shape;
+		fd.density = 1.0f;
+		fd.friction = 0.6f;
+		body->CreateFixture(&fd);
+		break;
+	}
+	case InputType::remove:
+	{
+		b2Body* body = findBody(world, e.point);
+		if (body == nullptr) break;
+
+		// destroying the body destroys its joints
+		if (mouseJoint && mouseJoint->GetBodyB() == body) mouseJoint = nullptr;
+		world->DestroyBody(body);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void InputLog::record(const InputEvent& e)
+{
+	if (e.type == InputType::drag && !events.empty())
+	{
+		InputEvent& last = events.back();
+		if (last.type == InputType::drag && last.step == e.step)
+		{
+			last.point = e.point;
+			return;
+		}
+	}
+
+	events.push_back(e);
+}
+
+template <typename T>
+static bool writeValue(FILE* file, const T& value)
+{
+	return fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+template <typename T>
+static bool readValue(FILE* file, T* value)
+{
+	return fread(value, sizeof(T), 1, file) == 1;
+}
+
+bool InputLog::save(const char* path) const
+{
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr) return false;
+
+	uint32_t pathLength = (uint32_t)worldPath.size();
+	uint32_t eventCount = (uint32_t)events.size();
+
+	bool written = writeValue(file, LOG_MAGIC) && writeValue(file, LOG_VERSION);
+	written = written && writeValue(file, (int32_t)scene) && writeValue(file, (int32_t)bodyCount);
+	written = written && writeValue(file, pathLength) && fwrite(worldPath.data(), 1, pathLength, file) == pathLength;
+	written = written && writeValue(file, timeStep) && writeValue(file, (int32_t)velocityIterations);
+	written = written && writeValue(file, (int32_t)positionIterations) && writeValue(file, (int32_t)solverWidth);
+	written = written && writeValue(file, stepCount) && writeValue(file, eventCount);
+
+	// 13 bytes per event, without the padding of InputEvent
+	for (const InputEvent& e : events)
+	{
+		written = written && writeValue(file, e.step) && writeValue(file, (uint8_t)e.type);
+		written = written && writeValue(file, e.point.x) && writeValue(file, e.point.y);
+	}
+
+	return fclose(file) == 0 && written;
+}
+
+bool InputLog::load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr) return false;
+
+	uint32_t magic = 0, version = 0, pathLength = 0, eventCount = 0;
+	int32_t sceneIndex = 0, bodies = 0, velocity = 0, position = 0, width = 0;
+
+	bool valid = readValue(file, &magic) && magic == LOG_MAGIC && readValue(file, &version) && version == LOG_VERSION;
+	valid = valid && readValue(file, &sceneIndex) && sceneIndex >= 0 && sceneIndex < (int32_t)SceneType::count;
+	valid = valid && readValue(file, &bodies) && readValue(file, &pathLength) && pathLength < 4096;
+
+	if (valid)
+	{
+		worldPath.resize(pathLength);
+		valid = fread(&worldPath[0], 1, pathLength, file) == pathLength;
+	}
+
+	valid = valid && readValue(file, &timeStep) && readValue(file, &velocity) && readValue(file, &position);
+	valid = valid && readValue(file, &width) && readValue(file, &stepCount) && readValue(file, &eventCount);
+
+	events.clear();
+	for (uint32_t i = 0; i < eventCount && valid; i++)
+	{
+		InputEvent e;
+		uint8_t type = 0;
+		valid = readValue(file, &e.step) && readValue(file, &type) && type < (uint8_t)InputType::count;
+		valid = valid && readValue(file, &e.point.x) && readValue(file, &e.point.y);
+		valid = valid && (events.empty() || events.back().step <= e.step);
+
+		e.type = (InputType)type;
+		if (valid) events.push_back(e);
+	}
+
+	fclose(file);
+
+	scene = (SceneType)sceneIndex;
+	bodyCount = bodies;
+	velocityIterations = velocity;
+	positionIterations = position;
+	solverWidth = width;
+
+	return valid;
+}
+
+static void hashBytes(uint64_t* hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		*hash ^= bytes[i];
+		*hash *= 1099511628211ull;
+	}
+}
+
+uint64_t hashWorldState(const b2World* world)
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	for (const b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		const b2Transform& xf = b->GetTransform();
+		b2Vec2 v = b->GetLinearVelocity();
+		float w = b->GetAngularVelocity();
+
+		hashBytes(&hash, &xf.p, sizeof(xf.p));
+		hashBytes(&hash, &xf.q, sizeof(xf.q));
+		hashBytes(&hash, &v, sizeof(v));
+		hashBytes(&hash, &w, sizeof(w));
+	}
+
+	return hash;
+}
@@ -0,0 +1,203 @@
+#include <PerformanceHud.h>
+#include <algorithm>
+#include <stdio.h>
+
+static const SDL_Color panelColor = { 0, 0, 0, 170 };
+static const SDL_Color textColor = { 230, 230, 230, 255 };
+static const SDL_Color frameColor = { 110, 200, 110, 255 };
+static const SDL_Color stepColor = { 230, 160, 70, 255 };
+static const SDL_Color markColor = { 255, 255, 255, 90 };
+
+// rows of 3 pixels from the top, '#' is lit
+static const struct
+{
+	char c;
+	const char* rows;
+} fontGlyphs[] = {
+	{ '0', "###" "#.#" "#.#" "#.#" "###" }, { '1', ".#." "##." ".#." ".#." "###" },
+	{ '2', "###" "..#" "###" "#.." "###" }, { '3', "###" "..#" "###" "..#" "###" },
+	{ '4', "#.#" "#.#" "###" "..#" "..#" }, { '5', "###" "#.." "###" "..#" "###" },
+	{ '6', "###" "#.." "###" "#.#" "###" }, { '7', "###" "..#" "..#" "..#" "..#" },
+	{ '8', "###" "#.#" "###" "#.#" "###" }, { '9', "###" "#.#" "###" "..#" "###" },
+	{ 'A', ".#." "#.#" "###" "#.#" "#.#" }, { 'B', "##." "#.#" "##." "#.#" "##." },
+	{ 'C', ".##" "#.." "#.." "#.." ".##" }, { 'D', "##." "#.#" "#.#" "#.#" "##." },
+	{ 'E', "###" "#.." "##." "#.." "###" }, { 'F', "###" "#.." "##." "#.." "#.." },
+	{ 'G', ".##" "#.." "#.#" "#.#" ".##" }, { 'H', "#.#" "#.#" "###" "#.#" "#.#" },
+	{ 'I', "###" ".#." ".#." ".#." "###" }, { 'J', "..#" "..#" "..#" "#.#" ".#." },
+	{ 'K', "#.#" "#.#" "##." "#.#" "#.#" }, { 'L', "#.." "#.." "#.." "#.." "###" },
+	{ 'M', "#.#" "###" "###" "#.#" "#.#" }, { 'N', "##." "#.#" "#.#" "#.#" "#.#" },
+	{ 'O', ".#." "#.#" "#.#" "#.#" ".#." }, { 'P', "##." "#.#" "##." "#.." "#.." },
+	{ 'Q', ".#." "#.#" "#.#" "##." ".##" }, { 'R', "##." "#.#" "##." "#.#" "#.#" },
+	{ 'S', ".##" "#.." ".#." "..#" "##." }, { 'T', "###" ".#." ".#." ".#." ".#." },
+	{ 'U', "#.#" "#.#" "#.#" "#.#" "###" }, { 'V', "#.#" "#.#" "#.#" "#.#" ".#." },
+	{ 'W', "#.#" "#.#" "###" "###" "#.#" }, { 'X', "#.#" "#.#" ".#." "#.#" "#.#" },
+	{ 'Y', "#.#" "#.#" ".#." ".#." ".#." }, { 'Z', "###" "..#" ".#." "#.." "###" },
+	{ '.', "..." "..." "..." "..." ".#." }, { ':', "..." ".#." "..." ".#." "..." },
+	{ '/', "..#" "..#" ".#." "#.." "#.." }, { '-', "..." "..." "###" "..." "..." },
+	{ '%', "#.#" "..#" ".#." "#.." "#.#" }, { '(', ".#." "#.." "#.." "#.." ".#." },
+	{ ')', ".#." "..#" "..#" "..#" ".#." },
+};
+
+PerformanceHud::PerformanceHud()
+{
+	for (const auto& glyph : fontGlyphs)
+	{
+		uint16_t bits = 0;
+		for (int i = 0; i < 15; i++)
+		{
+			if (glyph.rows[i] == '#') bits |= 1 << (14 - i);
+		}
+		glyphs[(int)glyph.c] = bits;
+	}
+}
+
+void PerformanceHud::addRect(std::vector<SDL_Vertex>& vertices, std::vector<int>& indices,
+	float x, float y, float w, float h, SDL_Color color)
+{
+	int first = (int)vertices.size();
+
+	vertices.push_back({ { x, y }, color, { 0.0f, 0.0f } });
+	vertices.push_back({ { x + w, y }, color, { 0.0f, 0.0f } });
+	vertices.push_back({ { x + w, y + h }, color, { 0.0f, 0.0f } });
+	vertices.push_back({ { x, y + h }, color, { 0.0f, 0.0f } });
+
+	indices.push_back(first);
+	indices.push_back(first + 1);
+	indices.push_back(first + 2);
+	indices.push_back(first);
+	indices.push_back(first + 2);
+	indices.push_back(first + 3);
+}
+
+float PerformanceHud::addText(float x, float y, const char* text, SDL_Color color)
+{
+	float cursor = x;
+
+	for (const char* c = text; *c; c++)
+	{
+		int code = toupper((unsigned char)*c);
+		uint16_t bits = code < 128 ? glyphs[code] : 0;
+
+		for (int i = 0; i < 15; i++)
+		{
+			if (bits & (1 << (14 - i)))
+			{
+				addRect(textVertices, textIndices, cursor + (float)(i % 3) * PIXEL, y + (float)(i / 3) * PIXEL, PIXEL, PIXEL, color);
+			}
+		}
+
+		cursor += 4.0f * PIXEL;
+	}
+
+	return y + 7.0f * PIXEL;
+}
+
+void PerformanceHud::addGraph(float x, float y, const float* values, float scale, float markValue, SDL_Color color)
+{
+	// oldest sample on the left, one pixel per frame
+	for (int i = 0; i < HISTORY; i++)
+	{
+		float value = values[(historyIndex + i) % HISTORY];
+		float h = std::min(value / scale, 1.0f) * GRAPH_HEIGHT;
+		if (h > 0.0f) addRect(vertices, indices, x + (float)i, y + GRAPH_HEIGHT - h, 1.0f, h, color);
+	}
+
+	if (markValue < scale)
+	{
+		addRect(vertices, indices, x, y + GRAPH_HEIGHT - markValue / scale * GRAPH_HEIGHT, (float)HISTORY, 1.0f, markColor);
+	}
+}
+
+void PerformanceHud::addFrame(float frameTime, float stepTime)
+{
+	float frameMs = 1000.0f * frameTime;
+
+	frameTimes[historyIndex] = frameMs;
+	stepTimes[historyIndex] = stepTime;
+	historyIndex = (historyIndex + 1) % HISTORY;
+
+	intervalTime += frameTime;
+	intervalFrames++;
+	frameSum += frameMs;
+	frameMax = std::max(frameMax, frameMs);
+	stepSum += stepTime;
+	stepMax = std::max(stepMax, stepTime);
+
+	if (intervalTime >= TEXT_INTERVAL)
+	{
+		shownFrameTime = frameSum / (float)intervalFrames;
+		shownFrameMax = frameMax;
+		shownStepTime = stepSum / (float)intervalFrames;
+		shownStepMax = stepMax;
+
+		// the step graph scales to the slowest step it shows
+		float historyMax = *std::max_element(stepTimes, stepTimes + HISTORY);
+		stepScale = std::max(1.25f * historyMax, 1.0f);
+
+		intervalTime = 0.0f;
+		intervalFrames = 0;
+		frameSum = frameMax = stepSum = stepMax = 0.0f;
+		textDirty = true;
+	}
+}
+
+void PerformanceHud::rebuildText(const WorldStats& stats, int drawCalls, int vertexCount, int indexCount)
+{
+	textVertices.clear();
+	textIndices.clear();
+
+	const b2Profile& p = stats.profile;
+	char line[128];
+	float x = 16.0f;
+	float y = 16.0f;
+
+	snprintf(line, sizeof(line), "FPS %.0f  FRAME %.2f MS  MAX %.2f",
+		shownFrameTime > 0.0f ? 1000.0f / shownFrameTime : 0.0f, shownFrameTime, shownFrameMax);
+	y = addText(x, y, line, frameColor);
+	y += GRAPH_HEIGHT + 2.0f * PIXEL;
+
+	snprintf(line, sizeof(line), "STEP %.2f MS  MAX %.2f  GRAPH %.1f MS", shownStepTime, shownStepMax, stepScale);
+	y = addText(x, y, line, stepColor);
+	y += GRAPH_HEIGHT + 2.0f * PIXEL;
+
+	snprintf(line, sizeof(line), "LAST STEP %.2f  COLLIDE %.2f  SOLVE %.2f  TOI %.2f", p.step, p.collide, p.solve, p.solveTOI);
+	y = addText(x, y, line, textColor);
+	snprintf(line, sizeof(line), "INIT %.2f  VELOCITY %.2f  POSITION %.2f  BROADPHASE %.2f",
+		p.solveInit, p.solveVelocity, p.solvePosition, p.broadphase);
+	y = addText(x, y, line, textColor);
+	snprintf(line, sizeof(line), "BODIES %d  CONTACTS %d  ISLANDS %d", stats.bodyCount, stats.contactCount, stats.islandCount);
+	y = addText(x, y, line, textColor);
+	snprintf(line, sizeof(line), "PROXIES %d  TREE HEIGHT %d", stats.proxyCount, stats.treeHeight);
+	y = addText(x, y, line, textColor);
+	snprintf(line, sizeof(line), "DRAW CALLS %d  VERTICES %d  INDICES %d", drawCalls, vertexCount, indexCount);
+	y = addText(x, y, line, textColor);
+
+	textHeight = y;
+	textDirty = false;
+}
+
+void PerformanceHud::draw(SDL_Renderer* renderer, const WorldStats& stats, int drawCalls, int vertexCount, int indexCount)
+{
+	if (!visible) return;
+
+	if (textDirty) rebuildText(stats, drawCalls, vertexCount, indexCount);
+
+	vertices.clear();
+	indices.clear();
+
+	// panel wide enough for the longest line, 60 characters
+	addRect(vertices, indices, 8.0f, 8.0f, 16.0f + 60.0f * 4.0f * PIXEL, textHeight, panelColor);
+
+	float graphY = 16.0f + 7.0f * PIXEL;
+	addGraph(16.0f, graphY, frameTimes, 100.0f / 3.0f, 1000.0f / 60.0f, frameColor);
+	addGraph(16.0f, graphY + GRAPH_HEIGHT + 9.0f * PIXEL, stepTimes, stepScale, 1000.0f / 60.0f, stepColor);
+
+	int first = (int)vertices.size();
+	vertices.insert(vertices.end(), textVertices.begin(), textVertices.end());
+	for (int index : textIndices)
+	{
+		indices.push_back(first + index);
+	}
+
+	SDL_RenderGeometry(renderer, nullptr, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+}
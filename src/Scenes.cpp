@@ -0,0 +1,462 @@
+#include <Scenes.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+static const char* sceneNames[(int)SceneType::count] =
+{
+    "test",
+    "pyramids",
+    "circles",
+    "chains",
+    "ragdolls",
+    "terrain",
+    "sleeping"
+};
+
+const char* getSceneName(SceneType type)
+{
+    return sceneNames[(int)type];
+}
+
+bool findScene(const char* name, SceneType* type)
+{
+    for (int i = 0; i < (int)SceneType::count; i++)
+    {
+        if (strcmp(name, sceneNames[i]) == 0)
+        {
+            *type = (SceneType)i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// small deterministic generator so every run builds the same scene
+static uint32 seed = 12345;
+
+static float randomFloat(float lo, float hi)
+{
+    seed = seed * 1664525u + 1013904223u;
+    float t = (float)(seed >> 8) / (float)(1 << 24);
+    return lo + t * (hi - lo);
+}
+
+static b2Body* createGround(b2World* world, float halfWidth, b2Vec2 center = b2Vec2(0.0f, -1.0f))
+{
+    b2BodyDef bd;
+    bd.position = center;
+    b2Body* ground = world->CreateBody(&bd);
+
+    b2PolygonShape shape;
+    shape.SetAsBox(halfWidth, 1.0f);
+    ground->CreateFixture(&shape, 0.0f);
+
+    return ground;
+}
+
+static void createTestBodies(b2World* world)
+{
+    // box0
+    b2BodyDef boxBodyDef;
+    boxBodyDef.type = b2_dynamicBody;
+    boxBodyDef.position.Set(0.0f, 0.0f);
+    b2Body* boxBody = world->CreateBody(&boxBodyDef);
+
+    b2PolygonShape boxShape;
+    boxShape.SetAsBox(1.0f, 1.0f);
+    boxBody->CreateFixture(&boxShape, 1.0f);
+
+    boxBody->SetAngularVelocity(1.0);
+
+    // box1
+    boxBodyDef.position.Set(0.6f, 2.5f);
+    boxBody = world->CreateBody(&boxBodyDef);
+
+    boxShape.SetAsBox(1.0f, 1.0f);
+    boxBody->CreateFixture(&boxShape, 1.0f);
+
+    // second fixture for box1
+    boxShape.SetAsBox(0.5f, 0.5f, b2Vec2(0.0f, 0.8f), b2_pi * 0.25f);
+    boxBody->CreateFixture(&boxShape, 1.0f);
+
+    // static box
+    boxBodyDef.type = b2_staticBody;
+    boxBodyDef.position.Set(0.0f, -10.0f);
+    boxBody = world->CreateBody(&boxBodyDef);
+
+    boxShape.SetAsBox(100.0f, 1.0f);
+    boxBody->CreateFixture(&boxShape, 1.0f);
+
+    // circle
+    b2BodyDef circleBodyDef;
+    circleBodyDef.type = b2_dynamicBody;
+    circleBodyDef.position.Set(5.0f, 0.0f);
+    b2Body* circleBody = world->CreateBody(&circleBodyDef);
+
+    b2CircleShape circleShape;
+    circleShape.m_radius = 1.0f;
+    circleBody->CreateFixture(&circleShape, 1.0f);
+
+    circleBody->SetAngularVelocity(8.0);
+
+    b2MouseJointDef jDef;
+    jDef.bodyA = boxBody;
+    jDef.bodyB = circleBody;
+    jDef.collideConnected = true;
+
+    jDef.target = circleBody->GetPosition() - b2Vec2(1.0, 0.0);
+    jDef.maxForce = circleBody->GetMass() * 20.0f;
+
+    b2LinearStiffness(jDef.stiffness, jDef.damping, 1.0f, 0.0f, jDef.bodyA, jDef.bodyB);
+
+    b2MouseJoint* mj = (b2MouseJoint*)world->CreateJoint(&jDef);
+
+    b2Vec2 nextTarget = b2Vec2(0.0, -3.0);
+    mj->SetTarget(nextTarget);
+}
+
+// same layout as the testbed pyramid, repeated until bodyCount boxes exist
+static void createPyramids(b2World* world, int bodyCount)
+{
+    const int baseCount = 20;
+    const int perPyramid = baseCount * (baseCount + 1) / 2;
+    const float spacing = 25.0f;
+
+    int pyramidCount = (bodyCount + perPyramid - 1) / perPyramid;
+    float halfWidth = 0.5f * spacing * (float)pyramidCount + 10.0f;
+
+    createGround(world, halfWidth);
+
+    float a = 0.5f;
+    b2PolygonShape shape;
+    shape.SetAsBox(a, a);
+
+    b2BodyDef bd;
+    bd.type = b2_dynamicBody;
+
+    int created = 0;
+    for (int p = 0; p < pyramidCount; p++)
+    {
+        b2Vec2 x(-halfWidth + 10.0f + spacing * (float)p, 0.5f);
+        b2Vec2 deltaX(0.5625f, 1.0f);
+        b2Vec2 deltaY(1.125f, 0.0f);
+
+        for (int i = 0; i < baseCount && created < bodyCount; i++)
+        {
+            b2Vec2 y = x;
+
+            for (int j = i; j < baseCount && created < bodyCount; j++)
+            {
+                bd.position = y;
+                world->CreateBody(&bd)->CreateFixture(&shape, 5.0f);
+                created++;
+
+                y += deltaY;
+            }
+
+            x += deltaX;
+        }
+    }
+}
+
+static void createCirclePile(b2World* world, int bodyCount)
+{
+    const float radius = 0.5f;
+    const float spacing = 2.2f * radius;
+
+    int columns = std::max(10, (int)sqrtf((float)bodyCount));
+    int rows = (bodyCount + columns - 1) / columns;
+
+    float halfWidth = 0.5f * spacing * (float)columns + 1.0f;
+    float wallHalfHeight = 0.5f * spacing * (float)rows + 5.0f;
+
+    b2Body* ground = createGround(world, halfWidth + 1.0f);
+
+    b2PolygonShape wall;
+    wall.SetAsBox(1.0f, wallHalfHeight, b2Vec2(-halfWidth - 1.0f, wallHalfHeight), 0.0f);
+    ground->CreateFixture(&wall, 0.0f);
+    wall.SetAsBox(1.0f, wallHalfHeight, b2Vec2(halfWidth + 1.0f, wallHalfHeight), 0.0f);
+    ground->CreateFixture(&wall, 0.0f);
+
+    b2CircleShape shape;
+    shape.m_radius = radius;
+
+    b2FixtureDef fd;
+    fd.shape = &shape;
+    fd.density = 1.0f;
+    fd.friction = 0.4f;
+
+    b2BodyDef bd;
+    bd.type = b2_dynamicBody;
+
+    for (int i = 0; i < bodyCount; i++)
+    {
+        int row = i / columns;
+        int column = i % columns;
+
+        // jitter so the pile does not settle into a perfect lattice
+        bd.position.Set(-halfWidth + spacing * ((float)column + 0.5f) + randomFloat(-0.05f, 0.05f),
+            radius + spacing * (float)row);
+
+        world->CreateBody(&bd)->CreateFixture(&fd);
+    }
+}
+
+static void createChains(b2World* world, int bodyCount)
+{
+    const int linkCount = 20;
+    const float linkLength = 1.0f;
+    const float spacing = 2.0f;
+
+    int chainCount = (bodyCount + linkCount - 1) / linkCount;
+    float halfWidth = 0.5f * spacing * (float)chainCount + 5.0f;
+    float top = linkLength * (float)linkCount + 5.0f;
+
+    b2Body* ground = createGround(world, halfWidth);
+
+    b2PolygonShape shape;
+    shape.SetAsBox(0.125f, 0.5f * linkLength);
+
+    b2FixtureDef fd;
+    fd.shape = &shape;
+    fd.density = 20.0f;
+    fd.friction = 0.2f;
+
+    b2BodyDef bd;
+    bd.type = b2_dynamicBody;
+
+    b2RevoluteJointDef jd;
+    jd.collideConnected = false;
+
+    int created = 0;
+    for (int c = 0; c < chainCount && created < bodyCount; c++)
+    {
+        float x = -halfWidth + 5.0f + spacing * (float)c;
+
+        b2Body* prevBody = ground;
+        for (int i = 0; i < linkCount && created < bodyCount; i++)
+        {
+            bd.position.Set(x, top - linkLength * ((float)i + 0.5f));
+            b2Body* body = world->CreateBody(&bd);
+            body->CreateFixture(&fd);
+            created++;
+
+            jd.Initialize(prevBody, body, b2Vec2(x, top - linkLength * (float)i));
+            world->CreateJoint(&jd);
+
+            prevBody = body;
+        }
+
+        // push the free end so the chains swing into each other
+        prevBody->SetLinearVelocity(b2Vec2(randomFloat(-10.0f, 10.0f), 0.0f));
+    }
+}
+
+static void createRagdolls(b2World* world, int bodyCount)
+{
+    const int partCount = 6;
+    const float spacingX = 2.0f;
+    const float spacingY = 3.0f;
+
+    int ragdollCount = (bodyCount + partCount - 1) / partCount;
+    int columns = std::max(10, (int)sqrtf((float)ragdollCount * 4.0f));
+    float halfWidth = 0.5f * spacingX * (float)columns + 2.0f;
+
+    createGround(world, halfWidth);
+
+    b2BodyDef bd;
+    bd.type = b2_dynamicBody;
+
+    b2PolygonShape torso, arm, leg;
+    torso.SetAsBox(0.3f, 0.5f);
+    arm.SetAsBox(0.1f, 0.35f);
+    leg.SetAsBox(0.12f, 0.45f);
+
+    b2CircleShape head;
+    head.m_radius = 0.25f;
+
+    b2FixtureDef fd;
+    fd.density = 1.0f;
+    fd.friction = 0.4f;
+
+    b2RevoluteJointDef jd;
+    jd.enableLimit = true;
+
+    int created = 0;
+    for (int r = 0; r < ragdollCount && created < bodyCount; r++)
+    {
+        b2Vec2 origin(-halfWidth + 2.0f + spacingX * (float)(r % columns), 2.5f + spacingY * (float)(r / columns));
+
+        // parts of one ragdoll never collide with each other
+        fd.filter.groupIndex = (int16)-(1 + r % 32000);
+
+        const b2Shape* shapes[partCount] = { &torso, &head, &arm, &arm, &leg, &leg };
+        const b2Vec2 offsets[partCount] =
+        {
+            b2Vec2(0.0f, 0.0f), b2Vec2(0.0f, 0.8f),
+            b2Vec2(-0.4f, 0.1f), b2Vec2(0.4f, 0.1f),
+            b2Vec2(-0.15f, -0.9f), b2Vec2(0.15f, -0.9f)
+        };
+        const b2Vec2 anchors[partCount] =
+        {
+            b2Vec2(0.0f, 0.0f), b2Vec2(0.0f, 0.55f),
+            b2Vec2(-0.3f, 0.4f), b2Vec2(0.3f, 0.4f),
+            b2Vec2(-0.15f, -0.5f), b2Vec2(0.15f, -0.5f)
+        };
+
+        b2Body* parts[partCount] = {};
+        for (int i = 0; i < partCount && created < bodyCount; i++)
+        {
+            bd.position = origin + offsets[i];
+            bd.angle = randomFloat(-0.1f, 0.1f);
+            parts[i] = world->CreateBody(&bd);
+
+            fd.shape = shapes[i];
+            parts[i]->CreateFixture(&fd);
+            created++;
+
+            if (i > 0)
+            {
+                jd.Initialize(parts[0], parts[i], origin + anchors[i]);
+                jd.lowerAngle = -0.25f * b2_pi;
+                jd.upperAngle = 0.25f * b2_pi;
+                world->CreateJoint(&jd);
+            }
+        }
+    }
+}
+
+static void createTerrain(b2World* world, int bodyCount)
+{
+    const float step = 1.0f;
+    const float spacing = 1.5f;
+
+    int vertexCount = std::max(200, bodyCount / 4);
+    float halfWidth = 0.5f * step * (float)(vertexCount - 1);
+
+    std::vector<b2Vec2> vertices(vertexCount);
+    for (int i = 0; i < vertexCount; i++)
+    {
+        float x = -halfWidth + step * (float)i;
+        vertices[i].Set(x, 2.0f * sinf(0.05f * x) + 0.5f * sinf(0.31f * x) + 0.2f * sinf(1.7f * x));
+    }
+
+    b2BodyDef groundDef;
+    b2Body* ground = world->CreateBody(&groundDef);
+
+    b2ChainShape chain;
+    chain.CreateChain(vertices.data(), vertexCount, vertices[0] - b2Vec2(step, 0.0f), vertices[vertexCount - 1] + b2Vec2(step, 0.0f));
+    ground->CreateFixture(&chain, 0.0f);
+
+    b2PolygonShape box;
+    box.SetAsBox(0.4f, 0.4f);
+
+    b2CircleShape circle;
+    circle.m_radius = 0.4f;
+
+    b2BodyDef bd;
+    bd.type = b2_dynamicBody;
+
+    int columns = std::max(1, (int)(2.0f * halfWidth / spacing));
+    for (int i = 0; i < bodyCount; i++)
+    {
+        int row = i / columns;
+        int column = i % columns;
+
+        bd.position.Set(-halfWidth + spacing * ((float)column + 0.5f), 5.0f + spacing * (float)row);
+        b2Body* body = world->CreateBody(&bd);
+
+        if (i % 2 == 0)
+        {
+            body->CreateFixture(&box, 1.0f);
+        }
+        else
+        {
+            body->CreateFixture(&circle, 1.0f);
+        }
+    }
+}
+
+static void createSleeping(b2World* world, int bodyCount)
+{
+    const int stackHeight = 5;
+    const int stacksPerPlatform = 100;
+    const float spacing = 1.5f;
+    const float platformGap = 12.0f;
+
+    int stackCount = (bodyCount + stackHeight - 1) / stackHeight;
+    int platformCount = (stackCount + stacksPerPlatform - 1) / stacksPerPlatform;
+    float halfWidth = 0.5f * spacing * (float)stacksPerPlatform;
+
+    b2PolygonShape box;
+    box.SetAsBox(0.5f, 0.5f);
+
+    b2BodyDef bd;
+    bd.type = b2_dynamicBody;
+
+    int created = 0;
+    for (int p = 0; p < platformCount; p++)
+    {
+        float base = platformGap * (float)p;
+        createGround(world, halfWidth, b2Vec2(0.0f, base - 1.0f));
+
+        for (int s = 0; s < stacksPerPlatform && created < bodyCount; s++)
+        {
+            float x = -halfWidth + spacing * ((float)s + 0.5f);
+
+            bd.awake = false;
+            for (int k = 0; k < stackHeight && created < bodyCount; k++)
+            {
+                bd.position.Set(x, base + 0.5f + (float)k);
+                world->CreateBody(&bd)->CreateFixture(&box, 1.0f);
+                created++;
+            }
+
+            // every 25th stack gets hit by a falling box and wakes up
+            if (s % 25 == 0 && created < bodyCount)
+            {
+                bd.awake = true;
+                bd.position.Set(x, base + (float)stackHeight + 3.0f);
+                world->CreateBody(&bd)->CreateFixture(&box, 1.0f);
+                created++;
+            }
+        }
+    }
+}
+
+void createScene(b2World* world, SceneType type, int bodyCount)
+{
+    seed = 12345;
+
+    switch (type)
+    {
+    case SceneType::pyramids:
+        createPyramids(world, bodyCount);
+        break;
+    case SceneType::circlePile:
+        createCirclePile(world, bodyCount);
+        break;
+    case SceneType::chains:
+        createChains(world, bodyCount);
+        break;
+    case SceneType::ragdolls:
+        createRagdolls(world, bodyCount);
+        break;
+    case SceneType::terrain:
+        createTerrain(world, bodyCount);
+        break;
+    case SceneType::sleeping:
+        createSleeping(world, bodyCount);
+        break;
+    default:
+        createTestBodies(world);
+        break;
+    }
+
+    // fixtures were inserted into the broad-phase one at a time, a top-down
+    // build of the finished scene gives a tighter tree
+    world->RebuildBroadPhase();
+}
\ No newline at end of file
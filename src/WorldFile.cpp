@@ -0,0 +1,81 @@
+#include <WorldFile.h>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool saveWorldFile(b2World* world, const char* path)
+{
+    std::vector<char> data(world->SaveSnapshot(nullptr, 0));
+    world->SaveSnapshot(data.data(), (int32)data.size());
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) return false;
+
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && written;
+}
+
+#ifdef _WIN32
+
+bool loadWorldFile(b2World* world, const char* path)
+{
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    bool loaded = false;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart <= INT32_MAX)
+    {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr)
+        {
+            const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (data != nullptr)
+            {
+                loaded = world->LoadSnapshot(data, (int32)size.QuadPart);
+                UnmapViewOfFile(data);
+            }
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+    return loaded;
+}
+
+#else
+
+bool loadWorldFile(b2World* world, const char* path)
+{
+    int file = open(path, O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat status;
+    bool loaded = false;
+    if (fstat(file, &status) == 0 && status.st_size > 0 && status.st_size <= INT32_MAX)
+    {
+        void* data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+        {
+            // the snapshot is read front to back once
+            madvise(data, (size_t)status.st_size, MADV_SEQUENTIAL);
+            loaded = world->LoadSnapshot(data, (int32)status.st_size);
+            munmap(data, (size_t)status.st_size);
+        }
+    }
+
+    close(file);
+    return loaded;
+}
+
+#endif
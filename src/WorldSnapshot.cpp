@@ -0,0 +1,191 @@
+#include <WorldSnapshot.h>
+#include <SDL2/SDL.h>
+
+// matches the colors b2World::DebugDraw uses
+static b2Color getBodyColor(const b2Body* b)
+{
+	if (b->GetType() == b2_dynamicBody && b->GetMass() == 0.0f) return b2Color(1.0f, 0.0f, 0.0f);
+	if (!b->IsEnabled()) return b2Color(0.5f, 0.5f, 0.3f);
+	if (b->GetType() == b2_staticBody) return b2Color(0.5f, 0.9f, 0.5f);
+	if (b->GetType() == b2_kinematicBody) return b2Color(0.5f, 0.5f, 0.9f);
+	if (!b->IsAwake()) return b2Color(0.6f, 0.6f, 0.6f);
+
+	return b2Color(0.9f, 0.7f, 0.7f);
+}
+
+void WorldStats::capture(const b2World* world)
+{
+	profile = world->GetProfile();
+	bodyCount = world->GetBodyCount();
+	contactCount = world->GetContactCount();
+	proxyCount = world->GetProxyCount();
+	treeHeight = world->GetTreeHeight();
+	islandCount = world->GetIslandCount();
+}
+
+// appends the local vertices drawn for the shape
+static void copyVertices(std::vector<b2Vec2>& vertices, const b2Shape* shape, bool* oneSided)
+{
+	switch (shape->GetType())
+	{
+	case b2Shape::e_circle:
+		vertices.push_back(((const b2CircleShape*)shape)->m_p);
+		break;
+	case b2Shape::e_edge:
+	{
+		const b2EdgeShape* edge = (const b2EdgeShape*)shape;
+		vertices.push_back(edge->m_vertex1);
+		vertices.push_back(edge->m_vertex2);
+		*oneSided = edge->m_oneSided;
+		break;
+	}
+	case b2Shape::e_chain:
+	{
+		const b2ChainShape* chain = (const b2ChainShape*)shape;
+		vertices.insert(vertices.end(), chain->m_vertices, chain->m_vertices + chain->m_count);
+		break;
+	}
+	case b2Shape::e_polygon:
+	{
+		const b2PolygonShape* poly = (const b2PolygonShape*)shape;
+		vertices.insert(vertices.end(), poly->m_vertices, poly->m_vertices + poly->m_count);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void PreviousTransforms::capture(b2World* world)
+{
+	transforms.clear();
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		if (b->GetType() != b2_staticBody && b->IsAwake())
+		{
+			transforms.push_back(b->GetTransform());
+			b->GetUserData().pointer = transforms.size();
+		}
+		else
+		{
+			b->GetUserData().pointer = 0;
+		}
+	}
+}
+
+b2Transform PreviousTransforms::get(const b2Body* body) const
+{
+	uintptr_t slot = body->GetUserData().pointer;
+	if (slot == 0 || slot > transforms.size())
+	{
+		return body->GetTransform();
+	}
+
+	return transforms[slot - 1];
+}
+
+void WorldSnapshot::capture(b2World* world, const PreviousTransforms& previousTransforms)
+{
+	// clear keeps the capacity, after the first few steps nothing is allocated
+	bodies.clear();
+	shapes.clear();
+	vertices.clear();
+	jointAnchors.clear();
+	contactPoints.clear();
+
+	for (const b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		Body body;
+		body.current = b->GetTransform();
+		body.localCenter = b->GetLocalCenter();
+		body.color = getBodyColor(b);
+		body.firstShape = (int)shapes.size();
+		body.previous = previousTransforms.get(b);
+
+		for (const b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+		{
+			const b2Shape* source = f->GetShape();
+
+			Shape shape;
+			shape.type = source->GetType();
+			shape.radius = source->m_radius;
+			shape.oneSided = false;
+			shape.firstVertex = (int)vertices.size();
+			copyVertices(vertices, source, &shape.oneSided);
+			shape.vertexCount = (int)vertices.size() - shape.firstVertex;
+
+			// proxy AABBs cover the motion of the last step, so they also
+			// contain the interpolated shape
+			for (int32 i = 0; i < source->GetChildCount(); i++)
+			{
+				b2AABB aabb;
+				if (b->IsEnabled())
+				{
+					aabb = f->GetAABB(i);
+				}
+				else
+				{
+					// disabled bodies have no proxies
+					source->ComputeAABB(&aabb, body.current, i);
+				}
+
+				if (i == 0) shape.aabb = aabb;
+				else shape.aabb.Combine(aabb);
+			}
+
+			shapes.push_back(shape);
+		}
+
+		body.shapeCount = (int)shapes.size() - body.firstShape;
+		bodies.push_back(body);
+	}
+
+	for (const b2Joint* j = world->GetJointList(); j; j = j->GetNext())
+	{
+		jointAnchors.push_back(j->GetAnchorA());
+		jointAnchors.push_back(j->GetAnchorB());
+	}
+
+	for (b2Contact* c = world->GetContactList(); c; c = c->GetNext())
+	{
+		if (!c->IsTouching()) continue;
+
+		b2WorldManifold worldManifold;
+		c->GetWorldManifold(&worldManifold);
+
+		for (int32 i = 0; i < c->GetManifold()->pointCount; i++)
+		{
+			contactPoints.push_back(worldManifold.points[i]);
+		}
+	}
+
+	stats.capture(world);
+
+	time = SDL_GetPerformanceCounter();
+}
+
+WorldSnapshot& SnapshotBuffer::beginWrite()
+{
+	return snapshots[writeIndex];
+}
+
+void SnapshotBuffer::publish()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::swap(writeIndex, readyIndex);
+	hasNewSnapshot = true;
+}
+
+const WorldSnapshot& SnapshotBuffer::acquire()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (hasNewSnapshot)
+	{
+		std::swap(readIndex, readyIndex);
+		hasNewSnapshot = false;
+	}
+
+	return snapshots[readIndex];
+}
\ No newline at end of file